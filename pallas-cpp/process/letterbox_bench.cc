@@ -0,0 +1,120 @@
+// Compares the fused letterbox kernel against the OpenCV chain YOLO
+// preprocessing used before it (resize, copyMakeBorder, cvtColor, convertTo,
+// split), for our camera frame sizes into a 640x640 input. Also reports the
+// largest difference between the two outputs.
+#include <core/letterbox.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+namespace pallas {
+
+constexpr int ITERATIONS = 200;
+constexpr int INPUT_SIZE = 640;
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+constexpr Resolution RESOLUTIONS[] = {
+    {"320x240", 320, 240},
+    {"640x480", 640, 480},
+    {"1280x720", 1280, 720},
+    {"1920x1080", 1920, 1080},
+};
+
+// Fits the frame into the input, centred, as YOLO's letterbox does
+LetterboxLayout layout_for(int width, int height) {
+    const float ratio = std::min(static_cast<float>(INPUT_SIZE) / height,
+                                 static_cast<float>(INPUT_SIZE) / width);
+    LetterboxLayout layout{.width = INPUT_SIZE, .height = INPUT_SIZE};
+    layout.scaled_width = static_cast<int>(std::round(width * ratio));
+    layout.scaled_height = static_cast<int>(std::round(height * ratio));
+    layout.pad_left = (INPUT_SIZE - layout.scaled_width) / 2;
+    layout.pad_top = (INPUT_SIZE - layout.scaled_height) / 2;
+    return layout;
+}
+
+void opencv_letterbox(const cv::Mat& image, const LetterboxLayout& layout,
+                      float* blob) {
+    cv::Mat resized;
+    cv::resize(image, resized,
+               cv::Size(layout.scaled_width, layout.scaled_height), 0, 0,
+               cv::INTER_LINEAR);
+    cv::copyMakeBorder(
+        resized, resized, layout.pad_top,
+        layout.height - layout.scaled_height - layout.pad_top,
+        layout.pad_left, layout.width - layout.scaled_width - layout.pad_left,
+        cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114));
+    cv::Mat rgb;
+    cv::cvtColor(resized, rgb, cv::COLOR_BGR2RGB);
+    rgb.convertTo(rgb, CV_32FC3, 1.0f / 255.0f);
+    std::vector<cv::Mat> chw(3);
+    for (int i = 0; i < 3; ++i) {
+        chw[i] = cv::Mat(rgb.rows, rgb.cols, CV_32FC1,
+                         blob + i * rgb.cols * rgb.rows);
+    }
+    cv::split(rgb, chw);
+}
+
+void fused_letterbox(const cv::Mat& image, const LetterboxLayout& layout,
+                     float* blob) {
+    letterbox_bgr_to_planar_rgb(image.data, image.step, image.cols,
+                                image.rows, blob, layout);
+}
+
+using LetterboxFn = void (*)(const cv::Mat&, const LetterboxLayout&, float*);
+
+double run_ms(LetterboxFn letterbox, const cv::Mat& image,
+              const LetterboxLayout& layout, std::vector<float>& blob) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        letterbox(image, layout, blob.data());
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           ITERATIONS;
+}
+
+}  // namespace pallas
+
+int main() {
+    using namespace pallas;
+
+    // One thread, as each detection's preprocessing runs on one
+    cv::setNumThreads(1);
+    std::printf("letterbox isa: %s, %d iterations, %dx%d input\n",
+                letterbox_isa(), ITERATIONS, INPUT_SIZE, INPUT_SIZE);
+    std::printf("%-10s %12s %12s %9s %10s\n", "frame", "opencv (ms)",
+                "fused (ms)", "speedup", "max diff");
+    for (const auto& resolution : RESOLUTIONS) {
+        cv::Mat image(resolution.height, resolution.width, CV_8UC3);
+        cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+        const LetterboxLayout layout =
+            layout_for(resolution.width, resolution.height);
+
+        std::vector<float> expected(3 * INPUT_SIZE * INPUT_SIZE);
+        std::vector<float> actual(expected.size());
+        const double opencv_ms =
+            run_ms(opencv_letterbox, image, layout, expected);
+        const double fused_ms = run_ms(fused_letterbox, image, layout, actual);
+
+        float max_diff = 0.0f;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            max_diff = std::max(max_diff, std::abs(expected[i] - actual[i]));
+        }
+        std::printf("%-10s %12.3f %12.3f %8.2fx %10.5f\n", resolution.name,
+                    opencv_ms, fused_ms, opencv_ms / fused_ms, max_diff);
+    }
+    return EXIT_SUCCESS;
+}
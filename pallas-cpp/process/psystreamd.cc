@@ -11,7 +11,7 @@ int main() {
   const std::filesystem::path assets_path = "../assets/";
   
   const pallas::InferenceServiceConfig config{
-      .base = {.name = "psystream", .port = 8888, .interval_ms = 50.0},
+      .base = {.name = "psystream", .port = 8888, .interval_ms = 0},  // Wait on frames
 	  .inference {
 		  .use_gpu = true,  // Enable GPU acceleration for CUDA
 		  .yolo_path = assets_path / "yolo11.onnx",
@@ -1,12 +1,44 @@
 #include <service/camera_service.h>
-#include <service/ps3_camera_service.h>
+#include <service/frame_synchronizer.h>
+#include <service/ps3_camera_rig.h>
 #include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <memory>
 #include <core/logger.h>
+#include <core/trace.h>
+#include <pthread.h>
 #include <string>
 #include <iostream>
+#include <vector>
 
-int webcam(int device_id = 0)
+// A PS3 camera given on the command line as <id>[:<core>]
+struct PS3Camera {
+	int device_id{0};
+	int cpu_core{-1}; // Core to pin its capture thread to, -1 = any
+};
+
+sigset_t shutdown_signals()
+{
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	return signals;
+}
+
+// Blocks until SIGINT or SIGTERM. They must be blocked before any service
+// thread starts so that every thread inherits the mask and only this wait
+// receives them.
+void wait_for_shutdown()
+{
+	const sigset_t signals = shutdown_signals();
+	int signal = 0;
+	sigwait(&signals, &signal);
+	LOGI("Received signal {}, shutting down", signal);
+}
+
+int webcam(int device_id, const pallas::SharedMemoryOptions& shm_options)
 {
 	// Create a unique shared memory name for this webcam instance
 	std::string shared_memory_name = "webcam-" + std::to_string(device_id);
@@ -14,40 +46,67 @@ int webcam(int device_id = 0)
 	const pallas::CameraServiceConfig config{
 		.base = {.name = "starburst-webcam-" + std::to_string(device_id), .port = 8888 + device_id, .interval_ms = 16.6}, // ~60fps
 		.shared_memory_name = shared_memory_name,
-		.shared_memory_frame_capacity = 60}; // Higher capacity for 60fps streaming
+		.shared_memory_frame_capacity = 60, // Higher capacity for 60fps streaming
+		.shared_memory_options = shm_options};
 	pallas::CameraService camera_service{config}; 
 
 	camera_service.start();
 
-	LOGI("Webcam service started successfully with device_id {} and shared memory {}, will run for 24 hours", device_id, shared_memory_name);
-	std::this_thread::sleep_for(std::chrono::hours(24));
+	LOGI("Webcam service started successfully with device_id {} and shared memory {}, running until interrupted", device_id, shared_memory_name);
+	wait_for_shutdown();
 	camera_service.stop();
   
 	return 0; 
 }
 
-int ps3(int device_id = 0)
+int ps3(const std::vector<PS3Camera>& cameras, const pallas::PS3EyeConfig& camera_config, const pallas::SharedMemoryOptions& shm_options, double sync_tolerance_ms)
 {
-	// Create a unique shared memory name for this PS3 camera instance
-	std::string shared_memory_name = "ps3-" + std::to_string(device_id);
-	
-	const pallas::PS3CameraServiceConfig config{
-		.base = {.name = "starburst-ps3-" + std::to_string(device_id), .port = 8888 + device_id, .interval_ms = 16.6}, // ~60fps
-		.shared_memory_name = shared_memory_name,
-		.shared_memory_frame_capacity = 120, // Higher capacity for 60fps streaming
-		.camera_config = {.device_id = device_id} // Set the device_id in the camera_config
-	}; 
-	pallas::PS3CameraService camera_service{config}; 
+	pallas::PS3CameraRigConfig rig_config{
+		.base = {.name = "starburst-ps3-rig", .port = 0, .interval_ms = 1000}, // Hot-plug scan period
+	};
+	for (const PS3Camera& camera : cameras) {
+		// Create a unique shared memory name for each PS3 camera
+		pallas::PS3EyeConfig ps3_config = camera_config;
+		ps3_config.device_id = camera.device_id;
+		rig_config.cameras.push_back(pallas::PS3CameraServiceConfig{
+			.base = {.name = "starburst-ps3-" + std::to_string(camera.device_id), .port = static_cast<std::uint16_t>(8888 + camera.device_id), .interval_ms = 0, .cpu_core = camera.cpu_core}, // Capture blocks until the next frame
+			.shared_memory_name = "ps3-" + std::to_string(camera.device_id),
+			.shared_memory_frame_capacity = 120, // Higher capacity for 60fps streaming
+			.camera_config = ps3_config,
+			.shared_memory_options = shm_options
+		});
+	}
+	pallas::PS3CameraRig rig{rig_config};
 
-	if (!camera_service.start()) {
-		LOGE("Failed to start PS3 camera service with device_id {} and shared memory {}", device_id, shared_memory_name);
+	if (!rig.start()) {
+		LOGE("Failed to start PS3 camera rig");
 		return 1;
 	}
-	
-	LOGI("PS3 camera service started successfully with device_id {} and shared memory {}, will run for 24 hours", device_id, shared_memory_name);
-	std::this_thread::sleep_for(std::chrono::hours(24));
-	camera_service.stop();
-  
+
+	// Match the cameras' frames by capture time into one multi-view queue
+	std::unique_ptr<pallas::FrameSynchronizer> synchronizer;
+	if (sync_tolerance_ms > 0 && cameras.size() > 1) {
+		pallas::FrameSynchronizerConfig sync_config{
+			.base = {.name = "starburst-ps3-sync", .port = 0, .interval_ms = 0}, // Waits on the camera queues
+			.output_queue_name = "ps3-sync",
+			.output_frame_capacity = 30,
+			.tolerance_ns = static_cast<int64_t>(sync_tolerance_ms * 1e6),
+			.shared_memory_options = shm_options
+		};
+		for (const auto& camera_service_config : rig_config.cameras) {
+			sync_config.input_queue_names.push_back(camera_service_config.shared_memory_name);
+		}
+		synchronizer = std::make_unique<pallas::FrameSynchronizer>(sync_config);
+		synchronizer->start();
+	}
+
+	LOGI("PS3 camera rig started with {} of {} cameras attached, running until interrupted", rig.active_cameras(), cameras.size());
+	wait_for_shutdown();
+	if (synchronizer) {
+		synchronizer->stop();
+	}
+	rig.stop();
+
 	return 0; 
 }
 
@@ -55,18 +114,39 @@ void print_usage() {
 	std::cout << "Usage: ./starburstd [options]\n"
 			  << "Options:\n"
 			  << "  --webcam <id>    Use webcam with specified device ID (default: 0)\n"
-			  << "  --ps3 <id>       Use PS3 camera with specified device ID (default: 0)\n"
+			  << "  --ps3 <id>[:<core>]  Use PS3 camera with specified device ID (default: 0),\n"
+			  << "                   pinning its capture thread to a core. Repeat for more cameras;\n"
+			  << "                   cameras are started and stopped as they are plugged in and out\n"
+			  << "  --sync <ms>      Publish frames of all PS3 cameras captured within <ms> of each\n"
+			  << "                   other as one stacked frame to the ps3-sync queue\n"
+			  << "  --ps3-opencv     Capture the PS3 camera through OpenCV instead of V4L2\n"
+			  << "  --ps3-usb        Drive the PS3 camera directly over libusb\n"
+			  << "  --ps3-qvga       Capture the PS3 camera at 320x240\n"
+			  << "  --ps3-fps <n>    PS3 camera frame rate (default: 60; 187 at 320x240 with --ps3-usb)\n"
+			  << "  --ps3-record <f> Record raw USB transfers to a file for replay (--ps3-usb)\n"
+			  << "  --hugepages      Back the frame queue with 2 MiB huge pages\n"
+			  << "  --prefault       Fault in the whole frame queue at startup\n"
+			  << "  --numa <node>    Bind the frame queue to a NUMA node, or 'local'\n"
 			  << "  --help           Display this help message\n"
 			  << std::endl;
 }
 
 int main(int argc, char** argv) {
+	// Every thread inherits the blocked mask, leaving the signals to
+	// wait_for_shutdown(). Blocked first, as logging and tracing start
+	// threads of their own
+	const sigset_t signals = shutdown_signals();
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
 	pallas::init_logging();
 
 	bool use_ps3 = false;
-	int ps3_device_id = 0;
+	std::vector<PS3Camera> ps3_cameras;
+	pallas::PS3EyeConfig ps3_config;
 	bool use_webcam = false;
 	int webcam_device_id = 0;
+	pallas::SharedMemoryOptions shm_options;
+	double sync_tolerance_ms = 0;
 
 	// Parse command line arguments
 	for (int i = 1; i < argc; ++i) {
@@ -88,10 +168,57 @@ int main(int argc, char** argv) {
 		} else if (arg == "--ps3") {
 			use_ps3 = true;
 			if (i + 1 < argc) {
+				const std::string camera = argv[++i];
+				const auto colon = camera.find(':');
 				try {
-					ps3_device_id = std::stoi(argv[++i]);
+					ps3_cameras.push_back(PS3Camera{
+						.device_id = std::stoi(camera.substr(0, colon)),
+						.cpu_core = colon == std::string::npos ? -1 : std::stoi(camera.substr(colon + 1)),
+					});
 				} catch (const std::exception& e) {
-					LOGE("Invalid PS3 device ID: {}", argv[i]);
+					LOGE("Invalid PS3 camera: {}", camera);
+					print_usage();
+					return 1;
+				}
+			}
+		} else if (arg == "--sync" && i + 1 < argc) {
+			try {
+				sync_tolerance_ms = std::stod(argv[++i]);
+			} catch (const std::exception& e) {
+				LOGE("Invalid sync tolerance: {}", argv[i]);
+				print_usage();
+				return 1;
+			}
+		} else if (arg == "--ps3-opencv") {
+			ps3_config.backend = pallas::PS3EyeBackend::OpenCV;
+		} else if (arg == "--ps3-usb") {
+			ps3_config.backend = pallas::PS3EyeBackend::LibUSB;
+		} else if (arg == "--ps3-qvga") {
+			ps3_config.width = 320;
+			ps3_config.height = 240;
+		} else if (arg == "--ps3-fps" && i + 1 < argc) {
+			try {
+				ps3_config.fps = std::stoi(argv[++i]);
+			} catch (const std::exception& e) {
+				LOGE("Invalid PS3 frame rate: {}", argv[i]);
+				print_usage();
+				return 1;
+			}
+		} else if (arg == "--ps3-record" && i + 1 < argc) {
+			ps3_config.usb_record_path = argv[++i];
+		} else if (arg == "--hugepages") {
+			shm_options.huge_pages = true;
+		} else if (arg == "--prefault") {
+			shm_options.populate = true;
+		} else if (arg == "--numa" && i + 1 < argc) {
+			std::string node = argv[++i];
+			if (node == "local") {
+				shm_options.numa_node = pallas::NUMA_NODE_LOCAL;
+			} else {
+				try {
+					shm_options.numa_node = std::stoi(node);
+				} catch (const std::exception& e) {
+					LOGE("Invalid NUMA node: {}", node);
 					print_usage();
 					return 1;
 				}
@@ -115,11 +242,18 @@ int main(int argc, char** argv) {
 		use_webcam = false;
 	}
 
+	// `kill -USR2 <pid>` writes the recent spans of every thread as a
+	// Chrome trace
+	pallas::Tracer::dump_on_signal((std::filesystem::temp_directory_path() / "starburstd-trace").string());
+
 	if (use_ps3) {
-		LOGI("Starting PS3 camera with device_id: {}", ps3_device_id);
-		return ps3(ps3_device_id);
+		if (ps3_cameras.empty()) {
+			ps3_cameras.push_back(PS3Camera{});
+		}
+		LOGI("Starting {} PS3 cameras", ps3_cameras.size());
+		return ps3(ps3_cameras, ps3_config, shm_options, sync_tolerance_ms);
 	} else {
 		LOGI("Starting webcam with device_id: {}", webcam_device_id);
-		return webcam(webcam_device_id);
+		return webcam(webcam_device_id, shm_options);
 	}
 }
@@ -7,7 +7,7 @@ int main() {
 	pallas::init_logging();
 
   const pallas::ViewerServiceConfig config{
-      .base = {.name = "starforged", .port = 8888, .interval_ms = 50.0},
+      .base = {.name = "starforged", .port = 8888, .interval_ms = 0},  // Wait on frames
       .shared_memory_names = {"camera-1"}};
 
   pallas::ViewerService viewer_service(config);
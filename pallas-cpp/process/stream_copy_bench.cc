@@ -0,0 +1,111 @@
+// Compares memcpy against the streaming copies MatQueue uses, at the frame
+// sizes our cameras produce. Besides raw throughput it reports how long it
+// takes to re-read a cache-sized working set after each copy, which is what
+// the inference threads sharing the core actually feel.
+#include <core/stream_copy.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+namespace pallas {
+
+constexpr int ITERATIONS = 200;
+// Roughly an L2 worth of "someone else's" data
+constexpr size_t WORKING_SET_SIZE = 1024 * 1024;
+
+struct Resolution {
+    const char* name;
+    size_t bytes;
+};
+
+constexpr Resolution RESOLUTIONS[] = {
+    {"640x480", 640 * 480 * 3},
+    {"1280x720", 1280 * 720 * 3},
+    {"1920x1080", 1920 * 1080 * 3},
+};
+
+using CopyFn = void (*)(void*, const void*, size_t);
+
+struct Result {
+    double copy_gbps;
+    double reread_us;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+uint64_t touch(const std::vector<uint64_t>& working_set) {
+    uint64_t sum = 0;
+    for (uint64_t value : working_set) sum += value;
+    return sum;
+}
+
+Result run(CopyFn copy, size_t bytes, std::vector<uint64_t>& working_set) {
+    // Several buffers so consecutive iterations do not hit in cache, like
+    // a producer cycling through queue slots
+    constexpr int BUFFERS = 4;
+    std::vector<std::vector<uint8_t>> sources(BUFFERS), targets(BUFFERS);
+    for (int i = 0; i < BUFFERS; ++i) {
+        sources[i].assign(bytes, static_cast<uint8_t>(i));
+        targets[i].assign(bytes, 0);
+    }
+
+    double copy_seconds = 0, reread_seconds = 0;
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < ITERATIONS; ++i) {
+        sink = sink + touch(working_set);
+
+        auto start = std::chrono::steady_clock::now();
+        copy(targets[i % BUFFERS].data(), sources[i % BUFFERS].data(), bytes);
+        copy_seconds += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        sink = sink + touch(working_set);
+        reread_seconds += seconds_since(start);
+    }
+    return {bytes * ITERATIONS / copy_seconds / 1e9,
+            reread_seconds / ITERATIONS * 1e6};
+}
+
+void libc_memcpy(void* dst, const void* src, size_t size) {
+    std::memcpy(dst, src, size);
+}
+
+}  // namespace pallas
+
+int main() {
+    using namespace pallas;
+
+    struct Variant {
+        const char* name;
+        CopyFn copy;
+    };
+    const Variant variants[] = {
+        {"memcpy", libc_memcpy},
+        {"stream_copy_to", stream_copy_to},
+        {"stream_copy_from", stream_copy_from},
+    };
+
+    std::vector<uint64_t> working_set(WORKING_SET_SIZE / sizeof(uint64_t), 1);
+
+    std::printf("stream_copy isa: %s, %d iterations\n", stream_copy_isa(),
+                ITERATIONS);
+    std::printf("%-10s %-18s %10s %14s\n", "frame", "copy", "GB/s",
+                "re-read (us)");
+    for (const auto& resolution : RESOLUTIONS) {
+        for (const auto& variant : variants) {
+            const Result result =
+                run(variant.copy, resolution.bytes, working_set);
+            std::printf("%-10s %-18s %10.2f %14.1f\n", resolution.name,
+                        variant.name, result.copy_gbps, result.reread_us);
+        }
+    }
+    return EXIT_SUCCESS;
+}
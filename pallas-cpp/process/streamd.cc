@@ -1,4 +1,5 @@
 #include <core/logger.h>
+#include <core/trace.h>
 #include <service/stream_service.h>
 
 #include <csignal>
@@ -39,6 +40,11 @@ int main(int argc, char* argv[]) {
     // Initialize logging
     init_logging();
     LOGI("Starting streamd");
+
+    // `kill -USR2 <pid>` writes the recent spans of every thread as a Chrome
+    // trace, as does GET /api/trace
+    Tracer::dump_on_signal(
+        (std::filesystem::temp_directory_path() / "streamd-trace").string());
     
     LOGI("Usage: streamd [options]");
     LOGI("Options:");
@@ -124,7 +130,7 @@ int main(int argc, char* argv[]) {
     // Configure and start the service
     StreamServiceConfig config;
     config.base.name = "streamd";
-    config.base.interval_ms = 16.6;  // ~60 FPS
+    config.base.interval_ms = 0;  // Ticks block until a camera pushes a frame
     config.http_port = port;
     config.shared_memory_name = shared_mem_name;
     config.camera_ids = camera_ids;
@@ -0,0 +1,115 @@
+#include "async_log_sink.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace pallas {
+
+AsyncLogSink::AsyncLogSink(std::shared_ptr<spdlog::sinks::sink> target,
+                           std::size_t capacity)
+    : target_{std::move(target)},
+      ring_{capacity, DropPolicy::DropNewest},
+      thread_{[this]() { run(); }} {}
+
+AsyncLogSink::~AsyncLogSink() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void AsyncLogSink::log(const spdlog::details::log_msg& msg) {
+    if (msg.level >= spdlog::level::err) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        drain();
+        target_->log(msg);
+        target_->flush();
+        return;
+    }
+
+    Record record;
+    record.time = msg.time;
+    record.source = msg.source;
+    record.level = msg.level;
+    record.thread_id = msg.thread_id;
+    record.logger_name_size = static_cast<uint8_t>(
+        std::min(msg.logger_name.size(), record.logger_name.size()));
+    std::memcpy(record.logger_name.data(), msg.logger_name.data(),
+                record.logger_name_size);
+    if (msg.payload.size() <= record.text.size()) {
+        record.text_size = static_cast<uint16_t>(msg.payload.size());
+        std::memcpy(record.text.data(), msg.payload.data(), record.text_size);
+    } else {
+        record.long_text.assign(msg.payload.data(), msg.payload.size());
+    }
+
+    ring_.push(std::move(record));
+}
+
+void AsyncLogSink::flush() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    drain();
+    target_->flush();
+}
+
+void AsyncLogSink::set_pattern(const std::string& pattern) {
+    target_->set_pattern(pattern);
+}
+
+void AsyncLogSink::set_formatter(
+    std::unique_ptr<spdlog::formatter> sink_formatter) {
+    target_->set_formatter(std::move(sink_formatter));
+}
+
+void AsyncLogSink::run() {
+    pthread_setname_np(pthread_self(), "log-flush");
+
+    bool stopping = false;
+    while (!stopping) {
+        // Drain everything logged before the stop, then exit
+        stopping = !running_.load();
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            drain();
+            if (stopping) {
+                target_->flush();
+            }
+        }
+        if (!stopping) {
+            std::this_thread::sleep_for(FLUSH_INTERVAL);
+        }
+    }
+}
+
+void AsyncLogSink::drain() {
+    while (ring_.try_pop(drained_)) {
+        write(drained_);
+    }
+
+    if (const uint64_t drops = ring_.dropped(); drops != reported_drops_) {
+        const std::string message =
+            fmt::format("Dropped {} log records, the log ring was full",
+                        drops - reported_drops_);
+        reported_drops_ = drops;
+        target_->log(
+            spdlog::details::log_msg("", spdlog::level::warn, message));
+    }
+}
+
+void AsyncLogSink::write(const Record& record) {
+    const spdlog::string_view_t text =
+        record.long_text.empty()
+            ? spdlog::string_view_t(record.text.data(), record.text_size)
+            : spdlog::string_view_t(record.long_text);
+    spdlog::details::log_msg msg(
+        record.time, record.source,
+        spdlog::string_view_t(record.logger_name.data(),
+                              record.logger_name_size),
+        record.level, text);
+    msg.thread_id = record.thread_id;
+    target_->log(msg);
+}
+
+}  // namespace pallas
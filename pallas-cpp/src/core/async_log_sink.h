@@ -0,0 +1,83 @@
+#pragma once
+#include <spdlog/sinks/sink.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pipeline.h"
+
+namespace pallas {
+
+/**
+ * spdlog sink that moves formatting and I/O off the logging thread. log()
+ * copies the message into a preallocated lock-free ring and returns; a
+ * background thread formats the records with the target sink's pattern and
+ * writes them. A full ring drops the new record rather than block the
+ * caller, and the drops are reported once the ring drains.
+ *
+ * The background thread drains the ring every FLUSH_INTERVAL rather than
+ * being woken per record, so logging below ERROR never makes a system call
+ * on the caller's thread. Records at ERROR level and above are never
+ * queued or dropped: the caller writes everything queued before them, then
+ * the record itself, and flushes the target before log() returns, so the
+ * last error before an abort or crash is not lost.
+ */
+class AsyncLogSink final : public spdlog::sinks::sink {
+   public:
+    AsyncLogSink(std::shared_ptr<spdlog::sinks::sink> target,
+                 std::size_t capacity);
+    // Writes the records still queued, then joins the background thread
+    ~AsyncLogSink() override;
+
+    void log(const spdlog::details::log_msg& msg) override;
+    // Writes the records queued so far and flushes the target
+    void flush() override;
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(
+        std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+    uint64_t dropped() const { return ring_.dropped(); }
+
+   private:
+    static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+    // One message, copied by value so the ring owns no allocations except
+    // for the rare message longer than the inline buffer
+    struct Record {
+        static constexpr std::size_t INLINE_SIZE = 384;
+
+        spdlog::log_clock::time_point time;
+        spdlog::source_loc source;  // Points to string literals
+        spdlog::level::level_enum level = spdlog::level::off;
+        std::size_t thread_id = 0;
+        std::array<char, 32> logger_name{};
+        uint8_t logger_name_size = 0;
+        std::array<char, INLINE_SIZE> text;
+        uint16_t text_size = 0;
+        std::string long_text;  // Used instead of text when it does not fit
+    };
+
+    void run();
+    // Writes every queued record and reports new drops. Holds write_mutex_
+    void drain();
+    void write(const Record& record);
+
+    std::shared_ptr<spdlog::sinks::sink> target_;
+    PipelineEdge<Record> ring_;
+    std::atomic<bool> running_{true};
+    // Serializes writes to the target, from the background thread or from
+    // a caller writing an error
+    std::mutex write_mutex_;
+    Record drained_;              // Guarded by write_mutex_
+    uint64_t reported_drops_ = 0;  // Guarded by write_mutex_
+    std::thread thread_;
+};
+
+}  // namespace pallas
@@ -0,0 +1,556 @@
+#include "color_convert.h"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace pallas {
+namespace {
+
+// BT.601 video range in Q14, applied as (value << 7) * k >> 15 so the vector
+// paths can use a rounding 16-bit multiply-high. The scalar path does the
+// same integer math, so every path produces identical pixels.
+constexpr int16_t K_Y = 19077;     // 1.164383
+constexpr int16_t K_VR = 26149;    // 1.596027
+constexpr int16_t K_UG = -6419;    // -0.391762
+constexpr int16_t K_VG = -13320;   // -0.812968
+constexpr int16_t K_UB = 16666;    // 2.017232 - 1, the 1 is added as u << 6
+
+using YuyvFn = void (*)(const uint8_t*, size_t, uint8_t*, size_t, int, int,
+                        bool, bool);
+using BayerFn = void (*)(const uint8_t*, size_t, uint8_t*, size_t, int, int,
+                         BayerPattern, bool, bool);
+
+int16_t mulhrs(int32_t a, int32_t b) {
+    return static_cast<int16_t>((a * b + 0x4000) >> 15);
+}
+
+int16_t adds(int32_t a, int32_t b) {
+    return static_cast<int16_t>(std::clamp(a + b, -32768, 32767));
+}
+
+uint8_t to_u8(int16_t value) {
+    return static_cast<uint8_t>(std::clamp(adds(value, 32) >> 6, 0, 255));
+}
+
+void yuv_to_bgr_pixel(int y, int u, int v, uint8_t* bgr) {
+    const int16_t luma = mulhrs((y - 16) << 7, K_Y);
+    const int32_t u7 = (u - 128) << 7, v7 = (v - 128) << 7;
+    bgr[0] = to_u8(adds(luma, ((u - 128) << 6) + mulhrs(u7, K_UB)));
+    bgr[1] = to_u8(adds(adds(luma, mulhrs(u7, K_UG)), mulhrs(v7, K_VG)));
+    bgr[2] = to_u8(adds(luma, mulhrs(v7, K_VR)));
+}
+
+const uint8_t* src_row(const uint8_t* src, size_t stride, int y) {
+    return src + static_cast<size_t>(y) * stride;
+}
+
+uint8_t* dst_row(uint8_t* dst, size_t stride, int y, int height, bool flip) {
+    return dst + static_cast<size_t>(flip ? height - 1 - y : y) * stride;
+}
+
+// Output column of input column x
+int dst_x(int x, int width, bool flip) { return flip ? width - 1 - x : x; }
+
+// Converts pixels [from, width) of one row; `from` is even
+void yuyv_bgr_row_scalar(const uint8_t* src, uint8_t* dst, int from,
+                         int width, bool flip_horizontal) {
+    for (int x = from; x < width; x += 2) {
+        const uint8_t* yuyv = src + 2 * x;
+        yuv_to_bgr_pixel(yuyv[0], yuyv[1], yuyv[3],
+                         dst + 3 * dst_x(x, width, flip_horizontal));
+        yuv_to_bgr_pixel(yuyv[2], yuyv[1], yuyv[3],
+                         dst + 3 * dst_x(x + 1, width, flip_horizontal));
+    }
+}
+
+void yuyv_gray_row_scalar(const uint8_t* src, uint8_t* dst, int from,
+                          int width, bool flip_horizontal) {
+    for (int x = from; x < width; ++x) {
+        dst[dst_x(x, width, flip_horizontal)] = src[2 * x];
+    }
+}
+
+void scalar_yuyv_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                        size_t dst_stride, int width, int height,
+                        bool flip_horizontal, bool flip_vertical) {
+    for (int y = 0; y < height; ++y) {
+        yuyv_bgr_row_scalar(src_row(src, src_stride, y),
+                            dst_row(dst, dst_stride, y, height, flip_vertical),
+                            0, width, flip_horizontal);
+    }
+}
+
+void scalar_yuyv_to_gray(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                         size_t dst_stride, int width, int height,
+                         bool flip_horizontal, bool flip_vertical) {
+    for (int y = 0; y < height; ++y) {
+        yuyv_gray_row_scalar(src_row(src, src_stride, y),
+                             dst_row(dst, dst_stride, y, height, flip_vertical),
+                             0, width, flip_horizontal);
+    }
+}
+
+// Channel index (0 = B, 2 = R) of the non-green colour on a row, and
+// whether green sits on the even columns of that row
+struct BayerRow {
+    int color;
+    bool green_even;
+};
+
+BayerRow bayer_row(BayerPattern pattern, int y) {
+    BayerRow first;
+    switch (pattern) {
+        case BayerPattern::BGGR: first = {0, false}; break;
+        case BayerPattern::GBRG: first = {0, true}; break;
+        case BayerPattern::GRBG: first = {2, true}; break;
+        default: first = {2, false}; break;  // RGGB
+    }
+    if (y % 2 == 0) return first;
+    return {2 - first.color, !first.green_even};
+}
+
+// Mirrors an index into [0, size) without repeating the edge, which keeps
+// the Bayer parity of the neighbour intact
+int reflect(int i, int size) {
+    if (i < 0) return -i;
+    if (i >= size) return 2 * size - 2 - i;
+    return i;
+}
+
+// Interpolates one pixel, mirroring neighbours at the image border
+void bayer_pixel_scalar(const uint8_t* src, size_t stride, int width,
+                        int height, int x, int y, const BayerRow& row,
+                        uint8_t* bgr) {
+    const auto at = [&](int dx, int dy) -> int {
+        return src_row(src, stride, reflect(y + dy, height))
+            [reflect(x + dx, width)];
+    };
+    const int center = at(0, 0);
+    const int left = at(-1, 0), right = at(1, 0);
+    const int up = at(0, -1), down = at(0, 1);
+
+    const bool color_site = ((x % 2 == 0) != row.green_even);
+    if (color_site) {
+        bgr[row.color] = static_cast<uint8_t>(center);
+        bgr[1] = static_cast<uint8_t>((left + right + up + down + 2) >> 2);
+        bgr[2 - row.color] = static_cast<uint8_t>(
+            (at(-1, -1) + at(1, -1) + at(-1, 1) + at(1, 1) + 2) >> 2);
+    } else {
+        bgr[1] = static_cast<uint8_t>(center);
+        bgr[row.color] = static_cast<uint8_t>((left + right + 1) >> 1);
+        bgr[2 - row.color] = static_cast<uint8_t>((up + down + 1) >> 1);
+    }
+}
+
+void bayer_row_scalar(const uint8_t* src, size_t stride, uint8_t* dst,
+                      int from, int to, int width, int height, int y,
+                      BayerPattern pattern, bool flip_horizontal) {
+    const BayerRow row = bayer_row(pattern, y);
+    for (int x = from; x < to; ++x) {
+        bayer_pixel_scalar(src, stride, width, height, x, y, row,
+                           dst + 3 * dst_x(x, width, flip_horizontal));
+    }
+}
+
+void scalar_bayer_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                         size_t dst_stride, int width, int height,
+                         BayerPattern pattern, bool flip_horizontal,
+                         bool flip_vertical) {
+    for (int y = 0; y < height; ++y) {
+        bayer_row_scalar(src, src_stride,
+                         dst_row(dst, dst_stride, y, height, flip_vertical), 0,
+                         width, width, height, y, pattern, flip_horizontal);
+    }
+}
+
+#if defined(__x86_64__)
+// pshufb masks that scatter 16 bytes of one channel into three 16-byte
+// blocks of packed BGR
+constexpr std::array<std::array<std::array<int8_t, 16>, 3>, 3>
+make_interleave_masks() {
+    std::array<std::array<std::array<int8_t, 16>, 3>, 3> masks{};
+    for (int block = 0; block < 3; ++block) {
+        for (int channel = 0; channel < 3; ++channel) {
+            for (int i = 0; i < 16; ++i) {
+                const int byte = 16 * block + i;
+                masks[block][channel][i] =
+                    byte % 3 == channel ? static_cast<int8_t>(byte / 3)
+                                        : static_cast<int8_t>(-128);
+            }
+        }
+    }
+    return masks;
+}
+constexpr auto INTERLEAVE_MASKS = make_interleave_masks();
+
+__attribute__((target("sse4.1"))) inline __m128i load_mask(
+    const std::array<int8_t, 16>& mask) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask.data()));
+}
+
+__attribute__((target("sse4.1"))) inline __m128i reverse_bytes(__m128i v) {
+    return _mm_shuffle_epi8(
+        v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+// Stores 16 pixels of input columns [x, x + 16) as packed BGR, mirrored
+// within the row if flip_horizontal
+__attribute__((target("sse4.1"))) inline void store_bgr16(
+    uint8_t* row, int x, int width, bool flip_horizontal, __m128i b, __m128i g,
+    __m128i r) {
+    if (flip_horizontal) {
+        b = reverse_bytes(b);
+        g = reverse_bytes(g);
+        r = reverse_bytes(r);
+        x = width - 16 - x;
+    }
+    uint8_t* out = row + 3 * x;
+    for (int block = 0; block < 3; ++block) {
+        const auto& masks = INTERLEAVE_MASKS[block];
+        const __m128i bgr = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(b, load_mask(masks[0])),
+                         _mm_shuffle_epi8(g, load_mask(masks[1]))),
+            _mm_shuffle_epi8(r, load_mask(masks[2])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * block), bgr);
+    }
+}
+
+// BGR of 8 pixels from 16 bytes of YUYV, as 16-bit lanes
+__attribute__((target("sse4.1"))) inline void yuyv8_to_bgr16(
+    __m128i yuyv, __m128i& b, __m128i& g, __m128i& r) {
+    const __m128i y = _mm_sub_epi16(
+        _mm_and_si128(yuyv, _mm_set1_epi16(0x00ff)), _mm_set1_epi16(16));
+    const __m128i u = _mm_sub_epi16(
+        _mm_shuffle_epi8(yuyv, _mm_setr_epi8(1, -1, 1, -1, 5, -1, 5, -1, 9, -1,
+                                             9, -1, 13, -1, 13, -1)),
+        _mm_set1_epi16(128));
+    const __m128i v = _mm_sub_epi16(
+        _mm_shuffle_epi8(yuyv, _mm_setr_epi8(3, -1, 3, -1, 7, -1, 7, -1, 11,
+                                             -1, 11, -1, 15, -1, 15, -1)),
+        _mm_set1_epi16(128));
+
+    const __m128i luma =
+        _mm_mulhrs_epi16(_mm_slli_epi16(y, 7), _mm_set1_epi16(K_Y));
+    const __m128i u7 = _mm_slli_epi16(u, 7);
+    const __m128i v7 = _mm_slli_epi16(v, 7);
+    const __m128i round = _mm_set1_epi16(32);
+
+    b = _mm_adds_epi16(
+        luma, _mm_add_epi16(_mm_slli_epi16(u, 6),
+                            _mm_mulhrs_epi16(u7, _mm_set1_epi16(K_UB))));
+    g = _mm_adds_epi16(
+        _mm_adds_epi16(luma, _mm_mulhrs_epi16(u7, _mm_set1_epi16(K_UG))),
+        _mm_mulhrs_epi16(v7, _mm_set1_epi16(K_VG)));
+    r = _mm_adds_epi16(luma, _mm_mulhrs_epi16(v7, _mm_set1_epi16(K_VR)));
+
+    b = _mm_srai_epi16(_mm_adds_epi16(b, round), 6);
+    g = _mm_srai_epi16(_mm_adds_epi16(g, round), 6);
+    r = _mm_srai_epi16(_mm_adds_epi16(r, round), 6);
+}
+
+__attribute__((target("sse4.1"))) void sse41_yuyv_to_bgr(
+    const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+    int width, int height, bool flip_horizontal, bool flip_vertical) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = src_row(src, src_stride, y);
+        uint8_t* out = dst_row(dst, dst_stride, y, height, flip_vertical);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b0, g0, r0, b1, g1, r1;
+            yuyv8_to_bgr16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * x)),
+                b0, g0, r0);
+            yuyv8_to_bgr16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                               in + 2 * x + 16)),
+                           b1, g1, r1);
+            store_bgr16(out, x, width, flip_horizontal,
+                        _mm_packus_epi16(b0, b1), _mm_packus_epi16(g0, g1),
+                        _mm_packus_epi16(r0, r1));
+        }
+        yuyv_bgr_row_scalar(in, out, x, width, flip_horizontal);
+    }
+}
+
+// BGR of 16 pixels from 32 bytes of YUYV, as 16-bit lanes
+__attribute__((target("avx2"))) inline void yuyv16_to_bgr16(
+    __m256i yuyv, __m256i& b, __m256i& g, __m256i& r) {
+    const __m256i u_mask = _mm256_setr_epi8(
+        1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1, 1, -1, 1, -1,
+        5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1);
+    const __m256i v_mask = _mm256_setr_epi8(
+        3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1, 3, -1, 3,
+        -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1);
+    const __m256i y = _mm256_sub_epi16(
+        _mm256_and_si256(yuyv, _mm256_set1_epi16(0x00ff)),
+        _mm256_set1_epi16(16));
+    const __m256i u = _mm256_sub_epi16(_mm256_shuffle_epi8(yuyv, u_mask),
+                                       _mm256_set1_epi16(128));
+    const __m256i v = _mm256_sub_epi16(_mm256_shuffle_epi8(yuyv, v_mask),
+                                       _mm256_set1_epi16(128));
+
+    const __m256i luma =
+        _mm256_mulhrs_epi16(_mm256_slli_epi16(y, 7), _mm256_set1_epi16(K_Y));
+    const __m256i u7 = _mm256_slli_epi16(u, 7);
+    const __m256i v7 = _mm256_slli_epi16(v, 7);
+    const __m256i round = _mm256_set1_epi16(32);
+
+    b = _mm256_adds_epi16(
+        luma,
+        _mm256_add_epi16(_mm256_slli_epi16(u, 6),
+                         _mm256_mulhrs_epi16(u7, _mm256_set1_epi16(K_UB))));
+    g = _mm256_adds_epi16(
+        _mm256_adds_epi16(luma,
+                          _mm256_mulhrs_epi16(u7, _mm256_set1_epi16(K_UG))),
+        _mm256_mulhrs_epi16(v7, _mm256_set1_epi16(K_VG)));
+    r = _mm256_adds_epi16(luma,
+                          _mm256_mulhrs_epi16(v7, _mm256_set1_epi16(K_VR)));
+
+    b = _mm256_srai_epi16(_mm256_adds_epi16(b, round), 6);
+    g = _mm256_srai_epi16(_mm256_adds_epi16(g, round), 6);
+    r = _mm256_srai_epi16(_mm256_adds_epi16(r, round), 6);
+}
+
+// Packs two halves of 16 pixels into 32 bytes in pixel order
+__attribute__((target("avx2"))) inline __m256i pack32(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+}
+
+__attribute__((target("avx2"))) void avx2_yuyv_to_bgr(
+    const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+    int width, int height, bool flip_horizontal, bool flip_vertical) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = src_row(src, src_stride, y);
+        uint8_t* out = dst_row(dst, dst_stride, y, height, flip_vertical);
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i b0, g0, r0, b1, g1, r1;
+            yuyv16_to_bgr16(_mm256_loadu_si256(
+                                reinterpret_cast<const __m256i*>(in + 2 * x)),
+                            b0, g0, r0);
+            yuyv16_to_bgr16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                                in + 2 * x + 32)),
+                            b1, g1, r1);
+            const __m256i b = pack32(b0, b1);
+            const __m256i g = pack32(g0, g1);
+            const __m256i r = pack32(r0, r1);
+            store_bgr16(out, x, width, flip_horizontal,
+                        _mm256_castsi256_si128(b), _mm256_castsi256_si128(g),
+                        _mm256_castsi256_si128(r));
+            store_bgr16(out, x + 16, width, flip_horizontal,
+                        _mm256_extracti128_si256(b, 1),
+                        _mm256_extracti128_si256(g, 1),
+                        _mm256_extracti128_si256(r, 1));
+        }
+        yuyv_bgr_row_scalar(in, out, x, width, flip_horizontal);
+    }
+}
+
+__attribute__((target("sse4.1"))) void sse41_yuyv_to_gray(
+    const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+    int width, int height, bool flip_horizontal, bool flip_vertical) {
+    const __m128i luma_mask = _mm_set1_epi16(0x00ff);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = src_row(src, src_stride, y);
+        uint8_t* out = dst_row(dst, dst_stride, y, height, flip_vertical);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const __m128i lo = _mm_and_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * x)),
+                luma_mask);
+            const __m128i hi = _mm_and_si128(
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(in + 2 * x + 16)),
+                luma_mask);
+            __m128i gray = _mm_packus_epi16(lo, hi);
+            int to = x;
+            if (flip_horizontal) {
+                gray = reverse_bytes(gray);
+                to = width - 16 - x;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + to), gray);
+        }
+        yuyv_gray_row_scalar(in, out, x, width, flip_horizontal);
+    }
+}
+
+__attribute__((target("avx2"))) void avx2_yuyv_to_gray(
+    const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+    int width, int height, bool flip_horizontal, bool flip_vertical) {
+    const __m256i luma_mask = _mm256_set1_epi16(0x00ff);
+    const __m256i reverse = _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12,
+        11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = src_row(src, src_stride, y);
+        uint8_t* out = dst_row(dst, dst_stride, y, height, flip_vertical);
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            const __m256i lo = _mm256_and_si256(
+                _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(in + 2 * x)),
+                luma_mask);
+            const __m256i hi = _mm256_and_si256(
+                _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(in + 2 * x + 32)),
+                luma_mask);
+            __m256i gray =
+                _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+            int to = x;
+            if (flip_horizontal) {
+                // Reverse within each lane, then swap the lanes
+                gray = _mm256_permute4x64_epi64(
+                    _mm256_shuffle_epi8(gray, reverse), 0x4e);
+                to = width - 32 - x;
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + to), gray);
+        }
+        yuyv_gray_row_scalar(in, out, x, width, flip_horizontal);
+    }
+}
+
+__attribute__((target("sse4.1"))) inline __m128i load16(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Rounded average of four byte vectors
+__attribute__((target("sse4.1"))) inline __m128i average4(__m128i a, __m128i b,
+                                                           __m128i c,
+                                                           __m128i d) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i lo = _mm_add_epi16(
+        _mm_add_epi16(_mm_cvtepu8_epi16(a), _mm_cvtepu8_epi16(b)),
+        _mm_add_epi16(_mm_cvtepu8_epi16(c), _mm_cvtepu8_epi16(d)));
+    const __m128i hi = _mm_add_epi16(
+        _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+        _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+    return _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, two), 2),
+                            _mm_srli_epi16(_mm_add_epi16(hi, two), 2));
+}
+
+// Bilinear demosaic of interior rows 16 pixels at a time. The first and last
+// rows and columns need mirrored neighbours and go through the scalar path.
+__attribute__((target("sse4.1"))) void sse41_bayer_to_bgr(
+    const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+    int width, int height, BayerPattern pattern, bool flip_horizontal,
+    bool flip_vertical) {
+    // Byte lanes holding even input columns, for blocks starting at an odd
+    // column
+    const __m128i even_lanes = _mm_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 0, -1,
+                                             0, -1, 0, -1, 0, -1);
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t* out = dst_row(dst, dst_stride, y, height, flip_vertical);
+        if (y == 0 || y == height - 1) {
+            bayer_row_scalar(src, src_stride, out, 0, width, width, height, y,
+                             pattern, flip_horizontal);
+            continue;
+        }
+
+        const BayerRow row = bayer_row(pattern, y);
+        // Lanes where this row has its non-green colour
+        const __m128i color_sites =
+            row.green_even ? _mm_xor_si128(even_lanes, _mm_set1_epi8(-1))
+                           : even_lanes;
+        const uint8_t* up = src_row(src, src_stride, y - 1);
+        const uint8_t* mid = src_row(src, src_stride, y);
+        const uint8_t* down = src_row(src, src_stride, y + 1);
+
+        bayer_row_scalar(src, src_stride, out, 0, 1, width, height, y, pattern,
+                         flip_horizontal);
+        int x = 1;
+        for (; x + 17 <= width; x += 16) {
+            const __m128i center = load16(mid + x);
+            const __m128i left = load16(mid + x - 1);
+            const __m128i right = load16(mid + x + 1);
+            const __m128i above = load16(up + x);
+            const __m128i below = load16(down + x);
+
+            const __m128i horizontal = _mm_avg_epu8(left, right);
+            const __m128i vertical = _mm_avg_epu8(above, below);
+            const __m128i cross = average4(left, right, above, below);
+            const __m128i diagonal =
+                average4(load16(up + x - 1), load16(up + x + 1),
+                         load16(down + x - 1), load16(down + x + 1));
+
+            // blendv takes the second operand where the mask is set
+            const __m128i color =
+                _mm_blendv_epi8(horizontal, center, color_sites);
+            const __m128i green = _mm_blendv_epi8(center, cross, color_sites);
+            const __m128i other =
+                _mm_blendv_epi8(vertical, diagonal, color_sites);
+            if (row.color == 0) {
+                store_bgr16(out, x, width, flip_horizontal, color, green,
+                            other);
+            } else {
+                store_bgr16(out, x, width, flip_horizontal, other, green,
+                            color);
+            }
+        }
+        bayer_row_scalar(src, src_stride, out, x, width, width, height, y,
+                         pattern, flip_horizontal);
+    }
+}
+#endif
+
+struct Dispatch {
+    YuyvFn yuyv_to_bgr = scalar_yuyv_to_bgr;
+    YuyvFn yuyv_to_gray = scalar_yuyv_to_gray;
+    BayerFn bayer_to_bgr = scalar_bayer_to_bgr;
+    const char* isa = "scalar";
+
+    Dispatch() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            yuyv_to_bgr = avx2_yuyv_to_bgr;
+            yuyv_to_gray = avx2_yuyv_to_gray;
+            // Bound by its nine loads per block, not the vector width
+            bayer_to_bgr = sse41_bayer_to_bgr;
+            isa = "avx2";
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            yuyv_to_bgr = sse41_yuyv_to_bgr;
+            yuyv_to_gray = sse41_yuyv_to_gray;
+            bayer_to_bgr = sse41_bayer_to_bgr;
+            isa = "sse4.1";
+        }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+}  // namespace
+
+void yuyv_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                 size_t dst_stride, int width, int height,
+                 bool flip_horizontal, bool flip_vertical) {
+    dispatch().yuyv_to_bgr(src, src_stride, dst, dst_stride, width, height,
+                           flip_horizontal, flip_vertical);
+}
+
+void yuyv_to_gray(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                  size_t dst_stride, int width, int height,
+                  bool flip_horizontal, bool flip_vertical) {
+    dispatch().yuyv_to_gray(src, src_stride, dst, dst_stride, width, height,
+                            flip_horizontal, flip_vertical);
+}
+
+void bayer_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                  size_t dst_stride, int width, int height,
+                  BayerPattern pattern, bool flip_horizontal,
+                  bool flip_vertical) {
+    if (width < 2 || height < 2) return;  // Nothing to interpolate from
+    dispatch().bayer_to_bgr(src, src_stride, dst, dst_stride, width, height,
+                            pattern, flip_horizontal, flip_vertical);
+}
+
+const char* color_convert_isa() { return dispatch().isa; }
+
+}  // namespace pallas
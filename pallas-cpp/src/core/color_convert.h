@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace pallas {
+
+/**
+ * Colour conversion from raw camera formats, picked at runtime for the CPU
+ * we run on (AVX2, SSE4.1, or scalar).
+ *
+ * Each kernel makes a single pass over the frame and writes the optional
+ * horizontal/vertical flip directly, so the output can be a queue slot and
+ * no separate flip pass is needed. Strides are in bytes.
+ */
+
+enum class BayerPattern {
+    BGGR,  // Colour of the top-left 2x2 block, row by row
+    GBRG,
+    GRBG,
+    RGGB,
+};
+
+// Packed 4:2:2 YUYV to 8-bit BGR with BT.601 video-range coefficients, as
+// cv::COLOR_YUV2BGR_YUYV. Width must be even.
+void yuyv_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                 size_t dst_stride, int width, int height,
+                 bool flip_horizontal = false, bool flip_vertical = false);
+
+// Packed 4:2:2 YUYV to 8-bit gray, i.e. the luma plane
+void yuyv_to_gray(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                  size_t dst_stride, int width, int height,
+                  bool flip_horizontal = false, bool flip_vertical = false);
+
+// 8-bit Bayer mosaic to BGR with bilinear interpolation, mirroring the
+// image at its borders
+void bayer_to_bgr(const uint8_t* src, size_t src_stride, uint8_t* dst,
+                  size_t dst_stride, int width, int height,
+                  BayerPattern pattern, bool flip_horizontal = false,
+                  bool flip_vertical = false);
+
+// Name of the implementation selected for this CPU, for logs and benchmarks
+const char* color_convert_isa();
+
+}  // namespace pallas
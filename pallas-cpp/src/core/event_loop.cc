@@ -0,0 +1,235 @@
+#include "event_loop.h"
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "futex.h"
+#include "logger.h"
+
+namespace pallas {
+namespace {
+
+constexpr int MAX_EVENTS = 16;
+// Bounds a watcher round in case a waker skipped futex_wake()
+constexpr auto WATCH_TIMEOUT = std::chrono::seconds(1);
+
+void drain(int fd) {
+    uint64_t count;
+    while (::read(fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+}
+
+void signal(int fd) {
+    const uint64_t one = 1;
+    while (::write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+bool add_to_epoll(int epoll_fd, int fd, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        LOGE("Failed to add fd {} to epoll: {}", fd, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+EventLoop::EventLoop()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      futex_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || futex_fd_ < 0 ||
+        !add_to_epoll(epoll_fd_, wake_fd_, EPOLLIN) ||
+        !add_to_epoll(epoll_fd_, futex_fd_, EPOLLIN)) {
+        LOGE("Failed to create event loop: {}", std::strerror(errno));
+        if (epoll_fd_ >= 0) ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+EventLoop::~EventLoop() {
+    clear();
+    for (int fd : {epoll_fd_, wake_fd_, futex_fd_}) {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+bool EventLoop::add_fd(int fd, uint32_t events, Callback callback) {
+    if (!is_valid() || !add_to_epoll(epoll_fd_, fd, events)) return false;
+    fds_[fd] = FdSource{.callback = std::move(callback)};
+    return true;
+}
+
+int EventLoop::add_timer(std::chrono::nanoseconds period, Callback callback) {
+    if (!is_valid() || period <= std::chrono::nanoseconds::zero()) return -1;
+
+    const int fd =
+        timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0) {
+        LOGE("Failed to create timer: {}", std::strerror(errno));
+        return -1;
+    }
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(period);
+    const timespec interval{
+        .tv_sec = static_cast<time_t>(seconds.count()),
+        .tv_nsec = static_cast<long>((period - seconds).count()),
+    };
+    const itimerspec spec{.it_interval = interval, .it_value = interval};
+    if (timerfd_settime(fd, 0, &spec, nullptr) != 0 ||
+        !add_to_epoll(epoll_fd_, fd, EPOLLIN)) {
+        ::close(fd);
+        return -1;
+    }
+    fds_[fd] = FdSource{.callback = std::move(callback), .timer = true};
+    return fd;
+}
+
+bool EventLoop::add_futex(std::atomic<uint32_t>* word,
+                          std::atomic<uint32_t>* waiters, Callback callback) {
+    if (!is_valid() || word == nullptr) return false;
+    futexes_.push_back(FutexSource{
+        .word = word,
+        .waiters = waiters,
+        .seen = word->load(std::memory_order_acquire),
+        .callback = std::move(callback),
+    });
+    restart_watcher();
+    return true;
+}
+
+void EventLoop::remove_fd(int fd) {
+    auto it = fds_.find(fd);
+    if (it == fds_.end()) return;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    if (it->second.timer) ::close(fd);
+    fds_.erase(it);
+}
+
+void EventLoop::remove_futex(std::atomic<uint32_t>* word) {
+    const auto removed = std::erase_if(
+        futexes_, [word](const FutexSource& source) {
+            return source.word == word;
+        });
+    if (removed > 0) restart_watcher();
+}
+
+void EventLoop::clear() {
+    stop_watcher();
+    futexes_.clear();
+    while (!fds_.empty()) remove_fd(fds_.begin()->first);
+}
+
+int EventLoop::wait(std::chrono::nanoseconds timeout) {
+    if (!is_valid()) return 0;
+
+    int timeout_ms = -1;
+    if (timeout >= std::chrono::nanoseconds::zero()) {
+        // Round up so a short timeout does not turn into a busy poll
+        timeout_ms = static_cast<int>(
+            std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+    }
+
+    std::array<epoll_event, MAX_EVENTS> events;
+    int ready;
+    do {
+        ready = epoll_wait(epoll_fd_, events.data(), events.size(), timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+
+    int fired = 0;
+    for (int i = 0; i < ready; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == wake_fd_) {
+            drain(fd);
+        } else if (fd == futex_fd_) {
+            drain(fd);
+            fired += fire_futexes();
+        } else if (auto it = fds_.find(fd); it != fds_.end()) {
+            if (it->second.timer) drain(fd);
+            ++fired;
+            if (it->second.callback) it->second.callback();
+        }
+    }
+    return fired;
+}
+
+void EventLoop::wake() {
+    if (wake_fd_ >= 0) signal(wake_fd_);
+}
+
+int EventLoop::fire_futexes() {
+    int fired = 0;
+    for (auto& source : futexes_) {
+        const uint32_t value = source.word->load(std::memory_order_acquire);
+        if (value == source.seen) continue;
+        source.seen = value;
+        ++fired;
+        if (source.callback) source.callback();
+    }
+    return fired;
+}
+
+void EventLoop::restart_watcher() {
+    stop_watcher();
+    if (futexes_.empty()) return;
+
+    // The control word comes first, so stop_watcher() can always wake it
+    std::vector<std::atomic<uint32_t>*> words{&control_word_};
+    std::vector<std::atomic<uint32_t>*> waiters{nullptr};
+    // Start from the values the callbacks last saw, so a change that landed
+    // before the watcher started is still signalled
+    std::vector<uint32_t> expected{control_word_.load()};
+    for (const auto& source : futexes_) {
+        words.push_back(source.word);
+        waiters.push_back(source.waiters);
+        expected.push_back(source.seen);
+    }
+
+    watching_.store(true);
+    watcher_ = std::thread(&EventLoop::watch, this, std::move(words),
+                           std::move(waiters), std::move(expected));
+}
+
+void EventLoop::stop_watcher() {
+    if (!watcher_.joinable()) return;
+    watching_.store(false);
+    control_word_.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(&control_word_);
+    watcher_.join();
+}
+
+void EventLoop::watch(std::vector<std::atomic<uint32_t>*> words,
+                      std::vector<std::atomic<uint32_t>*> waiters,
+                      std::vector<uint32_t> expected) {
+    while (watching_.load()) {
+        // Registering as a waiter before the wait pairs with wakers that
+        // bump the word and then check for waiters: either the wait sees
+        // the new value or the waker sees us
+        for (auto* count : waiters) {
+            if (count) count->fetch_add(1, std::memory_order_seq_cst);
+        }
+        futex_wait_any(words, expected, WATCH_TIMEOUT);
+        for (auto* count : waiters) {
+            if (count) count->fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool changed = false;
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            const uint32_t value = words[i]->load(std::memory_order_acquire);
+            changed |= i > 0 && value != expected[i];
+            expected[i] = value;
+        }
+        if (changed) signal(futex_fd_);
+    }
+}
+
+}  // namespace pallas
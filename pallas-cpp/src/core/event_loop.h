@@ -0,0 +1,101 @@
+#pragma once
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace pallas {
+
+/**
+ * Readiness sources multiplexed in one epoll set: file descriptors such as
+ * sockets or eventfds, periodic timers, and futex words in shared memory
+ * such as a MatQueue's push counter.
+ *
+ * Futexes cannot be polled, so while any are registered a watcher thread
+ * sleeps on all of them at once with futex_wait_any() and signals an eventfd
+ * in the epoll set when one changes. A burst of pushes costs the watcher one
+ * wake-up per round, and nothing runs while every source is idle.
+ *
+ * Sources are added, removed and waited on from one thread, typically the
+ * owning service's; only wake() may be called from any thread.
+ */
+class EventLoop {
+   public:
+    using Callback = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool is_valid() const { return epoll_fd_ >= 0; }
+
+    // Watches fd, level-triggered: the callback, or the tick that follows
+    // the wait, must consume the readiness or the next wait returns at once
+    bool add_fd(int fd, uint32_t events = EPOLLIN, Callback callback = {});
+
+    // Fires every period on CLOCK_MONOTONIC. Returns the timer's fd, which
+    // the loop owns and closes in remove_fd(), or -1 on failure
+    int add_timer(std::chrono::nanoseconds period, Callback callback = {});
+
+    // Fires when *word changes. waiters, if given, is incremented while the
+    // watcher sleeps, for wakers that skip futex_wake() when nobody waits.
+    // Both must stay mapped until remove_futex() or clear()
+    bool add_futex(std::atomic<uint32_t>* word,
+                   std::atomic<uint32_t>* waiters = nullptr,
+                   Callback callback = {});
+
+    void remove_fd(int fd);
+    void remove_futex(std::atomic<uint32_t>* word);
+    // Removes every source and stops the futex watcher
+    void clear();
+    bool empty() const { return fds_.empty() && futexes_.empty(); }
+
+    // Sleeps until a source is ready, wake() is called or the timeout
+    // expires (negative = forever), runs the callbacks of the ready sources
+    // and returns how many fired
+    int wait(std::chrono::nanoseconds timeout);
+
+    // Makes the current or next wait() return, e.g. to stop the owner
+    void wake();
+
+   private:
+    struct FdSource {
+        Callback callback;
+        bool timer = false;  // Owned timerfd, drained on every expiry
+    };
+
+    struct FutexSource {
+        std::atomic<uint32_t>* word;
+        std::atomic<uint32_t>* waiters;
+        uint32_t seen;  // Value when the callback last fired
+        Callback callback;
+    };
+
+    // The watcher holds its own copy of the words, so it is restarted
+    // whenever the set changes
+    void restart_watcher();
+    void stop_watcher();
+    void watch(std::vector<std::atomic<uint32_t>*> words,
+               std::vector<std::atomic<uint32_t>*> waiters,
+               std::vector<uint32_t> expected);
+    int fire_futexes();
+
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;     // eventfd behind wake()
+    int futex_fd_ = -1;    // eventfd the watcher signals
+    std::unordered_map<int, FdSource> fds_;
+    std::vector<FutexSource> futexes_;
+
+    std::thread watcher_;
+    std::atomic<bool> watching_{false};
+    // Bumped to pull the watcher out of its futex wait
+    std::atomic<uint32_t> control_word_{0};
+};
+
+}  // namespace pallas
@@ -0,0 +1,136 @@
+#include "executor.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <string>
+
+#include "futex.h"
+#include "logger.h"
+
+namespace pallas {
+namespace {
+
+// Bounds an idle worker's sleep in case a wake-up is ever missed
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds(1);
+
+// The executor and deque the calling thread works for, if it is a worker
+thread_local const Executor* current_executor = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}  // namespace
+
+Executor::Executor(std::size_t workers) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    // Start only once every deque exists, workers steal from all of them
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread([this, i]() { run(i); });
+    }
+    LOGI("Executor started with {} workers", workers);
+}
+
+Executor::~Executor() {
+    stopping_.store(true, std::memory_order_seq_cst);
+    work_word_.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(&work_word_);
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+Executor& Executor::Shared() {
+    static Executor executor;
+    return executor;
+}
+
+void Executor::post(Task task) {
+    const std::size_t index =
+        current_executor == this
+            ? current_worker
+            : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                  workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+
+    // Pairs with run(): a worker either sees the new word or is counted
+    work_word_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+        futex_wake(&work_word_, 1);
+    }
+}
+
+void Executor::run(std::size_t index) {
+    current_executor = this;
+    current_worker = index;
+    pthread_setname_np(pthread_self(),
+                       ("executor-" + std::to_string(index)).c_str());
+
+    while (true) {
+        // Read the word before looking for work, so a post in between makes
+        // the wait below return at once
+        const uint32_t token = work_word_.load(std::memory_order_seq_cst);
+        Task task;
+        if (try_pop(index, task) || try_steal(index, task)) {
+            task();
+            continue;
+        }
+        // Queued work is drained before the workers exit
+        if (stopping_.load(std::memory_order_seq_cst)) {
+            break;
+        }
+
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        futex_wait(&work_word_, token, IDLE_TIMEOUT);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool Executor::run_one() {
+    const bool is_worker = current_executor == this;
+    Task task;
+    if ((is_worker && try_pop(current_worker, task)) ||
+        try_steal(is_worker ? current_worker : workers_.size(), task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+bool Executor::try_pop(std::size_t index, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    // Newest first, its data is most likely still in cache
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool Executor::try_steal(std::size_t thief, Task& task) {
+    const std::size_t count = workers_.size();
+    for (std::size_t offset = 1; offset <= count; ++offset) {
+        // Start at the thief's neighbour so thieves spread over victims
+        const std::size_t victim = (thief + offset) % count;
+        if (victim == thief) continue;
+
+        Worker& worker = *workers_[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) continue;
+        // Oldest first, the owner is working from the other end
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace pallas
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace pallas {
+
+/**
+ * Work-stealing thread pool shared by the services of a process, so that
+ * short parallel work like per-camera inference does not each bring its own
+ * threads and oversubscribe the cores.
+ *
+ * Every worker owns a deque. Tasks posted from a worker go to the back of
+ * its own deque and are run newest first while the data is still in cache;
+ * tasks posted from other threads are dealt round-robin. An idle worker
+ * steals the oldest task of another worker before it sleeps on a futex.
+ *
+ * Tasks should not block on I/O: long-running loops such as a service's
+ * tick thread keep their own thread.
+ */
+class Executor {
+   public:
+    using Task = std::move_only_function<void()>;
+
+    // 0 workers = one per core
+    explicit Executor(std::size_t workers = 0);
+    // Runs the tasks still queued, then joins the workers
+    ~Executor();
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // The process-wide executor, started on first use
+    static Executor& Shared();
+
+    void post(Task task);
+
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+        std::packaged_task<std::invoke_result_t<Fn>()> task(
+            std::forward<Fn>(fn));
+        auto future = task.get_future();
+        post(std::move(task));
+        return future;
+    }
+
+    // Runs queued tasks on the calling thread until the future is ready, so
+    // a task can wait on tasks it submitted without tying up its worker
+    template <typename T>
+    T get(std::future<T>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready) {
+            // Whatever the future waits on is running elsewhere
+            if (!run_one()) break;
+        }
+        return future.get();
+    }
+
+    std::size_t worker_count() const { return workers_.size(); }
+    // Tasks taken from another worker's deque
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+   private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void run(std::size_t index);
+    // Runs one task from the calling worker's deque, or stolen from another
+    bool run_one();
+    bool try_pop(std::size_t index, Task& task);
+    bool try_steal(std::size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::size_t> next_worker_{0};  // Round-robin for outsiders
+    std::atomic<uint64_t> steals_{0};
+    std::atomic<bool> stopping_{false};
+
+    // Futex bumped per post, idle workers sleep on it
+    std::atomic<uint32_t> work_word_{0};
+    std::atomic<uint32_t> sleepers_{0};
+};
+
+}  // namespace pallas
@@ -0,0 +1,85 @@
+#include "futex.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+namespace pallas {
+namespace {
+timespec to_timespec(std::chrono::nanoseconds duration) {
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    return timespec{static_cast<time_t>(seconds.count()),
+                    static_cast<long>((duration - seconds).count())};
+}
+
+uint32_t* futex_address(std::atomic<uint32_t>* word) {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+    return reinterpret_cast<uint32_t*>(word);
+}
+}  // namespace
+
+bool futex_wait(std::atomic<uint32_t>* word, uint32_t expected,
+                std::chrono::nanoseconds timeout) {
+    if (timeout.count() <= 0) return false;
+
+    const timespec relative = to_timespec(timeout);
+    const long result = syscall(SYS_futex, futex_address(word), FUTEX_WAIT,
+                                expected, &relative, nullptr, 0);
+    return result == 0 || errno != ETIMEDOUT;
+}
+
+void futex_wake(std::atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, futex_address(word), FUTEX_WAKE, count, nullptr,
+            nullptr, 0);
+}
+
+bool futex_wait_any(std::span<std::atomic<uint32_t>* const> words,
+                    std::span<const uint32_t> expected,
+                    std::chrono::nanoseconds timeout) {
+    if (timeout.count() <= 0 || words.empty()) return false;
+    if (words.size() == 1) return futex_wait(words[0], expected[0], timeout);
+
+#ifdef SYS_futex_waitv
+    if (words.size() <= FUTEX_WAITV_MAX) {
+        std::vector<futex_waitv> waiters(words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            waiters[i] = futex_waitv{
+                .val = expected[i],
+                .uaddr = reinterpret_cast<uintptr_t>(futex_address(words[i])),
+                .flags = FUTEX_32,
+                .__reserved = 0};
+        }
+
+        // futex_waitv only takes an absolute timeout
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const timespec deadline = to_timespec(
+            std::chrono::seconds(now.tv_sec) +
+            std::chrono::nanoseconds(now.tv_nsec) + timeout);
+
+        const long result =
+            syscall(SYS_futex_waitv, waiters.data(), waiters.size(), 0,
+                    &deadline, CLOCK_MONOTONIC);
+        if (result >= 0) return true;
+        if (errno != ENOSYS) return errno != ETIMEDOUT;
+    }
+#endif
+
+    // Kernels before 5.16: poll the words with short sleeps
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (words[i]->load(std::memory_order_acquire) != expected[i])
+                return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+}  // namespace pallas
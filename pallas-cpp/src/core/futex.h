@@ -0,0 +1,29 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+namespace pallas {
+
+/**
+ * Thin wrappers over the Linux futex syscalls for words that may live in
+ * shared memory (no FUTEX_PRIVATE_FLAG), so waiters and wakers can sit in
+ * different processes.
+ */
+
+// Sleeps while *word == expected, for at most timeout. Returns false if the
+// timeout expired, true on wake-up or if the word already differed.
+bool futex_wait(std::atomic<uint32_t>* word, uint32_t expected,
+                std::chrono::nanoseconds timeout);
+
+// Wakes up to count waiters sleeping on word.
+void futex_wake(std::atomic<uint32_t>* word, int count = INT32_MAX);
+
+// Sleeps until any words[i] != expected[i], for at most timeout. Uses
+// futex_waitv where available and falls back to short polling sleeps.
+bool futex_wait_any(std::span<std::atomic<uint32_t>* const> words,
+                    std::span<const uint32_t> expected,
+                    std::chrono::nanoseconds timeout);
+
+}  // namespace pallas
@@ -0,0 +1,84 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace pallas {
+
+size_t LatencyHistogram::bucket_of(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return ns;
+    // Position of the leading bit picks the octave, the next bits the bucket
+    const int exponent = std::bit_width(ns) - 1;
+    const uint64_t sub =
+        (ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+int64_t LatencyHistogram::bucket_upper_ns(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return static_cast<int64_t>(bucket);
+    const int exponent = static_cast<int>(bucket / SUB_BUCKETS) +
+                         SUB_BUCKET_BITS - 1;
+    const uint64_t sub = bucket % SUB_BUCKETS;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    const uint64_t upper = lower + ((uint64_t{1} << shift) - 1);
+    return static_cast<int64_t>(
+        std::min<uint64_t>(upper, std::numeric_limits<int64_t>::max()));
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    ns = std::max<int64_t>(ns, 0);
+    buckets_[bucket_of(static_cast<uint64_t>(ns))].fetch_add(
+        1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+    int64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(
+                           max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t LatencyHistogram::percentile_ns(double p) const {
+    const uint64_t total = count();
+    if (total == 0) return 0;
+
+    const auto rank = static_cast<uint64_t>(
+        std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * total));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += buckets_[bucket].load(std::memory_order_relaxed);
+        if (seen >= std::max<uint64_t>(rank, 1)) {
+            return std::min(bucket_upper_ns(bucket), max_ns());
+        }
+    }
+    return max_ns();
+}
+
+uint64_t LatencyHistogram::count_at_most(int64_t ns) const {
+    uint64_t total = 0;
+    for (size_t bucket = 0; bucket < BUCKETS && bucket_upper_ns(bucket) <= ns;
+         ++bucket) {
+        total += buckets_[bucket].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double LatencyHistogram::mean_ns() const {
+    const uint64_t total = count();
+    return total == 0
+               ? 0.0
+               : static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) /
+                     total;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace pallas
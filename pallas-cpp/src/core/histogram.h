@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pallas {
+
+/**
+ * Histogram of durations in nanoseconds, e.g. how long a tick took.
+ *
+ * Buckets are log-linear: exact below 8 ns, then 8 buckets per power of two,
+ * so a percentile is reported to within 12.5% over the whole int64 range in
+ * a fixed 4 KiB. Threads record and read concurrently; both are lock-free,
+ * and a read that races a record may miss that sample.
+ */
+class LatencyHistogram {
+   public:
+    void record(int64_t ns);
+
+    // Upper bound of the bucket holding the p-th percentile, p in [0, 100],
+    // capped at the largest sample. 0 if empty.
+    int64_t percentile_ns(double p) const;
+
+    // Samples in the buckets that end at or below ns, so exact at bucket
+    // bounds and otherwise short by at most part of one bucket
+    uint64_t count_at_most(int64_t ns) const;
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+    int64_t max_ns() const { return max_ns_.load(std::memory_order_relaxed); }
+    double mean_ns() const;
+
+    void reset();
+
+   private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = 64 * SUB_BUCKETS;
+
+    static size_t bucket_of(uint64_t ns);
+    static int64_t bucket_upper_ns(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> sum_ns_{0};
+    std::atomic<int64_t> max_ns_{0};
+};
+
+}  // namespace pallas
@@ -0,0 +1,209 @@
+#include "letterbox.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace pallas {
+namespace {
+
+// Scales the source rows row0 and row1, blended by wy, into `count` output
+// pixels. Output pixel i blends the source pixels at byte offsets x0[i] and
+// x1[i] by wx[i]. The first vector_count pixels read 4 bytes at x1[i], so
+// their fourth byte must still be within the row
+using RowFn = void (*)(const uint8_t* row0, const uint8_t* row1, float wy,
+                       const int32_t* x0, const int32_t* x1, const float* wx,
+                       int vector_count, int count, float scale, float* r,
+                       float* g, float* b);
+
+float blend(float a, float b, float weight) { return a + weight * (b - a); }
+
+void scalar_pixels(const uint8_t* row0, const uint8_t* row1, float wy,
+                   const int32_t* x0, const int32_t* x1, const float* wx,
+                   int from, int count, float scale, float* r, float* g,
+                   float* b) {
+    float* planes[3] = {b, g, r};
+    for (int i = from; i < count; ++i) {
+        const uint8_t* p00 = row0 + x0[i];
+        const uint8_t* p01 = row0 + x1[i];
+        const uint8_t* p10 = row1 + x0[i];
+        const uint8_t* p11 = row1 + x1[i];
+        for (int c = 0; c < 3; ++c) {
+            const float top = blend(p00[c], p01[c], wx[i]);
+            const float bottom = blend(p10[c], p11[c], wx[i]);
+            planes[c][i] = blend(top, bottom, wy) * scale;
+        }
+    }
+}
+
+void scalar_row(const uint8_t* row0, const uint8_t* row1, float wy,
+                const int32_t* x0, const int32_t* x1, const float* wx,
+                int /*vector_count*/, int count, float scale, float* r,
+                float* g, float* b) {
+    scalar_pixels(row0, row1, wy, x0, x1, wx, 0, count, scale, r, g, b);
+}
+
+#if defined(__x86_64__)
+// Channel SHIFT / 8 of 8 gathered BGR pixels, as floats
+template <int SHIFT>
+__attribute__((target("avx2"))) inline __m256 channel(__m256i pixels) {
+    return _mm256_cvtepi32_ps(_mm256_and_si256(
+        _mm256_srli_epi32(pixels, SHIFT), _mm256_set1_epi32(0xFF)));
+}
+
+template <int SHIFT>
+__attribute__((target("avx2"))) inline void blend8(
+    __m256i p00, __m256i p01, __m256i p10, __m256i p11, __m256 wx, __m256 wy,
+    __m256 scale, float* out) {
+    const __m256 a = channel<SHIFT>(p00);
+    const __m256 c = channel<SHIFT>(p10);
+    const __m256 top =
+        _mm256_add_ps(a, _mm256_mul_ps(wx, _mm256_sub_ps(channel<SHIFT>(p01), a)));
+    const __m256 bottom =
+        _mm256_add_ps(c, _mm256_mul_ps(wx, _mm256_sub_ps(channel<SHIFT>(p11), c)));
+    const __m256 value =
+        _mm256_add_ps(top, _mm256_mul_ps(wy, _mm256_sub_ps(bottom, top)));
+    _mm256_storeu_ps(out, _mm256_mul_ps(value, scale));
+}
+
+// Gathers each pixel's BGR as the low 3 bytes of a 32-bit lane, 8 at a time
+__attribute__((target("avx2"))) void avx2_row(
+    const uint8_t* row0, const uint8_t* row1, float wy, const int32_t* x0,
+    const int32_t* x1, const float* wx, int vector_count, int count,
+    float scale, float* r, float* g, float* b) {
+    const auto* base0 = reinterpret_cast<const int*>(row0);
+    const auto* base1 = reinterpret_cast<const int*>(row1);
+    const __m256 wy8 = _mm256_set1_ps(wy);
+    const __m256 scale8 = _mm256_set1_ps(scale);
+    int i = 0;
+    for (; i + 8 <= vector_count; i += 8) {
+        const __m256i offsets0 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x0 + i));
+        const __m256i offsets1 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x1 + i));
+        const __m256i p00 = _mm256_i32gather_epi32(base0, offsets0, 1);
+        const __m256i p01 = _mm256_i32gather_epi32(base0, offsets1, 1);
+        const __m256i p10 = _mm256_i32gather_epi32(base1, offsets0, 1);
+        const __m256i p11 = _mm256_i32gather_epi32(base1, offsets1, 1);
+        const __m256 wx8 = _mm256_loadu_ps(wx + i);
+        blend8<0>(p00, p01, p10, p11, wx8, wy8, scale8, b + i);
+        blend8<8>(p00, p01, p10, p11, wx8, wy8, scale8, g + i);
+        blend8<16>(p00, p01, p10, p11, wx8, wy8, scale8, r + i);
+    }
+    scalar_pixels(row0, row1, wy, x0, x1, wx, i, count, scale, r, g, b);
+}
+#endif
+
+struct Dispatch {
+    RowFn row = scalar_row;
+    const char* isa = "scalar";
+
+    Dispatch() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            row = avx2_row;
+            isa = "avx2";
+        }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+// Source index and weight of the next pixel for output pixel d, mapping
+// pixel centres as cv::INTER_LINEAR does and clamping at the edges
+void source_tap(int d, float ratio, int src_size, int& index, float& weight) {
+    const float position = (static_cast<float>(d) + 0.5f) * ratio - 0.5f;
+    index = static_cast<int>(std::floor(position));
+    weight = position - static_cast<float>(index);
+    if (index < 0) {
+        index = 0;
+        weight = 0.0f;
+    } else if (index >= src_size - 1) {
+        index = src_size - 1;
+        weight = 0.0f;
+    }
+}
+
+// Column taps of the last call on this thread, so steady-state calls
+// do not allocate
+struct ColumnTaps {
+    std::vector<int32_t> x0;  // Byte offsets into a row
+    std::vector<int32_t> x1;
+    std::vector<float> weight;
+};
+
+}  // namespace
+
+void letterbox_bgr_to_planar_rgb(const uint8_t* src, size_t src_stride,
+                                 int src_width, int src_height, float* dst,
+                                 const LetterboxLayout& layout,
+                                 uint8_t pad_value, float scale) {
+    if (src_width <= 0 || src_height <= 0 || layout.scaled_width <= 0 ||
+        layout.scaled_height <= 0) {
+        return;
+    }
+    const size_t plane = static_cast<size_t>(layout.width) * layout.height;
+    float* const planes[3] = {dst, dst + plane, dst + 2 * plane};
+    const float pad = static_cast<float>(pad_value) * scale;
+
+    thread_local ColumnTaps taps;
+    const int columns = layout.scaled_width;
+    taps.x0.resize(columns);
+    taps.x1.resize(columns);
+    taps.weight.resize(columns);
+    const float ratio_x = static_cast<float>(src_width) / columns;
+    // Columns whose second tap leaves a byte to spare for a 4-byte read
+    int vector_count = 0;
+    for (int d = 0; d < columns; ++d) {
+        int index;
+        source_tap(d, ratio_x, src_width, index, taps.weight[d]);
+        const int next = std::min(index + 1, src_width - 1);
+        taps.x0[d] = 3 * index;
+        taps.x1[d] = 3 * next;
+        if (next < src_width - 1) vector_count = d + 1;
+    }
+
+    const float ratio_y =
+        static_cast<float>(src_height) / layout.scaled_height;
+    const int right = layout.pad_left + layout.scaled_width;
+    for (int y = 0; y < layout.height; ++y) {
+        float* rows[3];
+        for (int c = 0; c < 3; ++c) {
+            rows[c] = planes[c] + static_cast<size_t>(y) * layout.width;
+        }
+        const int dy = y - layout.pad_top;
+        if (dy < 0 || dy >= layout.scaled_height) {
+            for (float* row : rows) std::fill_n(row, layout.width, pad);
+            continue;
+        }
+        for (float* row : rows) {
+            std::fill_n(row, layout.pad_left, pad);
+            std::fill(row + right, row + layout.width, pad);
+        }
+
+        int index;
+        float wy;
+        source_tap(dy, ratio_y, src_height, index, wy);
+        const uint8_t* row0 = src + static_cast<size_t>(index) * src_stride;
+        const uint8_t* row1 =
+            src + static_cast<size_t>(std::min(index + 1, src_height - 1)) *
+                      src_stride;
+        dispatch().row(row0, row1, wy, taps.x0.data(), taps.x1.data(),
+                       taps.weight.data(), vector_count, columns, scale,
+                       rows[0] + layout.pad_left, rows[1] + layout.pad_left,
+                       rows[2] + layout.pad_left);
+    }
+}
+
+const char* letterbox_isa() { return dispatch().isa; }
+
+}  // namespace pallas
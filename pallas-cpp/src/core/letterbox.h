@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace pallas {
+
+// Where a letterboxed image lands in the output, in output pixels
+struct LetterboxLayout {
+    int width{0};  // Output size
+    int height{0};
+    int scaled_width{0};  // The scaled image, at (pad_left, pad_top)
+    int scaled_height{0};
+    int pad_left{0};
+    int pad_top{0};
+};
+
+/**
+ * Preprocessing for detector input in one pass, picked at runtime for the
+ * CPU we run on (AVX2 or scalar).
+ *
+ * Reads a packed 8-bit BGR image, scales it bilinearly into the layout's
+ * scaled region with cv::INTER_LINEAR's pixel-centre mapping, fills the
+ * padding with pad_value, and writes value * scale as three float planes,
+ * R, G then B, of layout.width * layout.height each. This replaces resize,
+ * copyMakeBorder, cvtColor, convertTo and split, and their temporaries.
+ * Unlike that chain, the scaled pixels are not rounded to 8 bits first.
+ *
+ * The stride is in bytes.
+ */
+void letterbox_bgr_to_planar_rgb(const uint8_t* src, size_t src_stride,
+                                 int src_width, int src_height, float* dst,
+                                 const LetterboxLayout& layout,
+                                 uint8_t pad_value = 114,
+                                 float scale = 1.0f / 255.0f);
+
+// Name of the implementation selected for this CPU, for logs and benchmarks
+const char* letterbox_isa();
+
+}  // namespace pallas
@@ -5,9 +5,16 @@
 #include <memory>
 #include <source_location>
 
+#include "async_log_sink.h"
+
 namespace pallas {
-void init_logging() {
-    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+void init_logging(const LoggingOptions& options) {
+    std::shared_ptr<spdlog::sinks::sink> console_sink =
+        std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    if (options.async) {
+        console_sink = std::make_shared<AsyncLogSink>(std::move(console_sink),
+                                                      options.async_capacity);
+    }
     console_sink->set_pattern(
         "[%Y-%m-%d %H:%M:%S.%e][%^%l%$[%s:%#\x1B[32m\x1B[0m %v");
 
@@ -2,6 +2,11 @@
 
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
 namespace pallas {
 #define LOGT(...) SPDLOG_TRACE(__VA_ARGS__)
 #define LOGD(...) SPDLOG_DEBUG(__VA_ARGS__)
@@ -15,5 +20,57 @@ namespace pallas {
         assert(condition);            \
     }
 
-void init_logging();
+// Sampling and rate limiting per call site, for lines on hot paths. The
+// arguments are only formatted when the line is written.
+//
+//     LOGI_EVERY_N(100, "Frame {}", sequence);       // 1st, 101st, ...
+//     LOGW_EVERY_MS(1000, "Tick failed: {}", error);  // At most once a second
+#define PALLAS_LOG_EVERY_N(LOG, n, ...)                                  \
+    do {                                                                 \
+        static std::atomic<uint64_t> pallas_log_calls_{0};               \
+        if (pallas_log_calls_.fetch_add(1, std::memory_order_relaxed) %  \
+                (n) ==                                                   \
+            0) {                                                         \
+            LOG(__VA_ARGS__);                                            \
+        }                                                                \
+    } while (false)
+
+#define PALLAS_LOG_EVERY_MS(LOG, ms, ...)                                \
+    do {                                                                 \
+        static std::atomic<int64_t> pallas_log_next_ns_{0};              \
+        if (::pallas::log_interval_elapsed(pallas_log_next_ns_, (ms))) { \
+            LOG(__VA_ARGS__);                                            \
+        }                                                                \
+    } while (false)
+
+#define LOGD_EVERY_N(n, ...) PALLAS_LOG_EVERY_N(LOGD, n, __VA_ARGS__)
+#define LOGI_EVERY_N(n, ...) PALLAS_LOG_EVERY_N(LOGI, n, __VA_ARGS__)
+#define LOGW_EVERY_N(n, ...) PALLAS_LOG_EVERY_N(LOGW, n, __VA_ARGS__)
+#define LOGE_EVERY_N(n, ...) PALLAS_LOG_EVERY_N(LOGE, n, __VA_ARGS__)
+#define LOGD_EVERY_MS(ms, ...) PALLAS_LOG_EVERY_MS(LOGD, ms, __VA_ARGS__)
+#define LOGI_EVERY_MS(ms, ...) PALLAS_LOG_EVERY_MS(LOGI, ms, __VA_ARGS__)
+#define LOGW_EVERY_MS(ms, ...) PALLAS_LOG_EVERY_MS(LOGW, ms, __VA_ARGS__)
+#define LOGE_EVERY_MS(ms, ...) PALLAS_LOG_EVERY_MS(LOGE, ms, __VA_ARGS__)
+
+// True at most once per interval_ms for one next_ns, across threads
+inline bool log_interval_elapsed(std::atomic<int64_t>& next_ns,
+                                 int64_t interval_ms) {
+    const int64_t now_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    int64_t next = next_ns.load(std::memory_order_relaxed);
+    return now_ns >= next &&
+           next_ns.compare_exchange_strong(next,
+                                           now_ns + interval_ms * 1'000'000,
+                                           std::memory_order_relaxed);
+}
+
+struct LoggingOptions {
+    // Format and write records on a background thread, see AsyncLogSink
+    bool async = true;
+    std::size_t async_capacity = 4096;  // Records queued before dropping
+};
+
+void init_logging(const LoggingOptions& options = {});
 }  // namespace pallas
@@ -0,0 +1,172 @@
+#include "metrics.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace pallas {
+namespace {
+
+constexpr const char* TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+// Histogram bucket bounds, from a fast stage to a stalled one
+constexpr double BUCKET_SECONDS[] = {0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                     0.025,  0.05,  0.1,    0.25,  0.5,
+                                     1.0,    2.5};
+
+std::string escape_label(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string render_labels(const MetricLabels& labels) {
+    std::string rendered;
+    for (const auto& [name, value] : labels) {
+        if (!rendered.empty()) rendered += ',';
+        rendered += fmt::format("{}=\"{}\"", name, escape_label(value));
+    }
+    return rendered;
+}
+
+// name{labels} with the labels, if any, and extra appended
+std::string series_name(const std::string& name, const std::string& labels,
+                        const std::string& extra = {}) {
+    if (labels.empty() && extra.empty()) return name;
+    const char* separator = labels.empty() || extra.empty() ? "" : ",";
+    return fmt::format("{}{{{}{}{}}}", name, labels, separator, extra);
+}
+
+}  // namespace
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t DurationMetric::count() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) total += shard.count();
+    return total;
+}
+
+int64_t DurationMetric::sum_ns() const {
+    int64_t total = 0;
+    for (const auto& shard : shards_) total += shard.sum_ns();
+    return total;
+}
+
+uint64_t DurationMetric::count_at_most(int64_t ns) const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) total += shard.count_at_most(ns);
+    return total;
+}
+
+MetricsRegistry& MetricsRegistry::Shared() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+template <typename T>
+T& MetricsRegistry::find_or_add(const std::string& name,
+                                const std::string& help,
+                                const MetricLabels& labels) {
+    // Index of T in Metric, which TYPE_NAMES follows
+    constexpr std::size_t type = std::is_same_v<T, Counter> ? 0
+                                 : std::is_same_v<T, Gauge> ? 1
+                                                            : 2;
+    const std::string rendered = render_labels(labels);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, added] =
+        families_.try_emplace(name, Family{.help = help, .type = type, .series = {}});
+    Family& family = it->second;
+    if (family.type != type) {
+        throw std::invalid_argument(fmt::format(
+            "Metric {} is already registered as a {}", name,
+            TYPE_NAMES[family.type]));
+    }
+    for (auto& series : family.series) {
+        if (series.labels == rendered) return std::get<T>(*series.metric);
+    }
+    family.series.push_back(Series{
+        .labels = rendered,
+        .metric = std::make_unique<Metric>(std::in_place_type<T>),
+    });
+    return std::get<T>(*family.series.back().metric);
+}
+
+Counter& MetricsRegistry::counter(const std::string& name,
+                                  const std::string& help,
+                                  const MetricLabels& labels) {
+    return find_or_add<Counter>(name, help, labels);
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                              const MetricLabels& labels) {
+    return find_or_add<Gauge>(name, help, labels);
+}
+
+DurationMetric& MetricsRegistry::duration(const std::string& name,
+                                          const std::string& help,
+                                          const MetricLabels& labels) {
+    return find_or_add<DurationMetric>(name, help, labels);
+}
+
+void MetricsRegistry::write_prometheus(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_) {
+        out << fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, family.help,
+                           name, TYPE_NAMES[family.type]);
+        for (const auto& series : family.series) {
+            const std::string& labels = series.labels;
+            if (const auto* counter = std::get_if<Counter>(series.metric.get())) {
+                out << fmt::format("{} {}\n", series_name(name, labels),
+                                   counter->value());
+            } else if (const auto* gauge =
+                           std::get_if<Gauge>(series.metric.get())) {
+                out << fmt::format("{} {}\n", series_name(name, labels),
+                                   gauge->value());
+            } else {
+                const auto& duration = std::get<DurationMetric>(*series.metric);
+                // Read the count first, so no bucket exceeds +Inf
+                const uint64_t count = duration.count();
+                for (const double seconds : BUCKET_SECONDS) {
+                    const auto bound_ns = static_cast<int64_t>(seconds * 1e9);
+                    out << fmt::format(
+                        "{} {}\n",
+                        series_name(name + "_bucket", labels,
+                                    fmt::format("le=\"{}\"", seconds)),
+                        std::min(duration.count_at_most(bound_ns), count));
+                }
+                out << fmt::format(
+                    "{} {}\n",
+                    series_name(name + "_bucket", labels, "le=\"+Inf\""),
+                    count);
+                out << fmt::format("{} {}\n",
+                                   series_name(name + "_sum", labels),
+                                   duration.sum_ns() / 1e9);
+                out << fmt::format("{} {}\n",
+                                   series_name(name + "_count", labels),
+                                   count);
+            }
+        }
+    }
+}
+
+}  // namespace pallas
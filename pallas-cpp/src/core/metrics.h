@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "histogram.h"
+
+namespace pallas {
+
+// Label names and values of one series, e.g. {{"camera", "ps3-0"}}
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+
+// Hot metrics are split in shards so threads updating them do not contend
+// for one cache line; threads are dealt shards round-robin
+inline constexpr std::size_t SHARDS = 8;
+
+inline std::size_t thread_shard() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t shard =
+        next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+}  // namespace metrics_detail
+
+// Monotonic count, e.g. of frames received
+class Counter {
+   public:
+    void add(uint64_t n = 1) {
+        shards_[metrics_detail::thread_shard()].value.fetch_add(
+            n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+   private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, metrics_detail::SHARDS> shards_;
+};
+
+// Value that goes up and down, e.g. connected clients
+class Gauge {
+   public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta) {
+        value_.fetch_add(delta, std::memory_order_relaxed);
+    }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<double> value_{0.0};
+};
+
+// Distribution of durations, exported as a Prometheus histogram
+class DurationMetric {
+   public:
+    void record(int64_t ns) {
+        shards_[metrics_detail::thread_shard()].record(ns);
+    }
+    uint64_t count() const;
+    int64_t sum_ns() const;
+    uint64_t count_at_most(int64_t ns) const;
+
+   private:
+    std::array<LatencyHistogram, metrics_detail::SHARDS> shards_;
+};
+
+/**
+ * Named metrics of a process, rendered in the Prometheus text format for a
+ * /metrics endpoint. Registration takes a lock and returns a reference that
+ * stays valid for the registry's lifetime; keep it, as updates through it
+ * are lock-free. Registering a name and labels again returns the same
+ * metric, so services that restart keep counting.
+ */
+class MetricsRegistry {
+   public:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // The process-wide registry
+    static MetricsRegistry& Shared();
+
+    // Throw std::invalid_argument if name is registered as another type
+    Counter& counter(const std::string& name, const std::string& help,
+                     const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help,
+                 const MetricLabels& labels = {});
+    // Exported in seconds, name should end in _seconds
+    DurationMetric& duration(const std::string& name, const std::string& help,
+                             const MetricLabels& labels = {});
+
+    void write_prometheus(std::ostream& out) const;
+
+   private:
+    using Metric = std::variant<Counter, Gauge, DurationMetric>;
+
+    struct Series {
+        std::string labels;  // Rendered, e.g. camera="ps3-0"
+        std::unique_ptr<Metric> metric;
+    };
+
+    struct Family {
+        std::string help;
+        std::size_t type;  // Index into Metric
+        std::vector<Series> series;
+    };
+
+    template <typename T>
+    T& find_or_add(const std::string& name, const std::string& help,
+                   const MetricLabels& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+}  // namespace pallas
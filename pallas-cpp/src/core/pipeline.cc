@@ -0,0 +1,51 @@
+#include "pipeline.h"
+
+#include "logger.h"
+
+namespace pallas {
+
+bool Pipeline::start() {
+    if (running_) {
+        return false;
+    }
+    for (auto& edge : edges_) {
+        edge.reopen();
+    }
+    // Consumers first, so the first items do not wait for their stage
+    for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
+        if (!it->stage->start()) {
+            LOGE("Pipeline stage [{}] failed to start", it->name);
+            stop();
+            return false;
+        }
+    }
+    running_ = true;
+    return true;
+}
+
+void Pipeline::stop() {
+    for (auto& node : nodes_) {
+        node.close_input();
+        node.stage->stop();
+    }
+    for (auto& edge : edges_) {
+        edge.drain();
+    }
+    running_ = false;
+}
+
+std::vector<Pipeline::StageStats> Pipeline::stats() const {
+    std::vector<StageStats> stats;
+    stats.reserve(nodes_.size());
+    for (const auto& node : nodes_) {
+        stats.push_back(StageStats{
+            .name = node.name,
+            .processed = node.processed(),
+            .dropped = node.dropped(),
+            .latency = node.latency,
+        });
+    }
+    return stats;
+}
+
+}  // namespace pallas
@@ -0,0 +1,370 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "futex.h"
+#include "histogram.h"
+#include "service.h"
+#include "timer.h"
+
+namespace pallas {
+
+// What a full pipeline edge does with a new item
+enum class DropPolicy {
+    DropOldest,  // Evict the oldest queued item, e.g. for live video
+    DropNewest,  // Discard the new item and keep the backlog in order
+};
+
+/**
+ * Bounded lock-free queue between two pipeline stages. A bounded MPMC ring
+ * (D. Vyukov's): every cell carries a sequence number that tells producers
+ * and consumers whose turn it is, so neither side takes a lock. Pushes never
+ * block; a full edge drops an item by its DropPolicy. Consumers can sleep
+ * on a futex until something is pushed.
+ */
+template <typename T>
+class PipelineEdge {
+   public:
+    // capacity is rounded up to a power of two, at least 2 as the cell
+    // sequences need one lap to tell a full cell from an empty one
+    PipelineEdge(std::size_t capacity, DropPolicy policy)
+        : capacity_{std::bit_ceil(std::max<std::size_t>(capacity, 2))},
+          mask_{capacity_ - 1},
+          policy_{policy},
+          cells_{std::make_unique<Cell[]>(capacity_)} {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    PipelineEdge(const PipelineEdge&) = delete;
+    PipelineEdge& operator=(const PipelineEdge&) = delete;
+
+    // Returns false if an item was dropped, the new one or an older one
+    bool push(T item) {
+        bool dropped = false;
+        while (!try_push(item)) {
+            if (policy_ == DropPolicy::DropNewest) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            T oldest;
+            if (try_pop(oldest)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                dropped = true;
+            }
+        }
+
+        push_word_.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) != 0) {
+            futex_wake(&push_word_);
+        }
+        return !dropped;
+    }
+
+    bool try_pop(T& item) {
+        std::size_t position = dequeue_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[position & mask_];
+            const std::size_t sequence =
+                cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position + 1);
+            if (diff == 0) {
+                if (dequeue_.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.value);
+                    cell.value = T{};
+                    cell.sequence.store(position + capacity_,
+                                        std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                position = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Sleeps until an item can be popped, the timeout expires or the edge
+    // is closed. Returns false if nothing was popped.
+    bool wait_pop(T& item, std::chrono::nanoseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!closed_.load(std::memory_order_acquire)) {
+            // Read the word before checking, so a push in between makes the
+            // wait below return at once
+            const uint32_t token = push_word_.load(std::memory_order_seq_cst);
+            if (try_pop(item)) return true;
+
+            const auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::nanoseconds::zero()) return false;
+
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            futex_wait(&push_word_, token, remaining);
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    // Wakes consumers and makes wait_pop() return at once until reopened
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        push_word_.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&push_word_);
+    }
+    void reopen() { closed_.store(false, std::memory_order_release); }
+
+    // Pops and destroys every queued item, returns how many
+    std::size_t drain() {
+        std::size_t drained = 0;
+        T item;
+        while (try_pop(item)) {
+            item = T{};
+            ++drained;
+        }
+        return drained;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    DropPolicy policy() const { return policy_; }
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value{};
+    };
+
+    bool try_push(T& item) {
+        std::size_t position = enqueue_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[position & mask_];
+            const std::size_t sequence =
+                cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) -
+                              static_cast<std::ptrdiff_t>(position);
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(item);
+                    cell.sequence.store(position + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                position = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    const DropPolicy policy_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(64) std::atomic<std::size_t> enqueue_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_{0};
+    alignas(64) std::atomic<uint32_t> push_word_{0};  // Futex bumped per push
+    std::atomic<uint32_t> waiters_{0};  // Consumers sleeping on push_word_
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> closed_{false};
+};
+
+struct PipelineStageConfig {
+    ServiceConfig base;  // interval_ms is unused, stages wait on their input
+    std::size_t output_capacity{2};
+    DropPolicy output_policy{DropPolicy::DropOldest};
+};
+
+/**
+ * One node of a Pipeline: a service thread that pops items from its input
+ * edge, runs them through fn and pushes the results to its output edge.
+ * fn returns std::optional<Out>, nullopt to drop the item, or void for a
+ * sink stage without output.
+ */
+template <typename In, typename Out>
+class PipelineStage : public Service {
+   public:
+    using Fn = std::conditional_t<std::is_void_v<Out>,
+                                  std::function<void(In&&)>,
+                                  std::function<std::optional<Out>(In&&)>>;
+    // Sinks have no output edge
+    using Output =
+        std::conditional_t<std::is_void_v<Out>, std::nullptr_t,
+                           std::shared_ptr<PipelineEdge<std::conditional_t<
+                               std::is_void_v<Out>, int, Out>>>>;
+
+    PipelineStage(ServiceConfig config,
+                  std::shared_ptr<PipelineEdge<In>> input, Output output,
+                  Fn fn)
+        : Service(std::move(config)),
+          input_{std::move(input)},
+          output_{std::move(output)},
+          fn_{std::move(fn)} {}
+    ~PipelineStage() override { stop(); }
+
+    // Time fn took per item, without the wait for input
+    const LatencyHistogram& latency() const { return latency_; }
+    uint64_t processed() const {
+        return processed_.load(std::memory_order_relaxed);
+    }
+
+   protected:
+    std::expected<void, std::string> tick() override {
+        In item;
+        if (!input_->wait_pop(item, INPUT_WAIT)) {
+            return {};
+        }
+
+        const int64_t start_ns = monotonic_ns();
+        try {
+            if constexpr (std::is_void_v<Out>) {
+                fn_(std::move(item));
+            } else if (std::optional<Out> result = fn_(std::move(item))) {
+                output_->push(std::move(*result));
+            }
+        } catch (const std::exception& e) {
+            return std::unexpected(e.what());
+        }
+        latency_.record(monotonic_ns() - start_ns);
+        processed_.fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+
+   private:
+    // Bounds a wait in case the input is never closed
+    static constexpr auto INPUT_WAIT = std::chrono::milliseconds(100);
+
+    std::shared_ptr<PipelineEdge<In>> input_;
+    Output output_;
+    Fn fn_;
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> processed_{0};
+};
+
+/**
+ * A chain of stages, each on its own thread, joined by bounded lock-free
+ * edges. Stages overlap across items, so throughput is set by the slowest
+ * stage rather than the sum of all of them, and a slow stage sheds load by
+ * its input edge's DropPolicy instead of stalling the ones before it.
+ *
+ * Build the graph with source(), stage() and sink(), then start() it and
+ * push into the source edge. Items are moved from stage to stage.
+ */
+class Pipeline {
+   public:
+    // Counters of one stage, for logs and metrics
+    struct StageStats {
+        std::string name;
+        uint64_t processed;
+        uint64_t dropped;  // Items its input edge dropped
+        const LatencyHistogram* latency;
+    };
+
+    Pipeline() = default;
+    ~Pipeline() { stop(); }
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // The edge to push the pipeline's input into
+    template <typename T>
+    std::shared_ptr<PipelineEdge<T>> source(
+        std::size_t capacity, DropPolicy policy = DropPolicy::DropOldest) {
+        auto edge = std::make_shared<PipelineEdge<T>>(capacity, policy);
+        add_edge(edge);
+        return edge;
+    }
+
+    // Adds a stage that maps each item of input with fn, returning
+    // std::optional<Out>, and returns the edge its results go to
+    template <typename In, typename Fn>
+    auto stage(PipelineStageConfig config,
+               const std::shared_ptr<PipelineEdge<In>>& input, Fn&& fn) {
+        using Out = typename std::invoke_result_t<Fn, In&&>::value_type;
+        auto output = source<Out>(config.output_capacity, config.output_policy);
+        add_stage(std::make_unique<PipelineStage<In, Out>>(
+                      std::move(config.base), input, output,
+                      std::forward<Fn>(fn)),
+                  input);
+        return output;
+    }
+
+    // Adds a final stage that consumes every item of input with fn
+    template <typename In, typename Fn>
+    void sink(ServiceConfig config,
+              const std::shared_ptr<PipelineEdge<In>>& input, Fn&& fn) {
+        add_stage(std::make_unique<PipelineStage<In, void>>(
+                      std::move(config), input, nullptr, std::forward<Fn>(fn)),
+                  input);
+    }
+
+    bool start();
+    // Closes each stage's input so it stops without waiting for items, then
+    // drops the items left on the edges, so none outlives what it refers to
+    void stop();
+
+    std::vector<StageStats> stats() const;
+
+   private:
+    struct Node {
+        std::string name;
+        std::unique_ptr<Service> stage;
+        std::function<uint64_t()> processed;
+        std::function<uint64_t()> dropped;
+        std::function<void()> close_input;
+        const LatencyHistogram* latency;
+    };
+
+    struct Edge {
+        std::shared_ptr<void> owner;
+        std::function<void()> reopen;
+        std::function<void()> drain;
+    };
+
+    template <typename T>
+    void add_edge(const std::shared_ptr<PipelineEdge<T>>& edge) {
+        edges_.push_back(Edge{
+            .owner = edge,
+            .reopen = [raw = edge.get()]() { raw->reopen(); },
+            .drain = [raw = edge.get()]() { raw->drain(); },
+        });
+    }
+
+    template <typename In, typename Out>
+    void add_stage(std::unique_ptr<PipelineStage<In, Out>> stage,
+                   const std::shared_ptr<PipelineEdge<In>>& input) {
+        PipelineStage<In, Out>* raw = stage.get();
+        nodes_.push_back(Node{
+            .name = raw->name(),
+            .stage = std::move(stage),
+            .processed = [raw]() { return raw->processed(); },
+            .dropped = [edge = input.get()]() { return edge->dropped(); },
+            .close_input = [edge = input.get()]() { edge->close(); },
+            .latency = &raw->latency(),
+        });
+    }
+
+    std::vector<Edge> edges_;
+    std::vector<Node> nodes_;
+    bool running_ = false;
+};
+
+}  // namespace pallas
@@ -6,16 +6,48 @@
 #include <string>
 #include <thread>
 
+#include "event_loop.h"
+#include "histogram.h"
+
 namespace pallas {
 
+// What a periodic service does when a tick runs past its next deadline
+enum class OverrunPolicy {
+    Skip,     // Drop the missed periods and stay on the original phase
+    CatchUp,  // Run the missed ticks back to back, up to a bounded backlog
+};
+
 struct ServiceConfig {
     std::string name;
     std::uint16_t port;
+    // 0 = tick() paces itself, e.g. by blocking on input. For event-driven
+    // services, > 0 adds a periodic timer source
     double interval_ms;
+    int cpu_core{-1};    // Core to pin the service thread to, -1 = any
+    int realtime_priority{0};  // SCHED_FIFO priority 1-99, 0 = not real-time
+    OverrunPolicy overrun_policy{OverrunPolicy::Skip};
 
     std::string to_string() const;
 };
 
+/**
+ * A thread that calls tick() until stopped.
+ *
+ * Periodic services run on absolute deadlines on CLOCK_MONOTONIC, so the
+ * period does not drift with the tick's own duration and is not rounded to
+ * whole milliseconds. A tick that overruns its deadline is handled by the
+ * service's OverrunPolicy, and overruns are logged at most once a second.
+ * The thread can be pinned to a core and given SCHED_FIFO priority.
+ *
+ * A service that registers readiness sources on events() before start()
+ * is event-driven instead: tick() runs once at startup and then once per
+ * wake-up in which any source fired, e.g. a queue push, a socket or a
+ * timer, and the thread sleeps in epoll in between. tick() should drain
+ * everything that is ready and return without blocking.
+ *
+ * Tick durations and, for periodic services, how late each tick started
+ * are kept in histograms that anyone may read while the service runs.
+ */
 class Service {
    public:
     Service();
@@ -24,13 +56,44 @@ class Service {
     virtual bool start(); 
     virtual void stop();
 
+    const std::string& name() const { return base_config_.name; }
+
+    // How long each tick() took
+    const LatencyHistogram& tick_latency() const { return tick_latency_; }
+    // How far past its deadline each periodic tick started
+    const LatencyHistogram& wakeup_latency() const { return wakeup_latency_; }
+    // Ticks that ran past the next deadline
+    uint64_t overruns() const {
+        return overruns_.load(std::memory_order_relaxed);
+    }
+
    protected:
     virtual std::expected<void, std::string> tick() = 0;
 
+    // Readiness sources that drive an event-driven service. Sources may be
+    // changed from tick(), and are all removed when the service stops
+    EventLoop& events() { return events_; }
+
    private:
+    void run();
+    void run_periodic();
+    void run_events();
+    // Moves the deadline past a tick that ended at end_ns, overran or not
+    void schedule_next(int64_t& deadline_ns, int64_t period_ns,
+                       int64_t end_ns);
+
     std::thread thread_;
     std::atomic<bool> running_;
     ServiceConfig base_config_;
+    EventLoop events_;
+    LatencyHistogram tick_latency_;
+    LatencyHistogram wakeup_latency_;
+    std::atomic<uint64_t> overruns_{0};
+    // Overruns since the last overrun warning, which is rate-limited
+    uint64_t unlogged_overruns_ = 0;
+    int64_t last_overrun_log_ns_ = 0;
+    // Tick failures are logged at most once a second
+    std::atomic<int64_t> next_failure_log_ns_{0};
 };
 
 std::ostream& operator<<(std::ostream& os, const ServiceConfig& config);
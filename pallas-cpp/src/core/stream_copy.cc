@@ -0,0 +1,169 @@
+#include "stream_copy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace pallas {
+namespace {
+// Below this the copy fits comfortably in cache and memcpy wins
+constexpr size_t STREAM_THRESHOLD = 64 * 1024;
+// How far ahead of the loads to prefetch
+constexpr size_t PREFETCH_DISTANCE = 2048;
+
+using CopyFn = void (*)(void*, const void*, size_t);
+
+void memcpy_copy(void* dst, const void* src, size_t size) {
+    std::memcpy(dst, src, size);
+}
+
+#if defined(__x86_64__)
+// Copies the unaligned head with memcpy so the vector loop can issue aligned
+// stores, and returns how many bytes it copied.
+size_t align_head(uint8_t* dst, const uint8_t* src, size_t size,
+                  size_t alignment) {
+    const size_t misalignment = reinterpret_cast<uintptr_t>(dst) % alignment;
+    const size_t head =
+        misalignment == 0 ? 0 : std::min(size, alignment - misalignment);
+    std::memcpy(dst, src, head);
+    return head;
+}
+
+__attribute__((target("avx2"))) void avx2_copy_to(void* dst_ptr,
+                                                  const void* src_ptr,
+                                                  size_t size) {
+    auto* dst = static_cast<uint8_t*>(dst_ptr);
+    const auto* src = static_cast<const uint8_t*>(src_ptr);
+    size_t offset = align_head(dst, src, size, 32);
+
+    for (; offset + 128 <= size; offset += 128) {
+        _mm_prefetch(reinterpret_cast<const char*>(src + offset +
+                                                   PREFETCH_DISTANCE),
+                     _MM_HINT_NTA);
+        const __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 32));
+        const __m256i c = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 64));
+        const __m256i d = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + offset), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + offset + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + offset + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + offset + 96), d);
+    }
+    // Order the streaming stores before whatever publishes the data
+    _mm_sfence();
+    std::memcpy(dst + offset, src + offset, size - offset);
+}
+
+__attribute__((target("avx512f"))) void avx512_copy_to(void* dst_ptr,
+                                                      const void* src_ptr,
+                                                      size_t size) {
+    auto* dst = static_cast<uint8_t*>(dst_ptr);
+    const auto* src = static_cast<const uint8_t*>(src_ptr);
+    size_t offset = align_head(dst, src, size, 64);
+
+    for (; offset + 256 <= size; offset += 256) {
+        _mm_prefetch(reinterpret_cast<const char*>(src + offset +
+                                                   PREFETCH_DISTANCE),
+                     _MM_HINT_NTA);
+        const __m512i a = _mm512_loadu_si512(src + offset);
+        const __m512i b = _mm512_loadu_si512(src + offset + 64);
+        const __m512i c = _mm512_loadu_si512(src + offset + 128);
+        const __m512i d = _mm512_loadu_si512(src + offset + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + offset), a);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + offset + 64), b);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + offset + 128), c);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + offset + 192), d);
+    }
+    _mm_sfence();
+    std::memcpy(dst + offset, src + offset, size - offset);
+}
+
+// Regular aligned stores with a software prefetch far enough ahead to cover
+// DRAM latency. The source was written with streaming stores by another core
+// so it is never in our cache. NTA prefetches measured ~2x slower here, and
+// glibc memcpy switches to non-temporal stores at these sizes, which would
+// leave the destination cold for the caller that is about to read it.
+__attribute__((target("avx2"))) void avx2_copy_from(void* dst_ptr,
+                                                    const void* src_ptr,
+                                                    size_t size) {
+    auto* dst = static_cast<uint8_t*>(dst_ptr);
+    const auto* src = static_cast<const uint8_t*>(src_ptr);
+    size_t offset = align_head(dst, src, size, 32);
+    for (; offset + 128 <= size; offset += 128) {
+        _mm_prefetch(reinterpret_cast<const char*>(src + offset +
+                                                   PREFETCH_DISTANCE),
+                     _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(src + offset +
+                                                   PREFETCH_DISTANCE + 64),
+                     _MM_HINT_T0);
+        const __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 32));
+        const __m256i c = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 64));
+        const __m256i d = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + offset + 96));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + offset), a);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + offset + 32), b);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + offset + 64), c);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + offset + 96), d);
+    }
+    std::memcpy(dst + offset, src + offset, size - offset);
+}
+#endif
+
+struct Dispatch {
+    CopyFn copy_to = memcpy_copy;
+    CopyFn copy_from = memcpy_copy;
+    const char* isa = "memcpy";
+
+    Dispatch() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            copy_to = avx512_copy_to;
+            copy_from = avx2_copy_from;
+            isa = "avx512";
+        } else if (__builtin_cpu_supports("avx2")) {
+            copy_to = avx2_copy_to;
+            copy_from = avx2_copy_from;
+            isa = "avx2";
+        }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+}  // namespace
+
+void stream_copy_to(void* dst, const void* src, size_t size) {
+    if (size < STREAM_THRESHOLD) {
+        std::memcpy(dst, src, size);
+        return;
+    }
+    dispatch().copy_to(dst, src, size);
+}
+
+void stream_copy_from(void* dst, const void* src, size_t size) {
+    if (size < STREAM_THRESHOLD) {
+        std::memcpy(dst, src, size);
+        return;
+    }
+    dispatch().copy_from(dst, src, size);
+}
+
+const char* stream_copy_isa() { return dispatch().isa; }
+
+}  // namespace pallas
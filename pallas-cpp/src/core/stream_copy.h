@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+namespace pallas {
+
+/**
+ * Bulk copies for frames moving through shared memory, picked at runtime for
+ * the CPU we run on (AVX-512, AVX2, or plain memcpy).
+ *
+ * Frames are ~1 MB and the side that copies them rarely touches them again,
+ * so a regular memcpy evicts the working set of whatever else shares the
+ * core (e.g. ONNX Runtime intra-op threads) for no benefit.
+ */
+
+// Copies into memory this thread will not read back, such as a queue slot,
+// with non-temporal stores that bypass the cache. Small copies use memcpy.
+void stream_copy_to(void* dst, const void* src, size_t size);
+
+// Copies out of memory written by another core, such as a queue slot,
+// prefetching the source ahead of the loads. The destination is written with
+// regular stores so it is warm for the caller that is about to use it.
+void stream_copy_from(void* dst, const void* src, size_t size);
+
+// Name of the implementation selected for this CPU, for logs and benchmarks
+const char* stream_copy_isa();
+
+}  // namespace pallas
@@ -6,6 +6,12 @@
 
 namespace pallas {
 
+int64_t monotonic_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 Timer::Timer(const std::string& name) {
     if (!name.empty()) {
         start(name);
@@ -1,9 +1,14 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
 namespace pallas {
+
+// Nanoseconds on CLOCK_MONOTONIC, comparable between processes on one host
+int64_t monotonic_ns();
+
 /**
  * Usage:
  *     Timer timer{};
@@ -0,0 +1,285 @@
+#include "trace.h"
+
+#include <fmt/format.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "logger.h"
+
+namespace pallas {
+namespace {
+
+constexpr std::size_t EVENTS = Tracer::EVENTS_PER_THREAD;
+static_assert(std::has_single_bit(EVENTS));
+
+// Single-writer ring of one thread's events. Exporters read it while the
+// thread writes, and drop the slots that may have been reused meanwhile
+struct ThreadRing {
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t> begin_ns{0};
+        std::atomic<int64_t> end_ns{0};
+        std::atomic<bool> async{false};
+    };
+
+    pid_t tid = 0;
+    std::string thread_name;
+    std::atomic<uint64_t> exited_order{0};  // Order of exit, 0 while running
+    std::atomic<uint64_t> head{0};  // Events ever recorded
+    std::array<Slot, EVENTS> slots;
+
+    void record(const char* name, int64_t begin_ns, int64_t end_ns,
+                bool async) {
+        const uint64_t index = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[index & (EVENTS - 1)];
+        // Orders the previous head store before the slot is overwritten, so
+        // a reader that sees the new fields also sees the head moved past
+        // the event they replaced
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+        slot.end_ns.store(end_ns, std::memory_order_relaxed);
+        slot.async.store(async, std::memory_order_relaxed);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    std::vector<TraceEvent> events() const {
+        const uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > EVENTS ? end - EVENTS : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(end - begin);
+        for (uint64_t index = begin; index < end; ++index) {
+            const Slot& slot = slots[index & (EVENTS - 1)];
+            events.push_back(TraceEvent{
+                .name = slot.name.load(std::memory_order_relaxed),
+                .begin_ns = slot.begin_ns.load(std::memory_order_relaxed),
+                .end_ns = slot.end_ns.load(std::memory_order_relaxed),
+                .async = slot.async.load(std::memory_order_relaxed),
+            });
+        }
+
+        // The writer may be filling the slot of index `after` - EVENTS
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t after = head.load(std::memory_order_relaxed);
+        if (after >= EVENTS && after - EVENTS + 1 > begin) {
+            const auto torn = std::min<uint64_t>(after - EVENTS + 1 - begin,
+                                                 events.size());
+            events.erase(events.begin(), events.begin() + torn);
+        }
+        return events;
+    }
+};
+
+// Rings of the last threads to exit are kept, so their events are still
+// exported. Leaked, as threads may record while statics are destroyed
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::atomic<uint64_t> exits{0};
+
+    // Frees the rings of all but the last EXITED_THREADS_KEPT threads to
+    // exit. Exporters hold their own references. Holds mutex
+    void prune() {
+        const uint64_t exited = exits.load();
+        const uint64_t kept_after =
+            exited > Tracer::EXITED_THREADS_KEPT
+                ? exited - Tracer::EXITED_THREADS_KEPT
+                : 0;
+        std::erase_if(rings, [kept_after](const auto& ring) {
+            const uint64_t order = ring->exited_order.load();
+            return order != 0 && order <= kept_after;
+        });
+    }
+};
+
+Registry& registry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+// The calling thread's reference to its ring, which marks the ring exited
+// when the thread ends
+struct ThreadRingOwner {
+    std::shared_ptr<ThreadRing> ring;
+
+    ThreadRingOwner() : ring{std::make_shared<ThreadRing>()} {
+        ring->tid = gettid();
+        char name[16] = {};
+        if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+            ring->thread_name = name;
+        }
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().prune();
+        registry().rings.push_back(ring);
+    }
+
+    ~ThreadRingOwner() {
+        ring->exited_order.store(registry().exits.fetch_add(1) + 1);
+    }
+};
+
+ThreadRing& thread_ring() {
+    thread_local const ThreadRingOwner owner;
+    return *owner.ring;
+}
+
+void write_json_string(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << fmt::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Chrome traces count in microseconds
+double to_us(int64_t ns) { return static_cast<double>(ns) / 1e3; }
+
+int dump_fd = -1;  // eventfd the signal handler bumps
+
+void on_dump_signal(int) {
+    const int saved_errno = errno;
+    const uint64_t one = 1;
+    [[maybe_unused]] const auto written = ::write(dump_fd, &one, sizeof(one));
+    errno = saved_errno;
+}
+
+}  // namespace
+
+void Tracer::record(const char* name, int64_t begin_ns, int64_t end_ns,
+                    bool async) {
+    thread_ring().record(name, begin_ns, end_ns, async);
+}
+
+std::vector<TraceEvent> Tracer::thread_events() {
+    return thread_ring().events();
+}
+
+void Tracer::write_chrome_trace(std::ostream& out) {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().prune();
+        rings = registry().rings;
+    }
+
+    const pid_t pid = getpid();
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << fmt::format("{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},"
+                       "\"args\":{{\"name\":",
+                       pid);
+    write_json_string(out, program_invocation_short_name);
+    out << "}}";
+
+    uint64_t async_id = 0;
+    for (const auto& ring : rings) {
+        out << fmt::format(",\n{{\"name\":\"thread_name\",\"ph\":\"M\","
+                           "\"pid\":{},\"tid\":{},\"args\":{{\"name\":",
+                           pid, ring->tid);
+        write_json_string(out, ring->thread_name);
+        out << "}}";
+
+        for (const TraceEvent& event : ring->events()) {
+            if (event.name == nullptr) continue;
+            if (event.async) {
+                // Each async span gets its own id, they may overlap freely
+                ++async_id;
+                for (const auto& [phase, ns] :
+                     {std::pair{'b', event.begin_ns},
+                      std::pair{'e', event.end_ns}}) {
+                    out << ",\n{\"name\":";
+                    write_json_string(out, event.name);
+                    out << fmt::format(
+                        ",\"cat\":\"async\",\"ph\":\"{}\",\"id\":{},"
+                        "\"pid\":{},\"tid\":{},\"ts\":{:.3f}}}",
+                        phase, async_id, pid, ring->tid, to_us(ns));
+                }
+            } else {
+                out << ",\n{\"name\":";
+                write_json_string(out, event.name);
+                out << fmt::format(
+                    ",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},"
+                    "\"dur\":{:.3f}}}",
+                    pid, ring->tid, to_us(event.begin_ns),
+                    to_us(event.end_ns - event.begin_ns));
+            }
+        }
+    }
+    out << "\n]}\n";
+}
+
+std::expected<void, std::string> Tracer::write_chrome_trace(
+    const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return std::unexpected(
+            fmt::format("Failed to open {}: {}", path, std::strerror(errno)));
+    }
+    write_chrome_trace(file);
+    file.close();
+    if (!file) {
+        return std::unexpected(fmt::format("Failed to write {}", path));
+    }
+    return {};
+}
+
+bool Tracer::dump_on_signal(std::string path_prefix, int signal) {
+    if (dump_fd >= 0) {
+        LOGW("Trace dumps are already enabled");
+        return false;
+    }
+    dump_fd = eventfd(0, EFD_CLOEXEC);
+    if (dump_fd < 0) {
+        LOGE("Failed to create trace dump eventfd: {}", std::strerror(errno));
+        return false;
+    }
+
+    // Detached: it only waits for signals and must not hold up exit
+    std::thread([fd = dump_fd, prefix = path_prefix]() {
+        pthread_setname_np(pthread_self(), "trace-dump");
+        for (int dumps = 0;; ++dumps) {
+            uint64_t count;
+            if (::read(fd, &count, sizeof(count)) < 0) {
+                if (errno == EINTR) continue;
+                LOGE("Trace dump thread failed: {}", std::strerror(errno));
+                return;
+            }
+            const std::string path =
+                fmt::format("{}-{}-{}.json", prefix, getpid(), dumps);
+            if (auto result = write_chrome_trace(path)) {
+                LOGI("Wrote trace to {}", path);
+            } else {
+                LOGE("{}", result.error());
+            }
+        }
+    }).detach();
+
+    struct sigaction action {};
+    action.sa_handler = on_dump_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(signal, &action, nullptr) != 0) {
+        LOGE("Failed to install trace dump handler for signal {}: {}", signal,
+             std::strerror(errno));
+        return false;
+    }
+    LOGI("Dumping traces to {}-*.json on signal {}", path_prefix, signal);
+    return true;
+}
+
+}  // namespace pallas
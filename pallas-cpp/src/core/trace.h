@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "timer.h"
+
+namespace pallas {
+
+// A finished span on one thread. name points to a string literal
+struct TraceEvent {
+    const char* name;
+    int64_t begin_ns;  // monotonic_ns()
+    int64_t end_ns;
+    // Spans that do not nest with the thread's others, such as the time a
+    // frame spent in a queue before this thread took it
+    bool async;
+};
+
+/**
+ * Flight recorder of timed spans. Each thread appends to its own ring of
+ * EVENTS_PER_THREAD events without locks or allocation, so tracing costs
+ * two clock reads per span and can stay on in production; older events are
+ * overwritten. Readers skip the oldest slot of a full ring, which the
+ * thread may be overwriting. The rings of the last EXITED_THREADS_KEPT
+ * threads to exit are kept for export; older ones are freed, so restarting
+ * services does not grow the recorder.
+ *
+ * The rings are exported as Chrome trace JSON, which chrome://tracing and
+ * ui.perfetto.dev load. Timestamps are CLOCK_MONOTONIC, so traces of
+ * several processes on one host line up.
+ *
+ * Usage:
+ *     void encode() {
+ *         TRACE_SCOPE("stream.encode");
+ *         ...
+ *     }
+ */
+class Tracer {
+   public:
+    static constexpr std::size_t EVENTS_PER_THREAD = 8192;
+    static constexpr std::size_t EXITED_THREADS_KEPT = 16;
+
+    static bool enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+    static void set_enabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Appends a span to the calling thread's ring
+    static void record(const char* name, int64_t begin_ns, int64_t end_ns,
+                       bool async = false);
+
+    // Events still in the calling thread's ring, oldest first
+    static std::vector<TraceEvent> thread_events();
+
+    static void write_chrome_trace(std::ostream& out);
+    static std::expected<void, std::string> write_chrome_trace(
+        const std::string& path);
+
+    // Writes a trace to <path_prefix>-<pid>-<n>.json each time the process
+    // receives `signal`. The file is written by a helper thread, as a
+    // signal handler cannot allocate
+    static bool dump_on_signal(std::string path_prefix, int signal = SIGUSR2);
+
+   private:
+    static inline std::atomic<bool> enabled_{true};
+};
+
+// Records the span from its construction to the end of the scope. Takes a
+// string literal only, so events can keep the pointer
+class TraceScope {
+   public:
+    template <std::size_t N>
+    explicit TraceScope(const char (&name)[N])
+        : name_{name}, begin_ns_{Tracer::enabled() ? monotonic_ns() : 0} {}
+    ~TraceScope() {
+        if (begin_ns_ != 0) {
+            Tracer::record(name_, begin_ns_, monotonic_ns());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+   private:
+    const char* name_;
+    int64_t begin_ns_;
+};
+
+#define PALLAS_TRACE_CONCAT_(a, b) a##b
+#define PALLAS_TRACE_CONCAT(a, b) PALLAS_TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    ::pallas::TraceScope PALLAS_TRACE_CONCAT(trace_scope_, __LINE__) { name }
+
+}  // namespace pallas
@@ -1,6 +1,8 @@
 #include "camera_service.h"
 
 #include <core/logger.h>
+#include <core/timer.h>
+#include <core/trace.h>
 
 #include <expected>
 #include <filesystem>
@@ -15,6 +17,7 @@ CameraService::CameraService(CameraServiceConfig config)
     : Service(std::move(config.base)),
       shared_memory_name_{config.shared_memory_name},
       shared_memory_frame_capacity_{config.shared_memory_frame_capacity},
+      shared_memory_options_{config.shared_memory_options},
       queue_{nullptr} {
     LOGI(
         "Initializing CameraService with shared memory queue {} with {} frame "
@@ -24,11 +27,6 @@ CameraService::CameraService(CameraServiceConfig config)
 }
 
 bool CameraService::start() {
-    // Cleanup any previously existing shared memory and reinitalize the buffer
-    Queue::Close(shared_memory_name_);
-    queue_ = std::make_unique<Queue>(
-        Queue::Create(shared_memory_name_, shared_memory_frame_capacity_));
-
     // Open the webcam stream
     capture_ = cv::VideoCapture(0);
     if (!capture_.isOpened()) {
@@ -39,6 +37,28 @@ bool CameraService::start() {
     capture_.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
     capture_.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
 
+    // Size the queue for the resolution the camera actually delivers
+    int width = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    if (width <= 0 || height <= 0) {
+        // Some backends do not report the size, take it from a frame
+        cv::Mat probe;
+        if (!capture_.read(probe) || probe.empty()) {
+            LOGE("Webcam reports no frame size and delivered no frame");
+            capture_.release();
+            return false;
+        }
+        width = probe.cols;
+        height = probe.rows;
+    }
+    LOGI("Webcam delivers {}x{} frames", width, height);
+
+    // Cleanup any previously existing shared memory and reinitalize the buffer
+    Queue::Close(shared_memory_name_);
+    queue_ = std::make_unique<Queue>(Queue::Create(
+        shared_memory_name_, shared_memory_frame_capacity_,
+        FrameGeometry::Of(height, width, CV_8UC3), shared_memory_options_));
+
     std::filesystem::create_directories("./camera_service");
 
     return Service::start();
@@ -54,15 +74,25 @@ std::expected<void, std::string> CameraService::tick() {
         return std::unexpected("Failed to open camera on tick.");
     }
 
+    // Stamp the frame as soon as the driver hands it over, before decoding
     cv::Mat frame;
-    capture_ >> frame;
+    FrameInfo info;
+    {
+        TRACE_SCOPE("camera.capture");
+        const bool grabbed = capture_.grab();
+        info = {.sequence = frame_sequence_++, .capture_ns = monotonic_ns()};
+        if (grabbed) {
+            capture_.retrieve(frame);
+        }
+    }
 
     if (frame.empty()) {
         return std::unexpected("Failed to capture non-empty frame on tick.");
     }
 
     // Write the frame to shared memory
-    if (!queue_->try_push(frame)) {
+    TRACE_SCOPE("queue.push");
+    if (!queue_->try_push(frame, info)) {
         return std::unexpected("Failed to push frame on tick.");
     }
 
@@ -16,6 +16,7 @@ struct CameraServiceConfig {
     ServiceConfig base;
     std::string shared_memory_name;
     std::size_t shared_memory_frame_capacity;
+    SharedMemoryOptions shared_memory_options;
 };
 
 class CameraService : public Service {
@@ -30,11 +31,13 @@ class CameraService : public Service {
     std::expected<void, std::string> tick() override;
 
    private:
-    using Queue = MatQueue<2764800>;
+    using Queue = MatQueue;
 
     std::string shared_memory_name_;
     std::size_t shared_memory_frame_capacity_;
+    SharedMemoryOptions shared_memory_options_;
     cv::VideoCapture capture_;
+    uint64_t frame_sequence_ = 0;
     std::unique_ptr<Queue> queue_;
 };
 }  // namespace pallas
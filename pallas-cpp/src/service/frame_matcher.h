@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace pallas {
+
+/**
+ * Groups frames from several streams into sets captured at the same instant.
+ *
+ * Each stream's frames are added in capture order with their capture time.
+ * A set is complete when every stream has a frame within `tolerance_ns` of
+ * the newest of them. A frame that is older than the newest head by more than
+ * the tolerance can never be matched (the other streams only move forward),
+ * so it is discarded and counted as unmatched. At most `max_pending` frames
+ * are held per stream, which bounds the state when one stream stalls.
+ *
+ * Frame may be move-only, e.g. a FrameLease that pins a queue slot.
+ */
+template <typename Frame>
+class FrameMatcher {
+   public:
+    struct Pending {
+        Frame frame;
+        int64_t capture_ns = 0;
+    };
+
+    FrameMatcher(size_t stream_count, int64_t tolerance_ns,
+                 size_t max_pending = 4)
+        : pending_(stream_count),
+          tolerance_ns_(tolerance_ns),
+          max_pending_(std::max<size_t>(max_pending, 1)) {}
+
+    // Adds the next frame of a stream
+    void add(size_t stream, Frame frame, int64_t capture_ns) {
+        auto& queue = pending_[stream];
+        if (queue.size() == max_pending_) {
+            queue.pop_front();
+            ++unmatched_;
+        }
+        queue.push_back(Pending{std::move(frame), capture_ns});
+    }
+
+    // Takes the oldest complete set, one frame per stream in stream order,
+    // or returns false if there is none yet
+    bool match(std::vector<Pending>& set) {
+        if (pending_.empty()) return false;
+
+        while (true) {
+            int64_t newest = INT64_MIN;
+            for (const auto& queue : pending_) {
+                if (queue.empty()) return false;
+                newest = std::max(newest, queue.front().capture_ns);
+            }
+
+            bool matched = true;
+            for (auto& queue : pending_) {
+                while (!queue.empty() &&
+                       queue.front().capture_ns < newest - tolerance_ns_) {
+                    queue.pop_front();
+                    ++unmatched_;
+                }
+                if (queue.empty()) return false;
+                // The new head may be newer than `newest`; look again
+                matched = matched && queue.front().capture_ns <= newest;
+            }
+            if (!matched) continue;
+
+            set.clear();
+            for (auto& queue : pending_) {
+                set.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            ++matched_;
+            return true;
+        }
+    }
+
+    // Drops a stream's waiting frames, e.g. before the queue they live in
+    // goes away
+    void clear(size_t stream) {
+        unmatched_ += pending_[stream].size();
+        pending_[stream].clear();
+    }
+
+    // Frames currently waiting for a match, across all streams
+    size_t pending() const {
+        size_t count = 0;
+        for (const auto& queue : pending_) count += queue.size();
+        return count;
+    }
+
+    size_t stream_count() const { return pending_.size(); }
+    uint64_t matched() const { return matched_; }
+    uint64_t unmatched() const { return unmatched_; }
+
+   private:
+    std::vector<std::deque<Pending>> pending_;
+    int64_t tolerance_ns_;
+    size_t max_pending_;
+    uint64_t matched_ = 0;
+    uint64_t unmatched_ = 0;
+};
+
+}  // namespace pallas
@@ -0,0 +1,178 @@
+#include "frame_synchronizer.h"
+
+#include <core/logger.h>
+#include <core/stream_copy.h>
+#include <core/timer.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace pallas {
+
+namespace {
+
+// An input that delivers nothing for this long is reopened
+constexpr int64_t INPUT_STALE_NS = 2'000'000'000;
+// How often missing or stale inputs are retried
+constexpr auto INPUT_RETRY = std::chrono::milliseconds(500);
+
+}  // namespace
+
+FrameSynchronizer::FrameSynchronizer(FrameSynchronizerConfig config)
+    : Service(config.base),
+      config_(std::move(config)),
+      matcher_(config_.input_queue_names.size(), config_.tolerance_ns,
+               config_.max_pending) {
+    inputs_.reserve(config_.input_queue_names.size());
+    for (const auto& name : config_.input_queue_names) {
+        inputs_.push_back(Input{.name = name});
+    }
+    LOGI(
+        "Initializing FrameSynchronizer over {} queues into {} with {:.2f} ms "
+        "tolerance.",
+        inputs_.size(), config_.output_queue_name,
+        config_.tolerance_ns / 1e6);
+}
+
+// Stop the thread before the leases and queues it works on are destroyed
+FrameSynchronizer::~FrameSynchronizer() { stop(); }
+
+bool FrameSynchronizer::start() {
+    if (inputs_.empty()) {
+        LOGE("FrameSynchronizer has no input queues");
+        return false;
+    }
+    // Pushes to the inputs drive the ticks, the timer only reopens inputs.
+    // A previous stop() removed the watches, so inputs that are still open
+    // are watched again; open_inputs() watches the others as they open
+    events().add_timer(INPUT_RETRY);
+    const int64_t now = monotonic_ns();
+    for (Input& input : inputs_) {
+        if (!input.queue.is_valid()) continue;
+        input.queue.watch(events());
+        input.last_frame_ns = now;
+    }
+    return Service::start();
+}
+
+void FrameSynchronizer::stop() {
+    Service::stop();
+    // Leases must be released before their queues are unmapped
+    for (std::size_t i = 0; i < inputs_.size(); ++i) matcher_.clear(i);
+    set_.clear();
+}
+
+bool FrameSynchronizer::open_inputs() {
+    const int64_t now = monotonic_ns();
+    bool all_open = true;
+    for (std::size_t i = 0; i < inputs_.size(); ++i) {
+        Input& input = inputs_[i];
+        const bool stale = input.queue.is_valid() &&
+                           now - input.last_frame_ns > INPUT_STALE_NS;
+        if (input.queue.is_valid() && !stale) continue;
+
+        matcher_.clear(i);
+        input.queue.unwatch(events());
+        input.queue = MatQueue::Open(input.name);
+        input.last_frame_ns = now;
+        if (!input.queue.is_valid()) {
+            all_open = false;
+            continue;
+        }
+        input.queue.watch(events());
+        if (stale) {
+            LOGW("Input queue {} went quiet, reopened it", input.name);
+        }
+    }
+    return all_open;
+}
+
+std::size_t FrameSynchronizer::poll() {
+    const int64_t now = monotonic_ns();
+    for (std::size_t i = 0; i < inputs_.size(); ++i) {
+        Input& input = inputs_[i];
+        if (!input.queue.is_valid()) continue;
+
+        FrameLease lease;
+        while (input.queue.try_acquire(lease)) {
+            const int64_t capture_ns = lease.info().capture_ns;
+            matcher_.add(i, std::move(lease), capture_ns);
+            input.last_frame_ns = now;
+        }
+    }
+
+    std::size_t published = 0;
+    while (matcher_.match(set_)) {
+        if (publish(set_)) ++published;
+        set_.clear();  // Releases the leases
+    }
+    return published;
+}
+
+bool FrameSynchronizer::publish(
+    std::vector<FrameMatcher<FrameLease>::Pending>& set) {
+    const cv::Mat& first = set.front().frame.mat();
+    int rows = 0;
+    int64_t earliest_ns = set.front().capture_ns;
+    int64_t latest_ns = set.front().capture_ns;
+    for (const auto& view : set) {
+        const cv::Mat& mat = view.frame.mat();
+        if (mat.cols != first.cols || mat.type() != first.type()) {
+            LOGE("FrameSynchronizer inputs differ in width or pixel type");
+            return false;
+        }
+        rows += mat.rows;
+        earliest_ns = std::min(earliest_ns, view.capture_ns);
+        latest_ns = std::max(latest_ns, view.capture_ns);
+    }
+
+    // Size the output for the first set, and again if the inputs change
+    if (!output_ || rows != output_rows_ || first.cols != output_cols_ ||
+        first.type() != output_type_) {
+        MatQueue::Close(config_.output_queue_name);
+        output_ = std::make_unique<MatQueue>(MatQueue::Create(
+            config_.output_queue_name, config_.output_frame_capacity,
+            FrameGeometry::Of(rows, first.cols, first.type()),
+            config_.shared_memory_options));
+        output_rows_ = rows;
+        output_cols_ = first.cols;
+        output_type_ = first.type();
+        LOGI("FrameSynchronizer publishing {}x{} sets of {} views to {}",
+             first.cols, rows, set.size(), config_.output_queue_name);
+    }
+
+    cv::Mat slot = output_->reserve_slot(rows, first.cols, first.type());
+    if (slot.empty()) {
+        LOGW("Failed to reserve a slot in {}, dropping a matched set",
+             config_.output_queue_name);
+        return false;
+    }
+
+    int row = 0;
+    for (const auto& view : set) {
+        const cv::Mat& mat = view.frame.mat();
+        cv::Mat target = slot.rowRange(row, row + mat.rows);
+        if (mat.isContinuous()) {
+            stream_copy_to(target.data, mat.data, mat.total() * mat.elemSize());
+        } else {
+            mat.copyTo(target);
+        }
+        row += mat.rows;
+    }
+
+    LOGD("Matched set {} with {:.3f} ms spread", set_sequence_,
+         (latest_ns - earliest_ns) / 1e6);
+    output_->commit_slot(
+        FrameInfo{.sequence = set_sequence_++, .capture_ns = earliest_ns});
+    return true;
+}
+
+std::expected<void, std::string> FrameSynchronizer::tick() {
+    if (!open_inputs()) {
+        return std::unexpected("Waiting for input queues");
+    }
+    poll();
+    return {};
+}
+
+}  // namespace pallas
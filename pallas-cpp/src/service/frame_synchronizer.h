@@ -0,0 +1,81 @@
+#pragma once
+
+#include <core/service.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_matcher.h"
+#include "mat_queue.h"
+
+namespace pallas {
+
+struct FrameSynchronizerConfig {
+    ServiceConfig base;  // interval_ms = 0, it waits on its inputs
+    std::vector<std::string> input_queue_names;  // e.g. ps3-0, ps3-1
+    std::string output_queue_name;
+    std::size_t output_frame_capacity;
+    int64_t tolerance_ns;     // Largest capture time spread within a set
+    std::size_t max_pending{4};  // Frames held per input while unmatched
+    SharedMemoryOptions shared_memory_options;
+};
+
+/**
+ * Matches frames from several camera queues by capture time and publishes
+ * each matched set as one frame of a combined queue.
+ *
+ * A set holds one frame per input, all captured within the tolerance of each
+ * other according to FrameInfo::capture_ns. The views are stacked top to
+ * bottom in input order, so a consumer splits a set with
+ * rowRange(i * rows, (i + 1) * rows). The set's FrameInfo carries its own
+ * sequence and the capture time of its earliest view. Inputs must share
+ * width and pixel type.
+ *
+ * Unmatched frames are leased while they wait, so they are never copied;
+ * only matched sets are copied, once, into the output queue.
+ */
+class FrameSynchronizer : public Service {
+   public:
+    FrameSynchronizer(FrameSynchronizerConfig config);
+    ~FrameSynchronizer() override;
+    bool start() override;
+    void stop() override;
+
+    // Takes every frame the inputs have ready and publishes each complete
+    // set. Returns the number of sets published.
+    std::size_t poll();
+
+    uint64_t matched() const { return matcher_.matched(); }
+    uint64_t unmatched() const { return matcher_.unmatched(); }
+
+   protected:
+    std::expected<void, std::string> tick() override;
+
+   private:
+    struct Input {
+        std::string name;
+        MatQueue queue;
+        int64_t last_frame_ns = 0;  // When it last delivered a frame
+    };
+
+    // Opens inputs that are missing or that went quiet, e.g. because their
+    // producer restarted and recreated the queue. Returns true if all are
+    // open.
+    bool open_inputs();
+    bool publish(std::vector<FrameMatcher<FrameLease>::Pending>& set);
+
+    FrameSynchronizerConfig config_;
+    std::vector<Input> inputs_;
+    FrameMatcher<FrameLease> matcher_;
+    std::vector<FrameMatcher<FrameLease>::Pending> set_;
+    std::unique_ptr<MatQueue> output_;
+    int output_rows_ = 0;
+    int output_cols_ = 0;
+    int output_type_ = -1;
+    uint64_t set_sequence_ = 0;
+};
+}  // namespace pallas
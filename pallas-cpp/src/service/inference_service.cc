@@ -1,13 +1,15 @@
 #include "inference_service.h"
 
 #include <core/logger.h>
-#include <core/timer.h>
+#include <core/trace.h>
 
 #include <expected>
 #include <iostream>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/imgproc.hpp>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "mat_queue_utils.h"
 
@@ -24,6 +26,9 @@ InferenceService::InferenceService(InferenceServiceConfig config)
          fmt::join(config_.shared_memory_names, ","));
 }
 
+// Stop the thread and its queue watches before the queues are unmapped
+InferenceService::~InferenceService() { stop(); }
+
 bool InferenceService::start() {
     auto open_result =
         utils::open_verified_queues<Queue>(config_.shared_memory_names);
@@ -32,9 +37,14 @@ bool InferenceService::start() {
     }
     queue_by_name_ = std::move(*open_result);
 
-    // Initailize vision models: YOLO (ctor) and SAM2
-    sam_.loadModel(config_.sam_encoder_path, config_.sam_decoder_path,
-                   std::thread::hardware_concurrency(),
+    // Tick when a producer pushes instead of polling on an interval
+    for (const auto& [name, queue_ptr] : queue_by_name_) {
+        queue_ptr->watch(events());
+    }
+
+    // Initailize vision models: YOLO (ctor) and SAM2, both on the shared
+    // ONNX Runtime thread pools
+    sam_.loadModel(config_.sam_encoder_path, config_.sam_decoder_path, 0,
                    config_.use_gpu ? "gpu" : "cpu");
 
     return Service::start();
@@ -53,39 +63,49 @@ void InferenceService::setFrameProcessingRate(int every_n_frames) {
 }
 
 std::expected<void, std::string> InferenceService::tick() {
-    LOGI("InferenceService::tick()");
+    LOGT("InferenceService::tick()");
 
-    Timer timer{};
-    bool process_this_frame = (frame_counter_++ % process_every_n_frames_ == 0);
-    
+    std::vector<std::pair<cv::Mat, FrameInfo>> frames;
     for (const auto& [name, queue_ptr] : queue_by_name_) {
         if (!queue_ptr) {
             LOGE("Invalid queue for {}", name);
             continue;
         }
-
         cv::Mat frame;
-        if (!queue_ptr->try_pop(frame)) {
-            LOGW("Failed to pop frame.");
-        }
-        if (frame.empty()) {
-            continue;
-        }
-        
-        // Skip processing on some frames to improve performance
-        if (!process_this_frame) {
-            LOGD("Skipping frame {} for performance", frame_counter_);
-            continue;
+        if (queue_ptr->try_pop_latest(frame) && !frame.empty()) {
+            frames.emplace_back(std::move(frame), queue_ptr->last_info());
         }
-        
-        // Check if there are any people with YOLO; thresholds match Ultralytics
-        // default
-        const float confidence_threshold = 0.25f;
-        const float iou_threshold = 0.45f;
-        timer.start("yolo detect");
-        const auto& detections =
-            yolo_.detect(frame, confidence_threshold, iou_threshold);
-        timer.log_ms("yolo detect");
+    }
+    if (frames.empty()) {
+        return std::expected<void, std::string>{};
+    }
+
+    bool process_this_frame = (frame_counter_++ % process_every_n_frames_ == 0);
+    // Skip processing on some frames to improve performance
+    if (!process_this_frame) {
+        LOGD("Skipping frame {} for performance", frame_counter_);
+        return std::expected<void, std::string>{};
+    }
+
+    // Check if there are any people with YOLO; thresholds match Ultralytics
+    // default. All cameras go through one batched run
+    const float confidence_threshold = 0.25f;
+    const float iou_threshold = 0.45f;
+    std::vector<cv::Mat> images;
+    images.reserve(frames.size());
+    for (const auto& [frame, info] : frames) {
+        images.push_back(frame);
+    }
+    std::vector<std::vector<Detection>> results;
+    {
+        TRACE_SCOPE("inference.detect");
+        results = yolo_.detect_batch(images, confidence_threshold,
+                                     iou_threshold);
+    }
+
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        auto& [frame, info] = frames[i];
+        const auto& detections = results[i];
         if (detections.empty()) {
             continue;
         }
@@ -96,12 +116,15 @@ std::expected<void, std::string> InferenceService::tick() {
             }
 
             // Have a frame with a person, pass the result to SAM.
+            LOGI_EVERY_MS(1000,
+                          "Person in frame {} ({:.1f} ms after capture, {} "
+                          "dropped)",
+                          info.sequence, info.age_ms(), info.dropped);
             // TODO: Get cv::Mat of just the person.
             const cv::Size sam_size = sam_.getInputSize();
             cv::resize(frame, frame, sam_size);
-            timer.start("sam preprocess");
+            TRACE_SCOPE("sam.preprocess");
             sam_.preprocessImage(frame);
-            timer.log_ms("sam preprocess");
         }
     }
 
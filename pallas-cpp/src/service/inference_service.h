@@ -34,6 +34,7 @@ class InferenceService : public Service {
     using Service::Service;
 
     InferenceService(InferenceServiceConfig config);
+    ~InferenceService() override;
     bool start() override;
     void stop() override;
     
@@ -41,7 +42,7 @@ class InferenceService : public Service {
     void setFrameProcessingRate(int every_n_frames);
 
    protected:
-    using Queue = MatQueue<2764800>;  // MacOS frame size
+    using Queue = MatQueue;
 
     std::expected<void, std::string> tick() override;
 
@@ -1,20 +1,169 @@
 #pragma once
+#include <core/event_loop.h>
+#include <core/futex.h>
 #include <core/logger.h>
+#include <core/stream_copy.h>
+#include <core/timer.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <fmt/format.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <opencv2/core.hpp>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "shared_memory.h"
 
 namespace pallas {
 
-template <size_t MAX_FRAME_SIZE>
+/**
+ * Where a frame came from. Stored with every frame in the queue so consumers
+ * can measure its age and notice lost frames.
+ */
+struct FrameInfo {
+    uint64_t sequence = 0;   // Per-camera frame number; gaps are lost frames
+    int64_t capture_ns = 0;  // monotonic_ns() when the frame was captured
+    uint64_t dropped = 0;    // Frames the producer lost before this one
+
+    double age_ms() const { return (monotonic_ns() - capture_ns) / 1e6; }
+};
+
+/**
+ * RAII pin on a frame that lives in a shared-memory queue slot.
+ *
+ * While a lease is held the producer skips the slot instead of overwriting
+ * it, so mat() can be used in place (e.g. for detection or encoding) without
+ * copying. Leases are move-only and release the pin on destruction.
+ */
+class FrameLease {
+   public:
+    FrameLease() = default;
+    // `pins` is the slot's pin count, `owner_pins` the leasing consumer's
+    // share of it, which lets the producer reap leases of dead consumers
+    FrameLease(std::atomic<uint32_t>* pins, std::atomic<uint32_t>* owner_pins,
+               cv::Mat mat, const FrameInfo& info)
+        : pins_{pins},
+          owner_pins_{owner_pins},
+          mat_{std::move(mat)},
+          info_{info} {}
+    ~FrameLease() { release(); }
+
+    FrameLease(const FrameLease&) = delete;
+    FrameLease& operator=(const FrameLease&) = delete;
+
+    FrameLease(FrameLease&& other) noexcept
+        : pins_{std::exchange(other.pins_, nullptr)},
+          owner_pins_{std::exchange(other.owner_pins_, nullptr)},
+          mat_{std::move(other.mat_)},
+          info_{other.info_} {
+        other.mat_ = cv::Mat();
+    }
+
+    FrameLease& operator=(FrameLease&& other) noexcept {
+        if (this != &other) {
+            release();
+            pins_ = std::exchange(other.pins_, nullptr);
+            owner_pins_ = std::exchange(other.owner_pins_, nullptr);
+            mat_ = std::move(other.mat_);
+            info_ = other.info_;
+            other.mat_ = cv::Mat();
+        }
+        return *this;
+    }
+
+    void release() {
+        mat_ = cv::Mat();
+        if (pins_) {
+            owner_pins_->fetch_sub(1, std::memory_order_relaxed);
+            pins_->fetch_sub(1, std::memory_order_release);
+            pins_ = nullptr;
+            owner_pins_ = nullptr;
+        }
+    }
+
+    bool valid() const { return pins_ != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    // Read-only view of the pinned frame in shared memory
+    const cv::Mat& mat() const { return mat_; }
+
+    const FrameInfo& info() const { return info_; }
+
+   private:
+    std::atomic<uint32_t>* pins_ = nullptr;
+    std::atomic<uint32_t>* owner_pins_ = nullptr;
+    cv::Mat mat_;
+    FrameInfo info_;
+};
+
+// Identifies an initialized MatQueue, and which layout it uses, in the shm
+constexpr uint32_t MAT_QUEUE_MAGIC = 0x5051544d;  // "MTQP"
+constexpr uint32_t MAT_QUEUE_LAYOUT_VERSION = 3;
+
+// Consumers that can be attached to one queue at the same time
+constexpr size_t MAT_QUEUE_MAX_CONSUMERS = 64;
+// A consumer that has not touched the queue for this long is reaped once its
+// process is gone
+constexpr auto CONSUMER_REAP_TIMEOUT = std::chrono::seconds(5);
+
+// Accepts frames of any OpenCV type
+constexpr int ANY_PIXEL_TYPE = -1;
+
+/**
+ * Shape of the frames a MatQueue carries, chosen by the producer at Create()
+ * and stored in the queue header so consumers do not need to know it.
+ */
+struct FrameGeometry {
+    size_t max_frame_size = 0;       // Largest frame in bytes a slot holds
+    int pixel_type = ANY_PIXEL_TYPE;  // OpenCV type every frame must have
+
+    static FrameGeometry Of(int rows, int cols, int pixel_type) {
+        return {static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(pixel_type),
+                pixel_type};
+    }
+};
+
+/**
+ * Single-producer, multi-consumer broadcast queue of cv::Mat frames in
+ * shared memory.
+ *
+ * Frames live in a ring of fixed-stride, page-aligned slots sized by the
+ * FrameGeometry the producer created the queue with. Each slot carries a
+ * seqlock-style sequence number so that the producer never waits on
+ * consumers: when the producer laps a slow consumer that consumer's oldest
+ * frames are dropped, and a consumer that races the producer on a slot
+ * detects the torn read and skips the frame instead of returning corrupted
+ * pixels. Both push and pop are O(1) in the queue depth.
+ *
+ * Every MatQueue object that pops is a separate consumer with its own
+ * cache-line-padded cursor in the shared header, so each consumer sees every
+ * frame. It attaches on its first pop (from the point where it was created
+ * or opened) or explicitly with register_consumer(). Cursors are claimed
+ * with a CAS, and the producer reaps those left behind by dead processes.
+ *
+ * Consumers may instead lease a frame with try_acquire(), which pins its
+ * slot; the producer skips pinned slots until the lease is released.
+ *
+ * Producers that decode frames themselves can skip the copy in try_push():
+ * reserve_slot() hands out a writable view over the next free slot, and
+ * commit_slot() publishes whatever was written into it.
+ *
+ * Instead of polling, consumers can block in wait_pop()/wait_acquire(): they
+ * sleep on a futex word in the queue header that every push bumps. Live
+ * views that only want the freshest frame use try_pop_latest() and
+ * try_acquire_latest() instead of draining the backlog.
+ */
 class MatQueue {
    private:
     struct alignas(64) MatHeader {
@@ -23,159 +172,461 @@ class MatQueue {
         int type;
         size_t data_size;
         size_t step;           // Step size for direct memory access
+        FrameInfo info;
     };
 
-    struct alignas(64) QueueHeader {
-        std::atomic<size_t> write_pos;
-        std::atomic<size_t> read_pos;
-        std::atomic<bool> was_overwritten;
-        size_t capacity;
+    // The sequence is odd while the producer is writing the slot and equals
+    // 2 * lap + 2 once frame (lap * slot_count + slot) has been published.
+    // Pins counts the outstanding FrameLeases on the slot.
+    struct alignas(64) SlotHeader {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint32_t> pins;
+        MatHeader mat;
     };
 
+    struct QueueHeader {
+        // Layout, written once by Create() and validated by Open(). The
+        // magic is stored last so a half-initialized queue is never opened.
+        alignas(64) std::atomic<uint32_t> magic;
+        uint32_t version;
+        size_t slot_count;
+        size_t slot_stride;
+        size_t buffer_offset;  // Start of the first slot from the header
+        size_t max_frame_size;
+        int pixel_type;
+        size_t consumer_capacity;
+        size_t consumers_offset;      // ConsumerSlot table
+        size_t consumer_pins_offset;  // Per-consumer pin counts, per slot
+        alignas(64) std::atomic<uint64_t> write_index;  // Frames published
+        std::atomic<uint64_t> next_sequence;     // Expected next FrameInfo
+        std::atomic<uint64_t> producer_dropped;  // Gaps in FrameInfo sequence
+        alignas(64) std::atomic<uint32_t> push_word;  // Futex bumped per push
+        std::atomic<uint32_t> waiters;  // Consumers sleeping on push_word
+    };
+
+    enum ConsumerState : uint32_t {
+        CONSUMER_FREE = 0,
+        CONSUMER_CLAIMED,  // Being initialized by a registering consumer
+        CONSUMER_ACTIVE,
+        CONSUMER_REAPING,  // Its leases are being returned by the producer
+    };
+
+    // One per cache line, so consumers never contend with each other
+    struct alignas(64) ConsumerSlot {
+        std::atomic<uint32_t> state;
+        std::atomic<int32_t> pid;
+        std::atomic<int64_t> heartbeat_ns;  // steady_clock of the last call
+        std::atomic<uint64_t> read_index;   // Next frame this consumer pops
+        std::atomic<uint64_t> dropped;      // Frames it never saw
+    };
+    static_assert(sizeof(ConsumerSlot) == 64);
+
     void* mapped_memory_ = nullptr;
     QueueHeader* header_ = nullptr;
     uint8_t* buffer_ = nullptr;
     int fd_ = -1;
     std::string name_;
     size_t total_size_ = 0;
+    ConsumerSlot* consumer_ = nullptr;
+    std::atomic<uint32_t>* consumer_pins_ = nullptr;
+    int consumer_id_ = -1;
+    uint64_t attach_index_ = 0;  // First frame a lazily attached consumer sees
+    FrameInfo read_info_;        // Info of the frame being read
+    FrameInfo last_info_;        // Info of the last frame popped
+    bool slot_reserved_ = false;  // reserve_slot() is waiting for a commit
+    uint64_t reserved_index_ = 0;
+    cv::Mat reserved_view_;
 
-    bool copy_to_queue(const cv::Mat& mat, size_t position) {
-        // Get a continuous version of the matrix if needed
-        // This avoids copying if the matrix is already continuous
-        const cv::Mat& continuous = mat.isContinuous() ? mat : mat.clone();
-        size_t data_size = continuous.total() * continuous.elemSize();
+    static size_t round_up(size_t value, size_t alignment) {
+        return ((value + alignment - 1) / alignment) * alignment;
+    }
+
+    SlotHeader* slot_at(uint64_t index) const {
+        return reinterpret_cast<SlotHeader*>(
+            buffer_ + (index % header_->slot_count) * header_->slot_stride);
+    }
+
+    size_t slot_index(const SlotHeader* slot) const {
+        return (reinterpret_cast<const uint8_t*>(slot) - buffer_) /
+               header_->slot_stride;
+    }
+
+    uint8_t* slot_data(SlotHeader* slot) const {
+        return reinterpret_cast<uint8_t*>(slot) + sizeof(SlotHeader);
+    }
+
+    uint64_t published_sequence(uint64_t index) const {
+        return 2 * (index / header_->slot_count) + 2;
+    }
+
+    ConsumerSlot* consumer_at(size_t id) const {
+        return reinterpret_cast<ConsumerSlot*>(
+                   static_cast<uint8_t*>(mapped_memory_) +
+                   header_->consumers_offset) +
+               id;
+    }
+
+    // Row of slot_count pin counters owned by consumer `id`
+    std::atomic<uint32_t>* consumer_pins_at(size_t id) const {
+        return reinterpret_cast<std::atomic<uint32_t>*>(
+                   static_cast<uint8_t*>(mapped_memory_) +
+                   header_->consumer_pins_offset) +
+               id * header_->slot_count;
+    }
+
+    static bool process_alive(int32_t pid) {
+        return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+    }
+
+    // Claims a free cursor starting at frame `start`. Lock-free: a CAS on the
+    // slot state is the only synchronization between registering consumers.
+    bool attach(uint64_t start) {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t id = 0; id < header_->consumer_capacity; ++id) {
+                ConsumerSlot* slot = consumer_at(id);
+                uint32_t expected = CONSUMER_FREE;
+                if (!slot->state.compare_exchange_strong(
+                        expected, CONSUMER_CLAIMED,
+                        std::memory_order_acquire)) {
+                    continue;
+                }
+                slot->pid.store(getpid(), std::memory_order_relaxed);
+                slot->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+                slot->read_index.store(start, std::memory_order_relaxed);
+                slot->dropped.store(0, std::memory_order_relaxed);
+                slot->state.store(CONSUMER_ACTIVE, std::memory_order_release);
+
+                consumer_ = slot;
+                consumer_pins_ = consumer_pins_at(id);
+                consumer_id_ = static_cast<int>(id);
+                return true;
+            }
+            // Full: make room by reaping consumers of dead processes
+            if (reap_dead_consumers() == 0) break;
+        }
+        LOGE("All {} consumer cursors of queue {} are in use",
+             header_->consumer_capacity, name_);
+        return false;
+    }
+
+    bool ensure_consumer() {
+        return consumer_ || attach(attach_index_);
+    }
+
+    // Returns the leases of consumer `id` if it went quiet and its process
+    // has exited. Only the producer and registering consumers call this.
+    bool try_reap(size_t id, std::chrono::nanoseconds idle_for) {
+        ConsumerSlot* slot = consumer_at(id);
+        if (slot->state.load(std::memory_order_acquire) != CONSUMER_ACTIVE)
+            return false;
+        if (monotonic_ns() - slot->heartbeat_ns.load(std::memory_order_relaxed) <
+            idle_for.count())
+            return false;
+        const int32_t pid = slot->pid.load(std::memory_order_relaxed);
+        if (pid == getpid() || process_alive(pid)) return false;
+
+        uint32_t expected = CONSUMER_ACTIVE;
+        if (!slot->state.compare_exchange_strong(expected, CONSUMER_REAPING,
+                                                 std::memory_order_acquire))
+            return false;
+        std::atomic<uint32_t>* pins = consumer_pins_at(id);
+        for (size_t i = 0; i < header_->slot_count; ++i) {
+            const uint32_t held = pins[i].exchange(0, std::memory_order_relaxed);
+            if (held != 0)
+                slot_at(i)->pins.fetch_sub(held, std::memory_order_release);
+        }
+        LOGW("Reaped consumer {} (pid {}) of queue {}", id, pid, name_);
+        slot->state.store(CONSUMER_FREE, std::memory_order_release);
+        return true;
+    }
+
+    // Claims the slot for frame `index` unless a consumer holds a lease on
+    // it. The sequence store and the pin load are ordered against the pin
+    // increment and sequence load in try_acquire() by seq_cst fences, so
+    // either the producer sees the pin or the consumer sees the odd sequence.
+    bool claim_slot(SlotHeader* slot, uint64_t index) {
+        const uint64_t previous =
+            slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(published_sequence(index) - 1,
+                             std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (slot->pins.load(std::memory_order_relaxed) != 0) {
+            // Leave the leased frame untouched
+            slot->sequence.store(previous, std::memory_order_release);
+            return false;
+        }
+        // Synchronize with the last lease release before overwriting
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    // Copies the frame into the slot claimed for `index` and publishes it.
+    void copy_to_queue(const cv::Mat& continuous, size_t data_size,
+                       uint64_t index, const FrameInfo& info) {
+        // The producer never reads the slot back, so keep it out of cache
+        stream_copy_to(slot_data(slot_at(index)), continuous.data, data_size);
+        publish_slot(continuous, data_size, index, info);
+    }
+
+    // Writes the header of the frame already in the slot for `index` and
+    // publishes it to consumers.
+    void publish_slot(const cv::Mat& continuous, size_t data_size,
+                      uint64_t index, const FrameInfo& info) {
+        SlotHeader* slot = slot_at(index);
 
         // Initialize header with step information for zero-copy access
-        MatHeader mat_header{
-            continuous.rows, 
+        slot->mat = MatHeader{
+            continuous.rows,
             continuous.cols,
-            continuous.type(), 
+            continuous.type(),
             data_size,
-            continuous.step[0]    // Add step size for proper stride handling
+            continuous.step[0],   // Add step size for proper stride handling
+            info
         };
-        
-        size_t total_mat_size = sizeof(MatHeader) + data_size;
 
-        LOGD("copy_to_queue: position={}, total_mat_size={}, capacity={}",
-             position, total_mat_size, header_->capacity);
+        // Publish the frame
+        slot->sequence.store(published_sequence(index),
+                             std::memory_order_release);
+        header_->write_index.store(index + 1, std::memory_order_release);
+        notify_push();
+
+        // Check one consumer cursor per push, so dead consumers are reaped
+        // without a scan on the hot path
+        try_reap(index % header_->consumer_capacity, CONSUMER_REAP_TIMEOUT);
+
+        LOGD("pushed {} to queue {}", index, name_);
+    }
 
-        if (total_mat_size > header_->capacity) {
-            LOGD("Frame too large: total_mat_size={} exceeds capacity={}",
-                 total_mat_size, header_->capacity);
+    bool fits_queue(size_t data_size, int type) const {
+        if (data_size > header_->max_frame_size) {
+            LOGW("Frame too large: data_size={} exceeds slot size={}",
+                 data_size, header_->max_frame_size);
             return false;
         }
-
-        if (position + total_mat_size > header_->capacity) {
-            LOGD("Wrapping buffer: position={} total_mat_size={}", position,
-                 total_mat_size);
-            position = 0;
+        if (header_->pixel_type != ANY_PIXEL_TYPE &&
+            type != header_->pixel_type) {
+            LOGW("Frame type {} does not match queue {} type {}", type, name_,
+                 header_->pixel_type);
+            return false;
         }
+        return true;
+    }
 
-        // Write header first with proper memory ordering
-        std::memcpy(buffer_ + position, &mat_header, sizeof(MatHeader));
-        
-        // Then copy the actual data
-        std::memcpy(buffer_ + position + sizeof(MatHeader), continuous.data, data_size);
-        
-        // Ensure all memory writes are visible to other threads
-        std::atomic_thread_fence(std::memory_order_release);
+    // Claims the first slot from the write index on that is not leased.
+    // Returns false, leaving `write_index` untouched, if every slot is.
+    bool claim_next_slot(uint64_t& write_index) {
+        // Only the producer advances the write index
+        uint64_t index = header_->write_index.load(std::memory_order_relaxed);
 
+        // Overwrite the oldest frame if the consumer has fallen a full ring
+        // behind, but never a slot that is currently leased
+        for (size_t attempt = 0;; ++attempt, ++index) {
+            if (attempt == header_->slot_count) {
+                LOGW("All {} slots of queue {} are leased, dropping frame",
+                     header_->slot_count, name_);
+                return false;
+            }
+            if (claim_slot(slot_at(index), index)) break;
+        }
+        write_index = index;
         return true;
     }
 
-    // New method for zero-copy read
-    bool read_from_queue_zero_copy(cv::Mat& result, size_t position) {
-        // Get pointer to the header in shared memory
-        MatHeader* header_ptr = reinterpret_cast<MatHeader*>(buffer_ + position);
-        
-        // Ensure memory is synchronized
-        std::atomic_thread_fence(std::memory_order_acquire);
-        
-        // Validate header fields
-        if (header_ptr->rows <= 0 || header_ptr->cols <= 0 ||
-            header_ptr->data_size == 0 || 
-            header_ptr->data_size > header_->capacity)
-            return false;
-            
-        // Create a Mat header that points directly to shared memory data
-        // This is zero-copy - we're just creating a view of the existing data
-        uint8_t* data_ptr = buffer_ + position + sizeof(MatHeader);
-        
-        // In this simplified version, we don't increment the reference count.
-        // For streaming applications, using a lock in serveLatestFrame is sufficient
-        // to ensure the Mat is not overwritten while it's being processed.
-        
+    // Only the producer touches the sequence bookkeeping. The first frame
+    // sets the baseline, and a sequence that goes back (e.g. a restarted
+    // camera) is not counted as lost frames. Returns `info` with the
+    // producer drop count filled in.
+    FrameInfo account_sequence(uint64_t write_index, FrameInfo info) {
+        const uint64_t expected_sequence =
+            header_->next_sequence.load(std::memory_order_relaxed);
+        uint64_t producer_dropped =
+            header_->producer_dropped.load(std::memory_order_relaxed);
+        if (write_index > 0 && info.sequence > expected_sequence) {
+            producer_dropped += info.sequence - expected_sequence;
+            header_->producer_dropped.store(producer_dropped,
+                                            std::memory_order_relaxed);
+        }
+        header_->next_sequence.store(info.sequence + 1,
+                                     std::memory_order_relaxed);
+        info.dropped = producer_dropped;
+        return info;
+    }
+
+    FrameInfo next_stamp() const {
+        return FrameInfo{
+            .sequence = header_->next_sequence.load(std::memory_order_relaxed),
+            .capture_ns = monotonic_ns(),
+        };
+    }
+
+    bool is_valid_header(const MatHeader& mat_header) const {
+        return mat_header.rows > 0 && mat_header.cols > 0 &&
+               mat_header.data_size > 0 &&
+               mat_header.data_size <= header_->max_frame_size;
+    }
+
+    // Creates a view of the slot without copying. The view is only stable
+    // until the producer laps this slot.
+    bool read_from_queue_zero_copy(cv::Mat& result, SlotHeader* slot) {
+        const MatHeader mat_header = slot->mat;
+        if (!is_valid_header(mat_header)) return false;
+
         // Direct zero-copy by creating a Mat that references the shared memory
-        result = cv::Mat(header_ptr->rows, header_ptr->cols, header_ptr->type, 
-                         data_ptr, header_ptr->step);
-        
-        // For debugging
-        LOGD("Created zero-copy Mat from shared memory at position {}", position);
-        
+        result = cv::Mat(mat_header.rows, mat_header.cols, mat_header.type,
+                         slot_data(slot), mat_header.step);
+        read_info_ = mat_header.info;
         return true;
     }
-    
-    // Original method (kept for backward compatibility)
-    bool read_from_queue(cv::Mat& result, size_t position) {
-        MatHeader mat_header;
-        std::atomic_thread_fence(std::memory_order_acquire);
-        std::memcpy(&mat_header, buffer_ + position, sizeof(MatHeader));
 
-        if (mat_header.rows <= 0 || mat_header.cols <= 0 ||
-            mat_header.data_size == 0 ||
-            mat_header.data_size > header_->capacity)
-            return false;
+    bool read_from_queue(cv::Mat& result, SlotHeader* slot) {
+        const MatHeader mat_header = slot->mat;
+        if (!is_valid_header(mat_header)) return false;
 
         // Create a deep copy
         result.create(mat_header.rows, mat_header.cols, mat_header.type);
-        std::memcpy(result.data, buffer_ + position + sizeof(MatHeader),
-                    mat_header.data_size);
+        if (result.total() * result.elemSize() != mat_header.data_size)
+            return false;
+        stream_copy_from(result.data, slot_data(slot), mat_header.data_size);
+        read_info_ = mat_header.info;
         return true;
     }
 
-    size_t get_entry_size(size_t position) {
-        MatHeader mat_header;
-        std::atomic_thread_fence(std::memory_order_acquire);
-        std::memcpy(&mat_header, buffer_ + position, sizeof(MatHeader));
+    auto pop_reader(cv::Mat& result, bool zero_copy) {
+        return [this, &result, zero_copy](SlotHeader* slot, uint64_t) {
+            // Use zero-copy or regular read based on parameter
+            bool success = zero_copy ? read_from_queue_zero_copy(result, slot)
+                                     : read_from_queue(result, slot);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return success && !result.empty();
+        };
+    }
+
+    auto lease_reader(FrameLease& lease) {
+        return [this, &lease](SlotHeader* slot, uint64_t expected) {
+            std::atomic<uint32_t>* owner_pins =
+                &consumer_pins_[slot_index(slot)];
+            owner_pins->fetch_add(1, std::memory_order_relaxed);
+            slot->pins.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
 
-        if (mat_header.rows <= 0 || mat_header.cols <= 0 ||
-            mat_header.data_size == 0 ||
-            mat_header.data_size > header_->capacity)
-            return 0;
+            cv::Mat view;
+            if (slot->sequence.load(std::memory_order_relaxed) != expected ||
+                !read_from_queue_zero_copy(view, slot)) {
+                slot->pins.fetch_sub(1, std::memory_order_release);
+                owner_pins->fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+            lease = FrameLease(&slot->pins, owner_pins, std::move(view),
+                               read_info_);
+            return true;
+        };
+    }
 
-        return sizeof(MatHeader) + mat_header.data_size;
+    // Detaches the consumer and releases the mapping and its descriptor.
+    // Leases and zero-copy views into the queue must be gone by now.
+    void unmap() {
+        unregister_consumer();
+        cancel_slot();
+        if (mapped_memory_ && mapped_memory_ != MAP_FAILED) {
+            munmap(mapped_memory_, total_size_);
+        }
+        if (fd_ != -1) ::close(fd_);
+        mapped_memory_ = nullptr;
+        header_ = nullptr;
+        buffer_ = nullptr;
+        fd_ = -1;
+        total_size_ = 0;
     }
 
    public:
-    static MatQueue Create(const std::string& queue_name, size_t frame_count) {
+    MatQueue() = default;
+    ~MatQueue() { unmap(); }
+
+    MatQueue(const MatQueue&) = delete;
+    MatQueue& operator=(const MatQueue&) = delete;
+
+    MatQueue(MatQueue&& other) noexcept { *this = std::move(other); }
+
+    MatQueue& operator=(MatQueue&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            mapped_memory_ = std::exchange(other.mapped_memory_, nullptr);
+            header_ = std::exchange(other.header_, nullptr);
+            buffer_ = std::exchange(other.buffer_, nullptr);
+            fd_ = std::exchange(other.fd_, -1);
+            name_ = std::move(other.name_);
+            total_size_ = std::exchange(other.total_size_, 0);
+            consumer_ = std::exchange(other.consumer_, nullptr);
+            consumer_pins_ = std::exchange(other.consumer_pins_, nullptr);
+            consumer_id_ = std::exchange(other.consumer_id_, -1);
+            attach_index_ = std::exchange(other.attach_index_, 0);
+            last_info_ = other.last_info_;
+            slot_reserved_ = std::exchange(other.slot_reserved_, false);
+            reserved_index_ = other.reserved_index_;
+            reserved_view_ = std::move(other.reserved_view_);
+        }
+        return *this;
+    }
+
+    static MatQueue Create(const std::string& queue_name, size_t frame_count,
+                           const FrameGeometry& geometry,
+                           const SharedMemoryOptions& options = {}) {
         MatQueue queue;
         queue.name_ = queue_name;
+        if (frame_count == 0 || geometry.max_frame_size == 0) return queue;
+
+        // Header, consumer cursors and their pin counts share the first pages
+        const size_t consumer_capacity = MAT_QUEUE_MAX_CONSUMERS;
         size_t page_size = sysconf(_SC_PAGE_SIZE);
-        size_t buffer_size = frame_count * (MAX_FRAME_SIZE + sizeof(MatHeader));
-        queue.total_size_ =
-            sizeof(QueueHeader) +
-            ((buffer_size + page_size - 1) / page_size) * page_size;
+        size_t consumers_offset = round_up(sizeof(QueueHeader), 64);
+        size_t consumer_pins_offset =
+            consumers_offset + consumer_capacity * sizeof(ConsumerSlot);
+        size_t header_size = round_up(
+            consumer_pins_offset +
+                consumer_capacity * frame_count * sizeof(std::atomic<uint32_t>),
+            page_size);
+        size_t slot_stride =
+            round_up(sizeof(SlotHeader) + geometry.max_frame_size, page_size);
 
-        queue.fd_ = shm_open(queue_name.c_str(), O_CREAT | O_RDWR, 0666);
-        if (queue.fd_ == -1) return queue;
+        SharedMemoryRegion region = SharedMemoryRegion::Create(
+            queue_name, header_size + frame_count * slot_stride, options);
+        queue.fd_ = region.fd;
+        queue.total_size_ = region.size;
+        queue.mapped_memory_ = region.memory;
+        if (!region.is_valid()) return queue;
 
-        if (ftruncate(queue.fd_, queue.total_size_) == -1) {
-            shm_unlink(queue_name.c_str());
-            return queue;
-        }
+        queue.header_ = new (queue.mapped_memory_) QueueHeader{};
+        queue.header_->write_index.store(0, std::memory_order_relaxed);
+        queue.header_->next_sequence.store(0, std::memory_order_relaxed);
+        queue.header_->producer_dropped.store(0, std::memory_order_relaxed);
+        queue.header_->push_word.store(0, std::memory_order_relaxed);
+        queue.header_->waiters.store(0, std::memory_order_relaxed);
+        queue.header_->version = MAT_QUEUE_LAYOUT_VERSION;
+        queue.header_->slot_count = frame_count;
+        queue.header_->slot_stride = slot_stride;
+        queue.header_->buffer_offset = header_size;
+        queue.header_->max_frame_size = geometry.max_frame_size;
+        queue.header_->pixel_type = geometry.pixel_type;
+        queue.header_->consumer_capacity = consumer_capacity;
+        queue.header_->consumers_offset = consumers_offset;
+        queue.header_->consumer_pins_offset = consumer_pins_offset;
+        queue.buffer_ =
+            static_cast<uint8_t*>(queue.mapped_memory_) + header_size;
 
-        queue.mapped_memory_ =
-            mmap(NULL, queue.total_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
-                 queue.fd_, 0);
-        if (queue.mapped_memory_ == MAP_FAILED) {
-            shm_unlink(queue_name.c_str());
-            return queue;
+        for (size_t id = 0; id < consumer_capacity; ++id) {
+            new (queue.consumer_at(id)) ConsumerSlot{};
+            std::atomic<uint32_t>* pins = queue.consumer_pins_at(id);
+            for (size_t i = 0; i < frame_count; ++i) {
+                new (&pins[i]) std::atomic<uint32_t>{0};
+            }
         }
 
-        queue.header_ = static_cast<QueueHeader*>(queue.mapped_memory_);
-        queue.buffer_ =
-            static_cast<uint8_t*>(queue.mapped_memory_) + sizeof(QueueHeader);
-        new (queue.header_) QueueHeader{0, 0, false, buffer_size};
+        for (size_t i = 0; i < frame_count; ++i) {
+            new (queue.slot_at(i)) SlotHeader{};
+            queue.slot_at(i)->sequence.store(0, std::memory_order_relaxed);
+            queue.slot_at(i)->pins.store(0, std::memory_order_relaxed);
+        }
+        queue.header_->magic.store(MAT_QUEUE_MAGIC, std::memory_order_release);
         return queue;
     }
 
@@ -183,47 +634,219 @@ class MatQueue {
     bool is_zero_copy_supported() const {
         return true;  // All MatQueue instances support zero-copy
     }
-    
+
     // Enhanced try_pop with zero-copy support
     bool try_pop(cv::Mat& result, bool zero_copy) {
+        return next_frame(pop_reader(result, zero_copy), false);
+    }
+
+    // Leases the next frame without copying it. The slot stays pinned, and
+    // is skipped by the producer, until the lease is released.
+    bool try_acquire(FrameLease& lease) {
+        return next_frame(lease_reader(lease), false);
+    }
+
+    // Latest-frame mailbox mode for live views: pops the most recent
+    // complete frame in O(1), skipping (and counting as dropped) any older
+    // unread ones, so the consumer never works through a backlog.
+    bool try_pop_latest(cv::Mat& result, bool zero_copy = false) {
+        return next_frame(pop_reader(result, zero_copy), true);
+    }
+
+    // Leases the most recent complete frame, like try_pop_latest()
+    bool try_acquire_latest(FrameLease& lease) {
+        return next_frame(lease_reader(lease), true);
+    }
+
+    // Blocks until a frame can be popped or the timeout expires
+    bool wait_pop(cv::Mat& result, std::chrono::nanoseconds timeout) {
+        return wait_until_ready([&]() { return try_pop(result); }, timeout);
+    }
+
+    // Blocks until a frame can be leased or the timeout expires
+    bool wait_acquire(FrameLease& lease, std::chrono::nanoseconds timeout) {
+        return wait_until_ready([&]() { return try_acquire(lease); },
+                                timeout);
+    }
+
+    // Snapshot of the push counter. Take it before polling a set of queues,
+    // then pass it to WaitAny() if they were all empty, so that a push that
+    // lands in between is never missed.
+    uint32_t push_token() const {
+        return is_valid() ? header_->push_word.load(std::memory_order_acquire)
+                          : 0;
+    }
+
+    // Sleeps until any of the queues has been pushed to since its token was
+    // taken, or the timeout expires. Returns false on timeout.
+    static bool WaitAny(const std::vector<MatQueue*>& queues,
+                        const std::vector<uint32_t>& tokens,
+                        std::chrono::nanoseconds timeout) {
+        std::vector<std::atomic<uint32_t>*> words;
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < queues.size() && i < tokens.size(); ++i) {
+            if (!queues[i] || !queues[i]->is_valid()) continue;
+            words.push_back(&queues[i]->header_->push_word);
+            expected.push_back(tokens[i]);
+        }
+        if (words.empty()) return false;
+
+        for (MatQueue* queue : queues) {
+            if (queue && queue->is_valid())
+                queue->header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+        }
+        const bool woken = futex_wait_any(words, expected, timeout);
+        for (MatQueue* queue : queues) {
+            if (queue && queue->is_valid())
+                queue->header_->waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return woken;
+    }
+
+    // Makes loop fire whenever a frame is pushed to this queue. Call
+    // unwatch() before the queue is closed or reassigned
+    bool watch(EventLoop& loop, EventLoop::Callback callback = {}) {
+        return is_valid() && loop.add_futex(&header_->push_word,
+                                            &header_->waiters,
+                                            std::move(callback));
+    }
+
+    void unwatch(EventLoop& loop) {
+        if (is_valid()) loop.remove_futex(&header_->push_word);
+    }
+
+   private:
+    template <typename TryFn>
+    bool wait_until_ready(TryFn&& try_fn, std::chrono::nanoseconds timeout) {
         if (!is_valid()) return false;
 
-        // Use relaxed memory ordering for initial checks to reduce overhead
-        size_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
-        size_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
-        bool was_overwritten = header_->was_overwritten.load(std::memory_order_relaxed);
-        
-        // Quick check if queue is empty
-        if (read_pos == write_pos && !was_overwritten) return false;
-        if (read_pos >= header_->capacity) read_pos = 0;
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            // Read the token before checking, so a push in between makes the
+            // futex wait below return immediately
+            const uint32_t token = push_token();
+            if (try_fn()) return true;
 
-        // Acquire fence only if we're actually going to read data
-        std::atomic_thread_fence(std::memory_order_acquire);
-        size_t entry_size = get_entry_size(read_pos);
-        if (entry_size == 0 || entry_size > header_->capacity) return false;
-
-        size_t remaining_space = header_->capacity - read_pos;
-        if (remaining_space < entry_size) read_pos = 0;
-        
-        // Use zero-copy or regular read based on parameter
-        bool success = zero_copy ? 
-            read_from_queue_zero_copy(result, read_pos) : 
-            read_from_queue(result, read_pos);
-            
-        if (!success || result.empty()) return false;
-
-        size_t next_pos = (read_pos + entry_size) % header_->capacity;
-        // Use release ordering for updating the read position
-        header_->read_pos.store(next_pos, std::memory_order_release);
+            const auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::nanoseconds::zero()) return false;
 
-        return true;
+            header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+            futex_wait(&header_->push_word, token, remaining);
+            header_->waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Wakes consumers blocked in wait_pop()/wait_acquire()/WaitAny(). The
+    // syscall is only made when someone is actually sleeping.
+    void notify_push() {
+        header_->push_word.fetch_add(1, std::memory_order_seq_cst);
+        if (header_->waiters.load(std::memory_order_seq_cst) != 0) {
+            futex_wake(&header_->push_word);
+        }
+    }
+
+    // Finds the next published frame for the consumer, or the newest one if
+    // `latest` is set, and hands its slot to `read`, which returns false if
+    // it could not read a consistent frame. Frames that were overwritten,
+    // skipped or torn are counted as dropped.
+    template <typename ReadFn>
+    bool next_frame(ReadFn&& read, bool latest) {
+        if (!is_valid() || !ensure_consumer()) return false;
+        consumer_->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+
+        // Only this consumer advances its read index
+        uint64_t read_index =
+            consumer_->read_index.load(std::memory_order_relaxed);
+
+        while (true) {
+            const uint64_t write_index =
+                header_->write_index.load(std::memory_order_acquire);
+            if (read_index >= write_index) return false;
+
+            // The producer lapped us: skip to the oldest frame still queued
+            if (write_index - read_index > header_->slot_count) {
+                const uint64_t skipped =
+                    write_index - read_index - header_->slot_count;
+                consumer_->dropped.fetch_add(skipped,
+                                             std::memory_order_relaxed);
+                read_index = write_index - header_->slot_count;
+            }
+
+            // Mailbox mode: jump straight to the newest published frame
+            if (latest && write_index - read_index > 1) {
+                consumer_->dropped.fetch_add(write_index - 1 - read_index,
+                                             std::memory_order_relaxed);
+                read_index = write_index - 1;
+            }
+
+            SlotHeader* slot = slot_at(read_index);
+            const uint64_t expected = published_sequence(read_index);
+            const uint64_t before =
+                slot->sequence.load(std::memory_order_acquire);
+
+            const bool success =
+                before == expected && read(slot, expected) &&
+                slot->sequence.load(std::memory_order_relaxed) == expected;
+
+            if (!success) {
+                // The producer skipped, or is rewriting, this slot
+                LOGD("Skipping frame {} in queue {}", read_index, name_);
+                consumer_->dropped.fetch_add(1, std::memory_order_relaxed);
+                ++read_index;
+                consumer_->read_index.store(read_index,
+                                            std::memory_order_release);
+                continue;
+            }
+
+            consumer_->read_index.store(read_index + 1,
+                                        std::memory_order_release);
+            last_info_ = read_info_;
+            return true;
+        }
     }
-    
+
+    // Describes why the mapped header is not a MatQueue this build can read,
+    // or returns an empty string if it is
+    std::string layout_error() const {
+        if (total_size_ < sizeof(QueueHeader)) return "too small";
+        if (header_->magic.load(std::memory_order_acquire) !=
+            MAT_QUEUE_MAGIC) {
+            return "not initialized";
+        }
+        if (header_->version != MAT_QUEUE_LAYOUT_VERSION) {
+            return fmt::format("layout version {}, expected {}",
+                               header_->version, MAT_QUEUE_LAYOUT_VERSION);
+        }
+        if (header_->slot_count == 0 || header_->max_frame_size == 0 ||
+            header_->slot_stride <
+                sizeof(SlotHeader) + header_->max_frame_size) {
+            return "invalid geometry";
+        }
+        if (header_->consumer_capacity == 0 ||
+            header_->consumers_offset < sizeof(QueueHeader) ||
+            header_->consumer_pins_offset <
+                header_->consumers_offset +
+                    header_->consumer_capacity * sizeof(ConsumerSlot) ||
+            header_->buffer_offset <
+                header_->consumer_pins_offset +
+                    header_->consumer_capacity * header_->slot_count *
+                        sizeof(std::atomic<uint32_t>)) {
+            return "invalid consumer table";
+        }
+        if (header_->buffer_offset +
+                    header_->slot_count * header_->slot_stride >
+                total_size_) {
+            return "slots exceed the mapping";
+        }
+        return {};
+    }
+
+   public:
     // Use a different name for the zero-copy version to avoid ambiguity
     bool try_pop_zero_copy(cv::Mat& result) {
         return try_pop(result, true); // Use zero-copy
     }
-    
+
     // Original method for backward compatibility
     bool try_pop(cv::Mat& result) {
         return try_pop(result, false); // Use regular copy for compatibility
@@ -231,26 +854,32 @@ class MatQueue {
 
     static MatQueue Open(const std::string& queue_name) {
         MatQueue queue;
-        queue.fd_ = shm_open(queue_name.c_str(), O_RDWR, 0666);
-        if (queue.fd_ == -1) return queue;
-
-        struct stat sb;
-        if (fstat(queue.fd_, &sb) == -1) return queue;
-        queue.total_size_ = sb.st_size;
-
-        queue.mapped_memory_ =
-            mmap(NULL, queue.total_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
-                 queue.fd_, 0);
-        if (queue.mapped_memory_ == MAP_FAILED) return queue;
+        queue.name_ = queue_name;
+        SharedMemoryRegion region = SharedMemoryRegion::Open(queue_name);
+        queue.fd_ = region.fd;
+        queue.total_size_ = region.size;
+        queue.mapped_memory_ = region.memory;
+        if (!region.is_valid()) return queue;
 
+        // Validate the layout before trusting anything else in the header
         queue.header_ = static_cast<QueueHeader*>(queue.mapped_memory_);
-        queue.buffer_ =
-            static_cast<uint8_t*>(queue.mapped_memory_) + sizeof(QueueHeader);
+        const std::string error = queue.layout_error();
+        if (!error.empty()) {
+            LOGE("Shared memory {} does not hold a compatible MatQueue: {}",
+                 queue_name, error);
+            queue.header_ = nullptr;
+            return queue;
+        }
+        queue.buffer_ = static_cast<uint8_t*>(queue.mapped_memory_) +
+                        queue.header_->buffer_offset;
+        // Consume only frames pushed from now on
+        queue.attach_index_ =
+            queue.header_->write_index.load(std::memory_order_acquire);
         return queue;
     }
 
     static void Close(const std::string& queue_name) {
-        shm_unlink(queue_name.c_str());
+        SharedMemoryRegion::Unlink(queue_name);
     }
 
     // Check if we can share memory between threads, avoiding unnecessary copying
@@ -258,67 +887,172 @@ class MatQueue {
         // This is only used for optimization purposes
         return true;
     }
-    
+
+    // Pushes a frame stamped with the next sequence number and the current
+    // time. Producers that know when the frame was captured should pass a
+    // FrameInfo instead.
     bool try_push(const cv::Mat& mat) {
+        if (!is_valid()) return false;
+        return try_push(mat, next_stamp());
+    }
+
+    // Pushes a frame with its capture sequence number and timestamp. Gaps in
+    // the sequence are added to the producer drop count carried by every
+    // later frame.
+    bool try_push(const cv::Mat& mat, FrameInfo info) {
         if (!is_valid() || mat.empty()) return false;
 
-        // Calculate required space for the mat
-        size_t required_space = sizeof(MatHeader) + mat.total() * mat.elemSize();
-        
-        // Ensure we have enough space in the queue
-        if (required_space > header_->capacity) {
-            LOGW("Frame too large: required_space={} exceeds capacity={}", 
-                 required_space, header_->capacity);
-            return false;
-        }
-        
-        // Read positions with relaxed memory ordering for initial calculation
-        size_t write_pos = header_->write_pos.load(std::memory_order_relaxed);
-        size_t read_pos = header_->read_pos.load(std::memory_order_relaxed);
-        
-        // Calculate available space
-        size_t available_space = (write_pos >= read_pos)
-            ? (header_->capacity - (write_pos - read_pos))
-            : (read_pos - write_pos);
-
-        // If insufficient space, evict old entries
-        if (required_space >= available_space) {
-            // Acquire memory order for eviction operations
-            read_pos = header_->read_pos.load(std::memory_order_acquire);
-            while (required_space > available_space) {
-                size_t entry_size = get_entry_size(read_pos);
-                if (entry_size == 0) break;
-
-                read_pos = (read_pos + entry_size) % header_->capacity;
-                available_space += entry_size;
-            }
-            header_->read_pos.store(read_pos, std::memory_order_release);
-            header_->was_overwritten.store(true, std::memory_order_release);
+        // Get a continuous version of the matrix if needed
+        // This avoids copying if the matrix is already continuous
+        const cv::Mat& continuous = mat.isContinuous() ? mat : mat.clone();
+        size_t data_size = continuous.total() * continuous.elemSize();
+        if (!fits_queue(data_size, continuous.type())) return false;
+
+        if (slot_reserved_) {
+            LOGW("try_push on queue {} cancels the reserved slot", name_);
+            cancel_slot();
         }
+        uint64_t write_index = 0;
+        if (!claim_next_slot(write_index)) return false;
+
+        copy_to_queue(continuous, data_size, write_index,
+                      account_sequence(write_index, info));
+        return true;
+    }
+
+    // Claims the next free slot and returns a writable, continuous view of
+    // it with the given shape, so a producer can decode or convert a frame
+    // straight into shared memory. Nothing is visible to consumers until
+    // commit_slot(). Returns an empty Mat if the frame does not fit or every
+    // slot is leased. The view must not be used after commit or cancel.
+    cv::Mat reserve_slot(int rows, int cols, int type) {
+        if (!is_valid() || rows <= 0 || cols <= 0) return {};
+        const size_t data_size =
+            static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+        if (!fits_queue(data_size, type)) return {};
 
-        // Handle buffer wrap-around
-        size_t remaining_space = header_->capacity - write_pos;
-        if (remaining_space < required_space) {
-            write_pos = 0;
+        if (slot_reserved_) {
+            LOGW("Slot {} of queue {} was reserved twice without a commit",
+                 reserved_index_, name_);
+            cancel_slot();
         }
+        if (!claim_next_slot(reserved_index_)) return {};
 
-        // Copy the frame to the queue
-        if (!copy_to_queue(mat, write_pos)) return false;
+        slot_reserved_ = true;
+        reserved_view_ =
+            cv::Mat(rows, cols, type, slot_data(slot_at(reserved_index_)));
+        return reserved_view_;
+    }
 
-        // Update write position with release ordering
-        size_t next_pos = (write_pos + required_space) % header_->capacity;
-        header_->write_pos.store(next_pos, std::memory_order_release);
+    // Publishes the frame written into the reserved slot, stamped with the
+    // next sequence number and the current time
+    bool commit_slot() {
+        if (!slot_reserved_) return false;
+        return commit_slot(next_stamp());
+    }
 
-        LOGD("pushed, write={}, read={}, was_overwritten={}", write_pos,
-             read_pos,
-             header_->was_overwritten.load(std::memory_order_acquire));
+    // Publishes the frame written into the reserved slot with its capture
+    // info, like try_push(mat, info)
+    bool commit_slot(const FrameInfo& info) {
+        if (!is_valid() || !slot_reserved_) return false;
+        slot_reserved_ = false;
+        publish_slot(reserved_view_, reserved_view_.total() *
+                                         reserved_view_.elemSize(),
+                     reserved_index_, account_sequence(reserved_index_, info));
+        reserved_view_ = cv::Mat();
         return true;
     }
 
+    // Gives up the reserved slot, e.g. when the capture failed. The frame
+    // that was in the slot may be partly overwritten, so it stays marked as
+    // being written and consumers skip it as dropped.
+    void cancel_slot() {
+        slot_reserved_ = false;
+        reserved_view_ = cv::Mat();
+    }
+
     bool is_valid() const {
         return mapped_memory_ && mapped_memory_ != MAP_FAILED && header_;
     }
 
     size_t size() const { return total_size_; }
+
+    size_t capacity() const { return is_valid() ? header_->slot_count : 0; }
+
+    size_t max_frame_size() const {
+        return is_valid() ? header_->max_frame_size : 0;
+    }
+
+    int pixel_type() const {
+        return is_valid() ? header_->pixel_type : ANY_PIXEL_TYPE;
+    }
+
+    // Capture info of the frame returned by the last successful pop
+    const FrameInfo& last_info() const { return last_info_; }
+
+    // Frames published that this consumer has not popped yet, at most the
+    // queue's capacity
+    size_t backlog() const {
+        if (!consumer_) return 0;
+        const uint64_t write_index =
+            header_->write_index.load(std::memory_order_acquire);
+        const uint64_t read_index =
+            consumer_->read_index.load(std::memory_order_relaxed);
+        return read_index >= write_index
+                   ? 0
+                   : std::min<uint64_t>(write_index - read_index,
+                                        header_->slot_count);
+    }
+
+    // Frames this consumer never saw because the producer overwrote them
+    uint64_t dropped() const {
+        return consumer_ ? consumer_->dropped.load(std::memory_order_relaxed)
+                         : 0;
+    }
+
+    // Attaches this object as a consumer that sees frames pushed from now
+    // on. Returns its cursor id, or -1 if every cursor is taken.
+    int register_consumer() {
+        if (!is_valid()) return -1;
+        if (!consumer_ &&
+            !attach(header_->write_index.load(std::memory_order_acquire)))
+            return -1;
+        return consumer_id_;
+    }
+
+    // Detaches the consumer. Release its FrameLeases first.
+    bool unregister_consumer() {
+        if (!consumer_) return false;
+        consumer_->state.store(CONSUMER_FREE, std::memory_order_release);
+        consumer_ = nullptr;
+        consumer_pins_ = nullptr;
+        consumer_id_ = -1;
+        return true;
+    }
+
+    bool is_consumer() const { return consumer_ != nullptr; }
+
+    size_t consumer_count() const {
+        if (!is_valid()) return 0;
+        size_t count = 0;
+        for (size_t id = 0; id < header_->consumer_capacity; ++id) {
+            if (consumer_at(id)->state.load(std::memory_order_relaxed) ==
+                CONSUMER_ACTIVE)
+                ++count;
+        }
+        return count;
+    }
+
+    // Frees the cursors, and returns the leases, of consumers idle for
+    // `idle_for` whose process has exited. Returns how many were reaped.
+    size_t reap_dead_consumers(
+        std::chrono::nanoseconds idle_for = CONSUMER_REAP_TIMEOUT) {
+        if (!is_valid()) return 0;
+        size_t reaped = 0;
+        for (size_t id = 0; id < header_->consumer_capacity; ++id) {
+            if (try_reap(id, idle_for)) ++reaped;
+        }
+        return reaped;
+    }
 };
 }  // namespace pallas
@@ -1,11 +1,19 @@
 #include "ps3.h"
+#include "ps3_usb.h"
+#include "v4l2.h"
 
+#include <core/color_convert.h>
 #include <core/logger.h>
+#include <core/timer.h>
+#include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
 #include <libusb-1.0/libusb.h>
 #include <iostream>
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 
 namespace pallas {
 
@@ -13,6 +21,10 @@ namespace pallas {
 constexpr uint16_t PS3_EYE_VENDOR_ID = 0x1415;  // Sony
 constexpr uint16_t PS3_EYE_PRODUCT_ID = 0x2000; // PS3 Eye
 
+// How long a V4L2 or USB capture waits for a frame before giving up
+constexpr std::chrono::milliseconds V4L2_CAPTURE_TIMEOUT{500};
+constexpr std::chrono::milliseconds USB_CAPTURE_TIMEOUT{500};
+
 // Implementation class to handle the camera details
 class PS3EyeCamera::Impl {
 public:
@@ -23,6 +35,12 @@ public:
     }
 
     std::expected<void, std::string> open() {
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return openV4L2();
+        }
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return openUSB();
+        }
         try {
             // Try to open the camera with OpenCV (simplest approach for Linux)
             capture_.open(config_.device_id, cv::CAP_V4L2);
@@ -61,12 +79,24 @@ public:
     }
 
     bool isOpen() const {
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return is_open_ && v4l2_ && v4l2_->isOpen();
+        }
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return is_open_ && usb_ && usb_->isOpen();
+        }
         return is_open_ && capture_.isOpened();
     }
 
     void close() {
         if (is_open_) {
-            capture_.release();
+            if (config_.backend == PS3EyeBackend::V4L2) {
+                v4l2_->close();
+            } else if (config_.backend == PS3EyeBackend::LibUSB) {
+                usb_->close();
+            } else {
+                capture_.release();
+            }
             is_open_ = false;
             LOGI("PS3 Eye camera closed, deviceId={}", config_.device_id);
         }
@@ -77,58 +107,156 @@ public:
             return std::unexpected("PS3 Eye camera is not open");
         }
 
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            const V4L2Config& format = v4l2_->getConfig();
+            cv::Mat frame(format.height, format.width, CV_8UC3);
+            auto result = captureFrame(frame);
+            if (!result) {
+                return std::unexpected(result.error());
+            }
+            return frame;
+        }
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            cv::Mat frame(usb_->height(), usb_->width(), CV_8UC3);
+            auto result = captureFrame(frame);
+            if (!result) {
+                return std::unexpected(result.error());
+            }
+            return frame;
+        }
+
         cv::Mat frame;
         if (!capture_.read(frame)) {
             return std::unexpected("Failed to capture frame from PS3 Eye camera");
         }
+        last_capture_ns_ = monotonic_ns();
+        last_frame_sequence_ = frames_read_++;
 
         if (frame.empty()) {
             return std::unexpected("Captured empty frame from PS3 Eye camera");
         }
 
         // Apply horizontal/vertical flipping if needed
-        if (config_.flip_horizontal || config_.flip_vertical) {
-            int flip_code = 0;
-            if (config_.flip_horizontal && !config_.flip_vertical) flip_code = 1;
-            else if (!config_.flip_horizontal && config_.flip_vertical) flip_code = 0;
-            else flip_code = -1; // both flips
-            
-            cv::flip(frame, frame, flip_code);
+        if (isFlipped()) {
+            cv::flip(frame, frame, flipCode());
         }
 
         return frame;
     }
 
+    std::expected<void, std::string> captureFrame(cv::Mat& frame) {
+        if (!isOpen()) {
+            return std::unexpected("PS3 Eye camera is not open");
+        }
+
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return captureV4L2(frame);
+        }
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return captureUSB(frame);
+        }
+
+        // Flipping cannot happen in place in the backend buffer, so decode
+        // into a reused scratch frame and let the flip do the copy. Otherwise
+        // the backend converts straight into `frame`.
+        cv::Mat target = isFlipped() ? scratch_ : frame;
+        const uchar* data = target.data;
+        if (!capture_.read(target)) {
+            return std::unexpected("Failed to capture frame from PS3 Eye camera");
+        }
+        // OpenCV does not pass on the driver's timestamp or frame counter
+        last_capture_ns_ = monotonic_ns();
+        last_frame_sequence_ = frames_read_++;
+
+        if (target.empty()) {
+            return std::unexpected("Captured empty frame from PS3 Eye camera");
+        }
+
+        if (target.size() != frame.size() || target.type() != frame.type()) {
+            return std::unexpected(
+                "Captured " + std::to_string(target.cols) + "x" +
+                std::to_string(target.rows) +
+                " frame does not match the requested " +
+                std::to_string(frame.cols) + "x" + std::to_string(frame.rows));
+        }
+
+        if (isFlipped()) {
+            scratch_ = target;
+            cv::flip(scratch_, frame, flipCode());
+        } else if (target.data != data) {
+            // The backend handed back its own buffer instead of filling ours
+            target.copyTo(frame);
+        }
+
+        return {};
+    }
+
     bool setAutoGain(bool enable) {
         if (!isOpen()) return false;
         config_.auto_gain = enable;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setAutoGain(enable);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_AUTOGAIN, enable ? 1 : 0);
+        }
         return capture_.set(cv::CAP_PROP_XI_GAIN, enable ? 1 : 0);
     }
 
     bool setGain(int gain) {
         if (!isOpen()) return false;
         config_.gain = gain;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setGain(gain);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_GAIN, gain);
+        }
         return capture_.set(cv::CAP_PROP_GAIN, gain);
     }
 
     bool setAutoWhiteBalance(bool enable) {
         if (!isOpen()) return false;
         config_.auto_white_balance = enable;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setAutoWhiteBalance(enable);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_AUTO_WHITE_BALANCE, enable ? 1 : 0);
+        }
         return capture_.set(cv::CAP_PROP_AUTO_WB, enable ? 1 : 0);
     }
 
     bool setExposure(int exposure) {
         if (!isOpen()) return false;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setExposure(exposure);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_EXPOSURE, exposure);
+        }
         return capture_.set(cv::CAP_PROP_EXPOSURE, exposure);
     }
 
     bool setRedBalance(int red_balance) {
         if (!isOpen()) return false;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setRedBalance(red_balance);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_RED_BALANCE, red_balance);
+        }
         return capture_.set(cv::CAP_PROP_WB_TEMPERATURE, red_balance);
     }
 
     bool setBlueBalance(int blue_balance) {
         if (!isOpen()) return false;
+        if (config_.backend == PS3EyeBackend::LibUSB) {
+            return usb_->setBlueBalance(blue_balance);
+        }
+        if (config_.backend == PS3EyeBackend::V4L2) {
+            return v4l2_->setControl(V4L2_CID_BLUE_BALANCE, blue_balance);
+        }
         // OpenCV doesn't have a direct property for blue balance
         // This is an approximation using color temperature
         return capture_.set(cv::CAP_PROP_WB_TEMPERATURE, blue_balance);
@@ -137,6 +265,12 @@ public:
     bool setFlip(bool horizontal, bool vertical) {
         config_.flip_horizontal = horizontal;
         config_.flip_vertical = vertical;
+        if (config_.backend == PS3EyeBackend::V4L2 && isOpen()) {
+            applySensorFlip();
+        }
+        if (config_.backend == PS3EyeBackend::LibUSB && isOpen()) {
+            return usb_->setFlip(horizontal, vertical);
+        }
         return true;
     }
 
@@ -144,85 +278,253 @@ public:
         return config_;
     }
 
+    int64_t lastCaptureNs() const {
+        return last_capture_ns_;
+    }
+
+    uint64_t lastFrameSequence() const {
+        return last_frame_sequence_;
+    }
+
 private:
+    std::expected<void, std::string> openV4L2() {
+        v4l2_ = std::make_unique<V4L2Capture>(V4L2Config{
+            .device_id = config_.device_id,
+            .width = config_.width,
+            .height = config_.height,
+            .fps = config_.fps,
+            .pixel_format = V4L2_PIX_FMT_YUYV,
+            .buffer_count = config_.buffer_count,
+        });
+        auto result = v4l2_->open();
+        if (!result) {
+            return std::unexpected("Failed to open PS3 Eye camera: " + result.error());
+        }
+
+        // Controls the ov534 driver does not expose are left at its defaults
+        v4l2_->setControl(V4L2_CID_AUTOGAIN, config_.auto_gain ? 1 : 0);
+        if (!config_.auto_gain) {
+            v4l2_->setControl(V4L2_CID_GAIN, config_.gain);
+        }
+        v4l2_->setControl(V4L2_CID_AUTO_WHITE_BALANCE,
+                         config_.auto_white_balance ? 1 : 0);
+        applySensorFlip();
+
+        is_open_ = true;
+        const V4L2Config& format = v4l2_->getConfig();
+        LOGI("PS3 Eye camera opened with V4L2, deviceId={}, resolution={}x{}, fps={}, buffers={}",
+             config_.device_id, format.width, format.height, format.fps,
+             format.buffer_count);
+        return {};
+    }
+
+    std::expected<void, std::string> openUSB() {
+        const bool qvga = config_.width <= 320 && config_.height <= 240;
+        usb_ = std::make_unique<PS3EyeUSB>(PS3EyeUSBConfig{
+            .device_id = config_.device_id,
+            .resolution = qvga ? PS3EyeResolution::QVGA : PS3EyeResolution::VGA,
+            .fps = config_.fps,
+            .record_path = config_.usb_record_path,
+        });
+        auto result = usb_->open();
+        if (!result) {
+            return std::unexpected("Failed to open PS3 Eye camera: " + result.error());
+        }
+
+        usb_->setAutoGain(config_.auto_gain);
+        if (!config_.auto_gain) {
+            usb_->setGain(config_.gain);
+        }
+        usb_->setAutoWhiteBalance(config_.auto_white_balance);
+        usb_->setFlip(config_.flip_horizontal, config_.flip_vertical);
+
+        is_open_ = true;
+        LOGI("PS3 Eye camera opened with libusb, deviceId={}, resolution={}x{}, fps={}",
+             config_.device_id, usb_->width(), usb_->height(), usb_->fps());
+        return {};
+    }
+
+    // Flips on the sensor where the driver allows it, axis by axis, so
+    // captures only flip in software what the sensor could not
+    void applySensorFlip() {
+        sensor_flip_.horizontal =
+            v4l2_->setControl(V4L2_CID_HFLIP, config_.flip_horizontal ? 1 : 0);
+        sensor_flip_.vertical =
+            v4l2_->setControl(V4L2_CID_VFLIP, config_.flip_vertical ? 1 : 0);
+        const auto software = softwareFlip(
+            {.horizontal = config_.flip_horizontal,
+             .vertical = config_.flip_vertical},
+            sensor_flip_);
+        if (software.horizontal || software.vertical) {
+            LOGW("PS3 Eye camera {} cannot flip {} on the sensor, flipping in software",
+                 config_.device_id,
+                 software.horizontal && software.vertical ? "either axis"
+                 : software.horizontal                    ? "horizontally"
+                                                          : "vertically");
+        }
+    }
+
+    std::expected<void, std::string> captureV4L2(cv::Mat& frame) {
+        auto buffer = v4l2_->dequeue(V4L2_CAPTURE_TIMEOUT);
+        if (!buffer) {
+            return std::unexpected("Failed to capture frame from PS3 Eye camera: " +
+                                   buffer.error());
+        }
+
+        if (buffer->width != frame.cols || buffer->height != frame.rows ||
+            frame.type() != CV_8UC3) {
+            v4l2_->requeue(*buffer);
+            return std::unexpected(
+                "Captured " + std::to_string(buffer->width) + "x" +
+                std::to_string(buffer->height) +
+                " frame does not match the requested " +
+                std::to_string(frame.cols) + "x" + std::to_string(frame.rows));
+        }
+
+        // Convert from the driver buffer straight into the output, flipping
+        // in the same pass if the sensor could not, then hand the buffer back
+        const auto flip = softwareFlip({.horizontal = config_.flip_horizontal,
+                                        .vertical = config_.flip_vertical},
+                                       sensor_flip_);
+        yuyv_to_bgr(buffer->data, buffer->stride, frame.data, frame.step[0],
+                    frame.cols, frame.rows, flip.horizontal, flip.vertical);
+        last_capture_ns_ = buffer->timestamp_ns;
+        last_frame_sequence_ = buffer->sequence;
+        v4l2_->requeue(*buffer);
+
+        return {};
+    }
+
+    std::expected<void, std::string> captureUSB(cv::Mat& frame) {
+        auto usb_frame = usb_->waitFrame(USB_CAPTURE_TIMEOUT);
+        if (!usb_frame) {
+            return std::unexpected("Failed to capture frame from PS3 Eye camera: " +
+                                   usb_frame.error());
+        }
+
+        if (usb_frame->width != frame.cols || usb_frame->height != frame.rows ||
+            frame.type() != CV_8UC3) {
+            return std::unexpected(
+                "Captured " + std::to_string(usb_frame->width) + "x" +
+                std::to_string(usb_frame->height) +
+                " frame does not match the requested " +
+                std::to_string(frame.cols) + "x" + std::to_string(frame.rows));
+        }
+
+        // The sensor already flipped the frame
+        yuyv_to_bgr(usb_frame->data, usb_frame->stride, frame.data,
+                    frame.step[0], frame.cols, frame.rows);
+        last_capture_ns_ = usb_frame->info.timestamp_ns;
+        last_frame_sequence_ = usb_frame->info.sequence;
+        return {};
+    }
+
+    bool isFlipped() const {
+        return config_.flip_horizontal || config_.flip_vertical;
+    }
+
+    int flipCode() const {
+        if (config_.flip_horizontal && !config_.flip_vertical) return 1;
+        if (!config_.flip_horizontal && config_.flip_vertical) return 0;
+        return -1; // both flips
+    }
+
     PS3EyeConfig config_;
     cv::VideoCapture capture_;
+    std::unique_ptr<V4L2Capture> v4l2_;
+    std::unique_ptr<PS3EyeUSB> usb_;
+    PS3EyeFlip sensor_flip_; // Axes the driver flips, captures need not
+    cv::Mat scratch_; // Decode buffer reused across flipped captures
+    int64_t last_capture_ns_{0};
+    uint64_t last_frame_sequence_{0};
+    uint64_t frames_read_{0}; // OpenCV captures, which have no driver counter
     bool is_open_;
 };
 
 // Static method to get available PS3 Eye devices
-std::vector<int> PS3EyeCamera::getDeviceList() {
+namespace {
+
+// Reads a small integer attribute from sysfs, or -1
+int readSysfsInt(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    int value = -1;
+    file >> value;
+    return file ? value : -1;
+}
+
+// The /dev/video index the kernel driver exposes for the USB device at
+// bus/address, or -1 if no driver is bound (e.g. it is claimed over libusb)
+int videoDeviceId(uint8_t bus, uint8_t address) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(
+             "/sys/class/video4linux", error)) {
+        const std::string name = entry.path().filename().string();
+        if (!name.starts_with("video")) continue;
+
+        // device links to the USB interface; its parent is the USB device
+        const auto usb_device =
+            std::filesystem::canonical(entry.path() / "device", error)
+                .parent_path();
+        if (error) continue;
+        if (readSysfsInt(usb_device / "busnum") == bus &&
+            readSysfsInt(usb_device / "devnum") == address) {
+            try {
+                return std::stoi(name.substr(5));
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+std::vector<int> PS3EyeCamera::getDeviceList(PS3EyeBackend backend) {
     std::vector<int> devices;
-    
-    // Initialize libusb
-    libusb_context* ctx = nullptr;
-    if (libusb_init(&ctx) != 0) {
-        LOGE("Failed to initialize libusb");
+
+    if (backend == PS3EyeBackend::LibUSB) {
+        return PS3EyeUSB::deviceIds();
+    }
+
+    // Only enumerate the bus; opening the video nodes to probe them would
+    // disturb cameras that are already streaming
+    auto context = PS3EyeUSB::sharedContext();
+    if (!context) {
         return devices;
     }
-    
-    // Get device list
+
     libusb_device** device_list = nullptr;
-    ssize_t count = libusb_get_device_list(ctx, &device_list);
-    
+    const ssize_t count = libusb_get_device_list(context.get(), &device_list);
     if (count < 0) {
         LOGE("Failed to get USB device list");
-        libusb_exit(ctx);
         return devices;
     }
-    
-    // Find all PS3 Eye cameras
-    std::array<int, 10> potential_devices{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}; // Try up to 10 video devices
-    
-    for (int device_id : potential_devices) {
-        cv::VideoCapture temp(device_id, cv::CAP_V4L2);
-        if (temp.isOpened()) {
-            // Try to check if this is a PS3 Eye
-            // There's no direct way to check in OpenCV, so we'll use rough heuristics
-            
-            // PS3 Eye should support 640x480 at 60fps
-            temp.set(cv::CAP_PROP_FRAME_WIDTH, 640);
-            temp.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-            temp.set(cv::CAP_PROP_FPS, 60);
-            
-            double actual_width = temp.get(cv::CAP_PROP_FRAME_WIDTH);
-            double actual_height = temp.get(cv::CAP_PROP_FRAME_HEIGHT);
-            double actual_fps = temp.get(cv::CAP_PROP_FPS);
-            
-            // Check if camera supports PS3 Eye typical resolution and framerate
-            if (actual_width == 640 && actual_height == 480 && actual_fps >= 30) {
-                devices.push_back(device_id);
-                LOGI("Found potential PS3 Eye camera at device ID {}", device_id);
-            }
-            
-            temp.release();
-        }
-    }
-    
-    // Look for PS3 Eye devices via USB as a backup method
+
     for (ssize_t i = 0; i < count; ++i) {
         libusb_device* device = device_list[i];
         libusb_device_descriptor desc;
-        
-        if (libusb_get_device_descriptor(device, &desc) == 0) {
-            if (desc.idVendor == PS3_EYE_VENDOR_ID && 
-                desc.idProduct == PS3_EYE_PRODUCT_ID) {
-                
-                uint8_t bus = libusb_get_bus_number(device);
-                uint8_t address = libusb_get_device_address(device);
-                
-                LOGI("Found PS3 Eye camera on USB bus {} address {}", bus, address);
-                
-                // We found a PS3 Eye device, but OpenCV needs the /dev/video* ID
-                // This is more of a notification than actual ID mapping
-            }
+        if (libusb_get_device_descriptor(device, &desc) != 0 ||
+            desc.idVendor != PS3_EYE_VENDOR_ID ||
+            desc.idProduct != PS3_EYE_PRODUCT_ID) {
+            continue;
         }
+
+        const uint8_t bus = libusb_get_bus_number(device);
+        const uint8_t address = libusb_get_device_address(device);
+        const int device_id = videoDeviceId(bus, address);
+        if (device_id < 0) {
+            LOGD("PS3 Eye camera on USB bus {} address {} has no video device",
+                 bus, address);
+            continue;
+        }
+        LOGD("Found PS3 Eye camera /dev/video{} on USB bus {} address {}",
+             device_id, bus, address);
+        devices.push_back(device_id);
     }
-    
-    // Free device list and exit libusb context
+
     libusb_free_device_list(device_list, 1);
-    libusb_exit(ctx);
-    
+    std::sort(devices.begin(), devices.end());
     return devices;
 }
 
@@ -249,6 +551,10 @@ std::expected<cv::Mat, std::string> PS3EyeCamera::captureFrame() {
     return impl_->captureFrame();
 }
 
+std::expected<void, std::string> PS3EyeCamera::captureFrame(cv::Mat& frame) {
+    return impl_->captureFrame(frame);
+}
+
 bool PS3EyeCamera::setAutoGain(bool enable) {
     return impl_->setAutoGain(enable);
 }
@@ -281,4 +587,12 @@ const PS3EyeConfig& PS3EyeCamera::getConfig() const {
     return config_;
 }
 
+int64_t PS3EyeCamera::lastCaptureNs() const {
+    return impl_->lastCaptureNs();
+}
+
+uint64_t PS3EyeCamera::lastFrameSequence() const {
+    return impl_->lastFrameSequence();
+}
+
 } // namespace pallas
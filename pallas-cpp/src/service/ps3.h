@@ -9,6 +9,12 @@
 
 namespace pallas {
 
+enum class PS3EyeBackend {
+    V4L2,    // Native V4L2 mmap streaming, converted straight to the output
+    OpenCV,  // cv::VideoCapture, which converts into its own buffer first
+    LibUSB,  // User-space driver; 320x240 up to 187 fps, 640x480 up to 75
+};
+
 struct PS3EyeConfig {
     int device_id{0};            // USB device ID
     int width{640};              // Frame width (default 640)
@@ -19,12 +25,32 @@ struct PS3EyeConfig {
     bool auto_white_balance{true}; // Auto white balance
     bool flip_horizontal{false}; // Flip image horizontally
     bool flip_vertical{false};   // Flip image vertically
+    PS3EyeBackend backend{PS3EyeBackend::V4L2}; // Capture backend
+    int buffer_count{4};         // Driver buffers in the V4L2 ring
+    std::string usb_record_path{}; // LibUSB: record raw transfers for replay
+};
+
+// Flip per axis
+struct PS3EyeFlip {
+    bool horizontal{false};
+    bool vertical{false};
 };
 
+// The axes a capture still has to flip in software: those requested that
+// the sensor did not take
+inline PS3EyeFlip softwareFlip(PS3EyeFlip requested, PS3EyeFlip sensor) {
+    return {.horizontal = requested.horizontal && !sensor.horizontal,
+            .vertical = requested.vertical && !sensor.vertical};
+}
+
 class PS3EyeCamera {
 public:
-    // Get list of available PS3 Eye camera device IDs
-    static std::vector<int> getDeviceList();
+    // Device IDs of the PS3 Eye cameras on the USB bus, as PS3EyeConfig
+    // expects them for `backend`: /dev/video indices for V4L2 and OpenCV,
+    // ids that follow the USB port (PS3EyeUSB::deviceIds()) for LibUSB.
+    // Cheap enough to poll for hot-plugged cameras.
+    static std::vector<int> getDeviceList(
+        PS3EyeBackend backend = PS3EyeBackend::V4L2);
     
     // Create a PS3 Eye camera instance
     explicit PS3EyeCamera(PS3EyeConfig config = {});
@@ -45,6 +71,11 @@ public:
     
     // Capture a frame (returns empty cv::Mat on failure)
     std::expected<cv::Mat, std::string> captureFrame();
+
+    // Capture a frame into `frame`, which must already have the configured
+    // size and CV_8UC3 type (e.g. a view over a queue slot). The frame is
+    // decoded and flipped in place, without allocating a new buffer.
+    std::expected<void, std::string> captureFrame(cv::Mat& frame);
     
     // Set camera properties
     bool setAutoGain(bool enable);
@@ -58,6 +89,18 @@ public:
     // Get current configuration
     const PS3EyeConfig& getConfig() const;
 
+    // When the last captured frame was taken, on CLOCK_MONOTONIC like
+    // monotonic_ns(). V4L2 and libusb captures use the time the frame came
+    // off the bus rather than the time it was converted, so frames from
+    // several cameras can be matched by it.
+    int64_t lastCaptureNs() const;
+
+    // The driver's counter of the last captured frame, which also counts
+    // the frames it lost, so gaps between captures are dropped frames. It
+    // may restart when the camera is reopened. OpenCV captures only count
+    // the frames read.
+    uint64_t lastFrameSequence() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,91 @@
+#include "ps3_camera_rig.h"
+
+#include <core/logger.h>
+
+#include <algorithm>
+#include <map>
+
+namespace pallas {
+
+PS3CameraRig::PS3CameraRig(PS3CameraRigConfig config)
+    : Service(std::move(config.base)) {
+    for (auto& camera_config : config.cameras) {
+        auto service = std::make_unique<PS3CameraService>(camera_config);
+        cameras_.push_back(Camera{.config = std::move(camera_config),
+                                  .service = std::move(service)});
+    }
+    LOGI("Initializing PS3CameraRig with {} cameras.", cameras_.size());
+}
+
+// Stop scanning before the cameras it scans for are destroyed
+PS3CameraRig::~PS3CameraRig() { stop(); }
+
+bool PS3CameraRig::start() {
+    // Bring up the cameras that are already attached before returning
+    scan();
+    return Service::start();
+}
+
+void PS3CameraRig::stop() {
+    Service::stop();
+
+    std::lock_guard lock(mutex_);
+    for (auto& camera : cameras_) {
+        if (camera.running) {
+            camera.service->stop();
+            camera.running = false;
+        }
+    }
+}
+
+std::size_t PS3CameraRig::active_cameras() const {
+    std::lock_guard lock(mutex_);
+    return std::count_if(cameras_.begin(), cameras_.end(),
+                         [](const Camera& camera) { return camera.running; });
+}
+
+std::expected<void, std::string> PS3CameraRig::tick() {
+    scan();
+    return {};
+}
+
+void PS3CameraRig::scan() {
+    // One bus scan per device numbering; V4L2 and OpenCV share /dev/video
+    std::map<bool, std::vector<int>> attached;
+    const auto is_attached = [&](const PS3EyeConfig& camera_config) {
+        const bool usb = camera_config.backend == PS3EyeBackend::LibUSB;
+        auto it = attached.find(usb);
+        if (it == attached.end()) {
+            it = attached
+                     .emplace(usb, PS3EyeCamera::getDeviceList(
+                                       camera_config.backend))
+                     .first;
+        }
+        return std::find(it->second.begin(), it->second.end(),
+                         camera_config.device_id) != it->second.end();
+    };
+
+    std::lock_guard lock(mutex_);
+    for (auto& camera : cameras_) {
+        const auto& camera_config = camera.config.camera_config;
+        const bool present = is_attached(camera_config);
+
+        if (present && !camera.running) {
+            LOGI("PS3 Eye camera {} attached, starting capture into {}",
+                 camera_config.device_id, camera.config.shared_memory_name);
+            camera.running = camera.service->start();
+            if (!camera.running) {
+                LOGW("Failed to start PS3 Eye camera {}, retrying on the "
+                     "next scan",
+                     camera_config.device_id);
+            }
+        } else if (!present && camera.running) {
+            LOGW("PS3 Eye camera {} detached, stopping capture",
+                 camera_config.device_id);
+            camera.service->stop();
+            camera.running = false;
+        }
+    }
+}
+
+}  // namespace pallas
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <core/service.h>
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ps3_camera_service.h"
+
+namespace pallas {
+
+struct PS3CameraRigConfig {
+    ServiceConfig base;  // interval_ms sets how often to scan for cameras
+    std::vector<PS3CameraServiceConfig> cameras;
+};
+
+/**
+ * Runs several PS3 Eye cameras in one process. Each camera is a
+ * PS3CameraService with its own capture thread, pinned to the core in its
+ * ServiceConfig, and its own shared memory queue.
+ *
+ * The rig's own thread polls the USB bus and starts a camera when its
+ * device appears and stops it when the device goes away, so cameras can be
+ * plugged in and out while starburstd runs.
+ */
+class PS3CameraRig : public Service {
+   public:
+    PS3CameraRig(PS3CameraRigConfig config);
+    ~PS3CameraRig() override;
+    bool start() override;
+    void stop() override;
+
+    // Number of cameras currently capturing
+    std::size_t active_cameras() const;
+
+   protected:
+    std::expected<void, std::string> tick() override;
+
+   private:
+    struct Camera {
+        PS3CameraServiceConfig config;
+        std::unique_ptr<PS3CameraService> service;
+        bool running = false;
+    };
+
+    // Starts cameras whose device is attached and stops those whose device
+    // is gone
+    void scan();
+
+    mutable std::mutex mutex_;
+    std::vector<Camera> cameras_;
+};
+}  // namespace pallas
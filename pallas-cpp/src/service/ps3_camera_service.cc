@@ -1,6 +1,7 @@
 #include "ps3_camera_service.h"
 
 #include <core/logger.h>
+#include <core/trace.h>
 
 #include <expected>
 #include <filesystem>
@@ -15,6 +16,7 @@ PS3CameraService::PS3CameraService(PS3CameraServiceConfig config)
     : Service(std::move(config.base)),
       shared_memory_name_{config.shared_memory_name},
       shared_memory_frame_capacity_{config.shared_memory_frame_capacity},
+      shared_memory_options_{config.shared_memory_options},
       camera_config_{std::move(config.camera_config)},
       camera_{camera_config_},
       queue_{nullptr} {
@@ -28,17 +30,27 @@ PS3CameraService::PS3CameraService(PS3CameraServiceConfig config)
 }
 
 bool PS3CameraService::start() {
-    // Cleanup any previously existing shared memory and reinitalize the buffer
-    Queue::Close(shared_memory_name_);
-    queue_ = std::make_unique<Queue>(
-        Queue::Create(shared_memory_name_, shared_memory_frame_capacity_));
-
     // Open the PS3 Eye camera
     auto result = camera_.open();
     if (!result) {
         LOGW("Failed to open PS3 Eye camera on start: {}", result.error());
         return false;
     }
+    last_camera_sequence_.reset();
+
+    // Keep the queue across restarts so consumers stay attached, and only
+    // replace it, cleaning up the old segment, when the frame size changes
+    const cv::Size frame_size{camera_config_.width, camera_config_.height};
+    if (!queue_ || queue_frame_size_ != frame_size) {
+        queue_.reset();
+        Queue::Close(shared_memory_name_);
+        queue_ = std::make_unique<Queue>(
+            Queue::Create(shared_memory_name_, shared_memory_frame_capacity_,
+                          FrameGeometry::Of(frame_size.height,
+                                            frame_size.width, CV_8UC3),
+                          shared_memory_options_));
+        queue_frame_size_ = frame_size;
+    }
 
     std::filesystem::create_directories("./ps3_camera_service");
 
@@ -46,8 +58,9 @@ bool PS3CameraService::start() {
 }
 
 void PS3CameraService::stop() {
-    camera_.close();
+    // Let the capture thread finish its frame before the camera goes away
     Service::stop();
+    camera_.close();
 }
 
 std::expected<void, std::string> PS3CameraService::tick() {
@@ -59,55 +72,85 @@ std::expected<void, std::string> PS3CameraService::tick() {
             return std::unexpected("Failed to reopen PS3 Eye camera: " + result.error());
         }
         LOGI("Successfully reopened PS3 Eye camera");
+        last_camera_sequence_.reset();
+    }
+
+    // Reserve the next queue slot and capture straight into it, retrying if
+    // it fails. The queue skips slots that consumers have leased, so a
+    // reservation only fails when every slot is pinned; give consumers a
+    // moment to release one.
+    int retry_count = 0;
+    const int max_retries = 3;
+
+    cv::Mat slot = queue_->reserve_slot(camera_config_.height,
+                                        camera_config_.width, CV_8UC3);
+    while (slot.empty() && retry_count < max_retries) {
+        LOGW("Failed to reserve shared memory slot (attempt {}), retrying...", retry_count + 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        retry_count++;
+        slot = queue_->reserve_slot(camera_config_.height, camera_config_.width,
+                                    CV_8UC3);
+    }
+
+    if (slot.empty()) {
+        LOGE("Failed to reserve shared memory slot after {} attempts", max_retries);
+        return std::unexpected("Failed to reserve shared memory slot after multiple attempts");
     }
 
     // Try to capture a frame from the camera
-    auto frame_result = camera_.captureFrame();
+    auto frame_result = [&]() {
+        TRACE_SCOPE("camera.capture");
+        return camera_.captureFrame(slot);
+    }();
     if (!frame_result) {
         LOGE("Failed to capture frame: {}", frame_result.error());
-        
+        // The driver's counter restarts with the camera, so the lost frame
+        // is counted here
+        ++frame_sequence_;
+        last_camera_sequence_.reset();
+
         // If frame capture fails, close and reopen the camera
         LOGW("Closing and reopening camera due to frame capture failure");
         camera_.close();
         auto reopen_result = camera_.open();
         if (!reopen_result) {
+            queue_->cancel_slot();
             return std::unexpected("Failed to reopen camera after frame capture failure: " + 
                                   reopen_result.error());
         }
         
         // Try one more time to capture a frame
-        frame_result = camera_.captureFrame();
+        frame_result = camera_.captureFrame(slot);
         if (!frame_result) {
+            ++frame_sequence_;
+            queue_->cancel_slot();
             return std::unexpected("Failed to capture frame after camera reopen: " + 
                                   frame_result.error());
         }
     }
 
-    cv::Mat frame = frame_result.value();
-
-    // Try to push frame to the queue, retrying if it fails
-    int retry_count = 0;
-    const int max_retries = 3;
-    
-    while (!queue_->try_push(frame) && retry_count < max_retries) {
-        LOGW("Failed to push frame to shared memory (attempt {}), retrying...", retry_count + 1);
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        retry_count++;
-    }
-    
-    if (retry_count >= max_retries) {
-        LOGE("Failed to push frame to shared memory after {} attempts", max_retries);
-        return std::unexpected("Failed to push frame to shared memory after multiple attempts");
-    }
-
     if (false)  // Write frames as images (disabled by default)
     {
         static int frame_idx{0};
         std::string filename =
             "./ps3_camera_service/frame_" + std::to_string(frame_idx++) + ".png";
-        cv::imwrite(filename, frame);
+        cv::imwrite(filename, slot);
     }
 
+    // Frames the driver lost, or that were not read in time, show as gaps
+    // in its counter and leave the same gaps in ours
+    const uint64_t camera_sequence = camera_.lastFrameSequence();
+    if (last_camera_sequence_ && camera_sequence > *last_camera_sequence_) {
+        frame_sequence_ += camera_sequence - *last_camera_sequence_ - 1;
+    }
+    last_camera_sequence_ = camera_sequence;
+
+    // The slot view must not be touched once the frame is published. Stamp
+    // it with the driver's capture time so that frames from several cameras
+    // can be matched.
+    queue_->commit_slot(FrameInfo{.sequence = frame_sequence_++,
+                                  .capture_ns = camera_.lastCaptureNs()});
+
     return std::expected<void, std::string>{};
 }
 
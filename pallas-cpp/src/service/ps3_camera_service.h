@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <expected>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "ps3.h"
@@ -17,6 +18,7 @@ struct PS3CameraServiceConfig {
     std::string shared_memory_name;
     std::size_t shared_memory_frame_capacity;
     PS3EyeConfig camera_config;
+    SharedMemoryOptions shared_memory_options;
 };
 
 class PS3CameraService : public Service {
@@ -31,12 +33,17 @@ class PS3CameraService : public Service {
     std::expected<void, std::string> tick() override;
 
    private:
-  using Queue = MatQueue<921600>; 
+    using Queue = MatQueue;
 
     std::string shared_memory_name_;
     std::size_t shared_memory_frame_capacity_;
+    SharedMemoryOptions shared_memory_options_;
     PS3EyeConfig camera_config_;
     PS3EyeCamera camera_;
+    uint64_t frame_sequence_ = 0;  // Of the next frame, counting lost ones
+    // Driver counter of the last published frame, unset after a reopen
+    std::optional<uint64_t> last_camera_sequence_;
     std::unique_ptr<Queue> queue_;
+    cv::Size queue_frame_size_;  // Frame size queue_ was created for
 };
 }  // namespace pallas
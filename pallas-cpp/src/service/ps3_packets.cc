@@ -0,0 +1,154 @@
+#include "ps3_packets.h"
+
+#include <core/logger.h>
+#include <core/timer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace pallas {
+
+PS3EyeFrameAssembler::PS3EyeFrameAssembler(int width, int height)
+    : frame_size_(static_cast<std::size_t>(width) * height * 2),
+      frame_(frame_size_) {}
+
+void PS3EyeFrameAssembler::setSink(FrameSink sink) {
+    sink_ = std::move(sink);
+}
+
+void PS3EyeFrameAssembler::feed(std::span<const uint8_t> transfer) {
+    for (std::size_t offset = 0; offset < transfer.size();
+         offset += PS3_EYE_PAYLOAD_SIZE) {
+        const auto payload = transfer.subspan(
+            offset, std::min(PS3_EYE_PAYLOAD_SIZE, transfer.size() - offset));
+
+        if (payload.size() < PS3_EYE_PAYLOAD_HEADER_SIZE ||
+            payload[0] != PS3_EYE_PAYLOAD_HEADER_SIZE) {
+            dropFrame();
+            continue;
+        }
+        const uint8_t flags = payload[1];
+        if ((flags & PS3_EYE_PAYLOAD_ERR) || !(flags & PS3_EYE_PAYLOAD_PTS)) {
+            dropFrame();
+            continue;
+        }
+
+        const uint32_t pts = static_cast<uint32_t>(payload[2]) |
+                             static_cast<uint32_t>(payload[3]) << 8 |
+                             static_cast<uint32_t>(payload[4]) << 16 |
+                             static_cast<uint32_t>(payload[5]) << 24;
+        const uint8_t fid = flags & PS3_EYE_PAYLOAD_FID;
+
+        // A new PTS or FID starts a frame, anything else continues one
+        if (!have_header_ || pts != last_pts_ || fid != last_fid_) {
+            startFrame(pts, fid);
+        } else if (!collecting_) {
+            continue;  // Rest of a frame that was already dropped
+        }
+        append(payload.subspan(PS3_EYE_PAYLOAD_HEADER_SIZE));
+        if (!collecting_ || !(flags & PS3_EYE_PAYLOAD_EOF)) continue;
+
+        if (filled_ != frame_size_) {
+            LOGD("Dropping short PS3 Eye frame: {} of {} bytes", filled_,
+                 frame_size_);
+            dropFrame();
+        } else {
+            // Dropped frames take a number too, leaving a gap
+            const PS3EyeRawFrame info{.sequence = frames_++ + dropped_,
+                                      .pts = last_pts_,
+                                      .timestamp_ns = monotonic_ns()};
+            if (sink_) sink_(frame_, info);
+            frame_.resize(frame_size_);
+            collecting_ = false;
+            filled_ = 0;
+        }
+        // The next payload starts a frame even if the bridge reuses the PTS
+        have_header_ = false;
+    }
+}
+
+void PS3EyeFrameAssembler::startFrame(uint32_t pts, uint8_t fid) {
+    dropFrame();
+    collecting_ = true;
+    have_header_ = true;
+    last_pts_ = pts;
+    last_fid_ = fid;
+}
+
+void PS3EyeFrameAssembler::append(std::span<const uint8_t> data) {
+    if (filled_ + data.size() > frame_size_) {
+        dropFrame();
+        return;
+    }
+    std::memcpy(frame_.data() + filled_, data.data(), data.size());
+    filled_ += data.size();
+}
+
+void PS3EyeFrameAssembler::dropFrame() {
+    if (collecting_) ++dropped_;
+    collecting_ = false;
+    filled_ = 0;
+}
+
+std::expected<void, std::string> PS3EyePacketRecorder::open(
+    const std::string& path) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return std::unexpected("Failed to open packet recording " + path);
+    }
+    return {};
+}
+
+void PS3EyePacketRecorder::write(std::span<const uint8_t> transfer) {
+    if (!file_.is_open()) return;
+
+    const auto length = static_cast<uint32_t>(transfer.size());
+    const uint8_t prefix[4] = {
+        static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+        static_cast<uint8_t>(length >> 16), static_cast<uint8_t>(length >> 24)};
+    file_.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+    file_.write(reinterpret_cast<const char*>(transfer.data()),
+                static_cast<std::streamsize>(transfer.size()));
+}
+
+void PS3EyePacketRecorder::close() {
+    if (file_.is_open()) file_.close();
+}
+
+std::expected<void, std::string> PS3EyePacketReplay::open(
+    const std::string& path) {
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        return std::unexpected("Failed to open packet recording " + path);
+    }
+    return {};
+}
+
+bool PS3EyePacketReplay::next(std::vector<uint8_t>& transfer) {
+    uint8_t prefix[4];
+    if (!file_.read(reinterpret_cast<char*>(prefix), sizeof(prefix))) {
+        return false;
+    }
+    const uint32_t length = static_cast<uint32_t>(prefix[0]) |
+                            static_cast<uint32_t>(prefix[1]) << 8 |
+                            static_cast<uint32_t>(prefix[2]) << 16 |
+                            static_cast<uint32_t>(prefix[3]) << 24;
+    transfer.resize(length);
+    if (!file_.read(reinterpret_cast<char*>(transfer.data()), length)) {
+        LOGW("Truncated PS3 Eye packet recording, expected {} bytes", length);
+        return false;
+    }
+    return true;
+}
+
+std::size_t PS3EyePacketReplay::replay(PS3EyeFrameAssembler& assembler) {
+    std::vector<uint8_t> transfer;
+    std::size_t count = 0;
+    while (next(transfer)) {
+        assembler.feed(transfer);
+        ++count;
+    }
+    return count;
+}
+
+} // namespace pallas
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pallas {
+
+/**
+ * The OV534 bridge splits each bulk transfer into fixed-size payloads, each
+ * starting with a 12-byte UVC-style header:
+ *
+ *     [0]    header length (12)
+ *     [1]    flags: FID, EOF, PTS, ERR
+ *     [2..5] presentation timestamp, little endian, same for a whole frame
+ *     [6..]  unused
+ */
+constexpr std::size_t PS3_EYE_PAYLOAD_SIZE = 2048;
+constexpr std::size_t PS3_EYE_PAYLOAD_HEADER_SIZE = 12;
+
+constexpr uint8_t PS3_EYE_PAYLOAD_FID = 0x01;  // Toggles every frame
+constexpr uint8_t PS3_EYE_PAYLOAD_EOF = 0x02;  // Last payload of a frame
+constexpr uint8_t PS3_EYE_PAYLOAD_PTS = 0x04;  // Header carries a timestamp
+constexpr uint8_t PS3_EYE_PAYLOAD_ERR = 0x40;  // Bridge reported an error
+
+struct PS3EyeRawFrame {
+    uint64_t sequence{0};    // Frames seen by this assembler, dropped or not
+    uint32_t pts{0};         // Bridge timestamp from the payload headers
+    int64_t timestamp_ns{0}; // CLOCK_MONOTONIC when the last payload arrived
+};
+
+/**
+ * Reassembles YUYV frames from the bulk transfers of an OV534 bridge.
+ *
+ * A frame starts when the PTS or FID of a payload changes and ends at the
+ * payload flagged EOF. Frames that come up short or overflow, e.g. because
+ * a transfer was lost, are dropped instead of being handed out torn.
+ *
+ * Usage:
+ *     PS3EyeFrameAssembler assembler{640, 480};
+ *     assembler.setSink([](std::vector<uint8_t>& frame, const auto& info) {
+ *         .. use or std::swap out frame ..
+ *     });
+ *     assembler.feed(transfer);
+ */
+class PS3EyeFrameAssembler {
+public:
+    // Receives each complete frame. It may swap the vector for another one
+    // of the same size to take the frame without a copy.
+    using FrameSink =
+        std::function<void(std::vector<uint8_t>& frame, const PS3EyeRawFrame&)>;
+
+    PS3EyeFrameAssembler(int width, int height);
+
+    void setSink(FrameSink sink);
+
+    // Parses one completed bulk transfer
+    void feed(std::span<const uint8_t> transfer);
+
+    std::size_t frameSize() const { return frame_size_; }
+    uint64_t frames() const { return frames_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    void startFrame(uint32_t pts, uint8_t fid);
+    void append(std::span<const uint8_t> data);
+    void dropFrame();
+
+    std::size_t frame_size_;
+    std::vector<uint8_t> frame_;
+    std::size_t filled_{0};
+    bool collecting_{false};
+    bool have_header_{false};
+    uint32_t last_pts_{0};
+    uint8_t last_fid_{0};
+    uint64_t frames_{0};
+    uint64_t dropped_{0};
+    FrameSink sink_;
+};
+
+/**
+ * A recording of raw bulk transfers, so the assembler and everything behind
+ * it can be exercised without a camera. The file is a sequence of
+ * [uint32 little-endian length][transfer bytes] records.
+ */
+class PS3EyePacketRecorder {
+public:
+    std::expected<void, std::string> open(const std::string& path);
+    bool isOpen() const { return file_.is_open(); }
+    void write(std::span<const uint8_t> transfer);
+    void close();
+
+private:
+    std::ofstream file_;
+};
+
+class PS3EyePacketReplay {
+public:
+    std::expected<void, std::string> open(const std::string& path);
+
+    // Reads the next recorded transfer into `transfer`. Returns false at the
+    // end of the recording or on a truncated record.
+    bool next(std::vector<uint8_t>& transfer);
+
+    // Feeds every remaining transfer to `assembler`, returning how many
+    // were read
+    std::size_t replay(PS3EyeFrameAssembler& assembler);
+
+private:
+    std::ifstream file_;
+};
+
+} // namespace pallas
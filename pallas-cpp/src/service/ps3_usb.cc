@@ -0,0 +1,656 @@
+#include "ps3_usb.h"
+
+#include <core/logger.h>
+#include <libusb-1.0/libusb.h>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+#include <span>
+#include <utility>
+
+namespace pallas {
+
+namespace {
+
+constexpr uint16_t PS3_EYE_VENDOR_ID = 0x1415;  // Sony
+constexpr uint16_t PS3_EYE_PRODUCT_ID = 0x2000; // PS3 Eye
+constexpr uint8_t VIDEO_ENDPOINT = 0x81;        // Bulk IN
+constexpr unsigned CONTROL_TIMEOUT_MS = 500;
+// Between polls of a busy SCCB transaction, as the kernel ov534 driver waits
+constexpr auto SCCB_BUSY_WAIT = std::chrono::milliseconds(10);
+constexpr uint16_t OV7720_SENSOR_ID = 0x7721;
+
+// OV534 bridge registers
+constexpr uint16_t OV534_REG_ADDRESS = 0xf1;  // SCCB sensor address
+constexpr uint16_t OV534_REG_SUBADDR = 0xf2;
+constexpr uint16_t OV534_REG_WRITE = 0xf3;
+constexpr uint16_t OV534_REG_READ = 0xf4;
+constexpr uint16_t OV534_REG_OPERATION = 0xf5;
+constexpr uint16_t OV534_REG_STATUS = 0xf6;
+constexpr uint8_t OV534_OP_WRITE_3 = 0x37;
+constexpr uint8_t OV534_OP_WRITE_2 = 0x33;
+constexpr uint8_t OV534_OP_READ_2 = 0xf9;
+
+using RegisterValue = std::pair<uint8_t, uint8_t>;
+
+// Register tables follow the gspca ov534 driver
+constexpr RegisterValue BRIDGE_INIT[] = {
+    {0x88, 0xf8}, {0xc3, 0x69}, {0x89, 0xff}, {0x76, 0x03}, {0x92, 0x01},
+    {0x93, 0x18}, {0x94, 0x10}, {0x95, 0x10}, {0xe2, 0x00}, {0xe7, 0x3e},
+    {0x96, 0x00}, {0x97, 0x20}, {0x97, 0x20}, {0x97, 0x20}, {0x97, 0x0a},
+    {0x97, 0x3f}, {0x97, 0x4a}, {0x97, 0x20}, {0x97, 0x15}, {0x97, 0x0b},
+    {0x8e, 0x40}, {0x1f, 0x81}, {0x34, 0x05}, {0xe3, 0x04}, {0x88, 0x00},
+    {0x89, 0x00}, {0x76, 0x00}, {0xe7, 0x2e}, {0x31, 0xf9}, {0x25, 0x42},
+    {0x21, 0xf0},
+    {0x1c, 0x00}, {0x1d, 0x40}, {0x1d, 0x02}, {0x1d, 0x00},  // 2048 B payloads
+    {0x1d, 0x02}, {0x1d, 0x58}, {0x1d, 0x00},                // Frame size
+    {0x1c, 0x0a}, {0x1d, 0x08}, {0x1d, 0x0e},                // UVC headers
+    {0x8d, 0x1c}, {0x8e, 0x80}, {0xe5, 0x04}, {0xc0, 0x50}, {0xc1, 0x3c},
+    {0xc2, 0x0c},
+};
+
+constexpr RegisterValue SENSOR_INIT[] = {
+    {0x12, 0x80}, {0x11, 0x01}, {0x11, 0x01}, {0x11, 0x01}, {0x11, 0x01},
+    {0x11, 0x01}, {0x11, 0x01}, {0x11, 0x01}, {0x11, 0x01}, {0x11, 0x01},
+    {0x11, 0x01}, {0x11, 0x01}, {0x3d, 0x03}, {0x17, 0x26}, {0x18, 0xa0},
+    {0x19, 0x07}, {0x1a, 0xf0}, {0x32, 0x00}, {0x29, 0xa0}, {0x2c, 0xf0},
+    {0x65, 0x20}, {0x11, 0x01}, {0x42, 0x7f}, {0x63, 0xaa}, {0x64, 0xff},
+    {0x66, 0x00}, {0x13, 0xf0}, {0x0d, 0x41}, {0x0f, 0xc5}, {0x14, 0x11},
+    {0x22, 0x7f}, {0x23, 0x03}, {0x24, 0x40}, {0x25, 0x30}, {0x26, 0xa1},
+    {0x2a, 0x00}, {0x2b, 0x00}, {0x6b, 0xaa}, {0x13, 0xff}, {0x90, 0x05},
+    {0x91, 0x01}, {0x92, 0x03}, {0x93, 0x00}, {0x94, 0x60}, {0x95, 0x3c},
+    {0x96, 0x24}, {0x97, 0x1e}, {0x98, 0x62}, {0x99, 0x80}, {0x9a, 0x1e},
+    {0x9b, 0x08}, {0x9c, 0x20}, {0x9e, 0x81}, {0xa6, 0x07}, {0x7e, 0x0c},
+    {0x7f, 0x16}, {0x80, 0x2a}, {0x81, 0x4e}, {0x82, 0x61}, {0x83, 0x6f},
+    {0x84, 0x7b}, {0x85, 0x86}, {0x86, 0x8e}, {0x87, 0x97}, {0x88, 0xa4},
+    {0x89, 0xaf}, {0x8a, 0xc5}, {0x8b, 0xd7}, {0x8c, 0xe8}, {0x8d, 0x20},
+    {0x0c, 0x90}, {0x2b, 0x00}, {0x22, 0x7f}, {0x23, 0x03}, {0x11, 0x01},
+    {0x0c, 0xd0}, {0x64, 0xff}, {0x0d, 0x41}, {0x14, 0x41}, {0x0e, 0xcd},
+    {0xac, 0xbf}, {0x8e, 0x00}, {0x0c, 0xd0},
+};
+
+constexpr RegisterValue BRIDGE_START_VGA[] = {
+    {0x1c, 0x00}, {0x1d, 0x40}, {0x1d, 0x02}, {0x1d, 0x00}, {0x1d, 0x02},
+    {0x1d, 0x58}, {0x1d, 0x00}, {0xc0, 0x50}, {0xc1, 0x3c},
+};
+constexpr RegisterValue SENSOR_START_VGA[] = {
+    {0x12, 0x00}, {0x17, 0x26}, {0x18, 0xa0}, {0x19, 0x07},
+    {0x1a, 0xf0}, {0x29, 0xa0}, {0x2c, 0xf0}, {0x65, 0x20},
+};
+constexpr RegisterValue BRIDGE_START_QVGA[] = {
+    {0x1c, 0x00}, {0x1d, 0x40}, {0x1d, 0x02}, {0x1d, 0x00}, {0x1d, 0x01},
+    {0x1d, 0x4b}, {0x1d, 0x00}, {0xc0, 0x28}, {0xc1, 0x1e},
+};
+constexpr RegisterValue SENSOR_START_QVGA[] = {
+    {0x12, 0x40}, {0x17, 0x3f}, {0x18, 0x50}, {0x19, 0x03},
+    {0x1a, 0x78}, {0x29, 0x50}, {0x2c, 0x78}, {0x65, 0x2f},
+};
+
+// Sensor clock (0x11), PLL (0x0d) and bridge (0xe5) settings per frame
+// rate, fastest first. Faster settings exist but deliver corrupt frames.
+struct FrameRate {
+    int fps;
+    uint8_t r11;
+    uint8_t r0d;
+    uint8_t re5;
+};
+constexpr FrameRate VGA_RATES[] = {
+    {75, 0x01, 0x81, 0x02}, {60, 0x01, 0xc1, 0x04}, {50, 0x01, 0x41, 0x02},
+    {40, 0x02, 0xc1, 0x04}, {30, 0x04, 0x81, 0x02}, {15, 0x03, 0x41, 0x04},
+};
+constexpr FrameRate QVGA_RATES[] = {
+    {187, 0x01, 0x81, 0x02}, {150, 0x00, 0x41, 0x04}, {125, 0x02, 0x81, 0x02},
+    {100, 0x02, 0xc1, 0x04}, {75, 0x03, 0xc1, 0x04},  {60, 0x04, 0xc1, 0x04},
+    {50, 0x02, 0x41, 0x04},  {40, 0x03, 0x41, 0x04},  {30, 0x04, 0x41, 0x04},
+};
+
+// The fastest rate not above `fps`, or the slowest one
+const FrameRate& pick_rate(std::span<const FrameRate> rates, int fps) {
+    for (const auto& rate : rates) {
+        if (rate.fps <= fps) return rate;
+    }
+    return rates.back();
+}
+
+std::span<const FrameRate> rates_for(PS3EyeResolution resolution) {
+    if (resolution == PS3EyeResolution::QVGA) return QVGA_RATES;
+    return VGA_RATES;
+}
+
+int width_for(PS3EyeResolution resolution) {
+    return resolution == PS3EyeResolution::QVGA ? 320 : 640;
+}
+
+int height_for(PS3EyeResolution resolution) {
+    return resolution == PS3EyeResolution::QVGA ? 240 : 480;
+}
+
+// Bus number followed by the port numbers down the hub chain. Stays the
+// same while a camera sits in one port, unlike its bus address, and orders
+// cameras by where they are plugged in.
+using UsbPort = std::vector<uint8_t>;
+
+UsbPort usb_port(libusb_device* device) {
+    std::array<uint8_t, 7> ports{};  // USB allows at most 7 tiers
+    const int depth = libusb_get_port_numbers(device, ports.data(),
+                                              static_cast<int>(ports.size()));
+    UsbPort port{libusb_get_bus_number(device)};
+    if (depth > 0) port.insert(port.end(), ports.begin(), ports.begin() + depth);
+    return port;
+}
+
+// As sysfs names USB devices, e.g. "1-2.3" for port 3 of the hub on port 2
+// of bus 1
+std::string format_port(const UsbPort& port) {
+    std::string name = std::to_string(port.front());
+    for (std::size_t i = 1; i < port.size(); ++i) {
+        name += (i == 1 ? '-' : '.') + std::to_string(port[i]);
+    }
+    return name;
+}
+
+// Device id of the camera in `port`. Ports are numbered in the order they
+// are first seen and keep their number for the life of the process.
+int port_id(const UsbPort& port) {
+    static std::mutex mutex;
+    static std::map<UsbPort, int> ids;
+
+    std::lock_guard lock(mutex);
+    return ids.try_emplace(port, static_cast<int>(ids.size())).first->second;
+}
+
+// Calls visit(device, id, port) for each PS3 Eye on the bus, in port order,
+// until it returns true. Numbering the whole bus in port order first means
+// cameras attached at startup get ids in the order of their ports.
+void visit_cameras(
+    libusb_context* context,
+    const std::function<bool(libusb_device*, int, const UsbPort&)>& visit) {
+    libusb_device** devices = nullptr;
+    const ssize_t count = libusb_get_device_list(context, &devices);
+    if (count < 0) {
+        LOGE("Failed to get USB device list: {}",
+             libusb_error_name(static_cast<int>(count)));
+        return;
+    }
+
+    std::vector<std::pair<UsbPort, libusb_device*>> cameras;
+    for (ssize_t i = 0; i < count; ++i) {
+        libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(devices[i], &desc) == 0 &&
+            desc.idVendor == PS3_EYE_VENDOR_ID &&
+            desc.idProduct == PS3_EYE_PRODUCT_ID) {
+            cameras.emplace_back(usb_port(devices[i]), devices[i]);
+        }
+    }
+    std::sort(cameras.begin(), cameras.end());
+    for (const auto& [port, device] : cameras) {
+        if (visit(device, port_id(port), port)) break;
+    }
+    libusb_free_device_list(devices, 1);
+}
+
+}  // namespace
+
+PS3EyeUSB::PS3EyeUSB(PS3EyeUSBConfig config)
+    : config_(std::move(config)),
+      width_(width_for(config_.resolution)),
+      height_(height_for(config_.resolution)),
+      fps_(pick_rate(rates_for(config_.resolution), config_.fps).fps),
+      assembler_(width_, height_),
+      ready_frame_(assembler_.frameSize()),
+      read_frame_(assembler_.frameSize()) {
+    assembler_.setSink(
+        [this](std::vector<uint8_t>& frame, const PS3EyeRawFrame& info) {
+            onFrame(frame, info);
+        });
+}
+
+PS3EyeUSB::~PS3EyeUSB() {
+    close();
+}
+
+std::shared_ptr<libusb_context> PS3EyeUSB::sharedContext() {
+    static std::mutex mutex;
+    static std::weak_ptr<libusb_context> shared;
+
+    std::lock_guard lock(mutex);
+    if (auto context = shared.lock()) return context;
+
+    libusb_context* raw = nullptr;
+    if (int result = libusb_init(&raw); result != 0) {
+        LOGE("Failed to initialize libusb: {}", libusb_error_name(result));
+        return nullptr;
+    }
+    std::shared_ptr<libusb_context> context(raw, libusb_exit);
+    shared = context;
+    return context;
+}
+
+std::vector<int> PS3EyeUSB::deviceIds() {
+    std::vector<int> ids;
+    auto context = sharedContext();
+    if (!context) return ids;
+
+    visit_cameras(context.get(),
+                  [&](libusb_device*, int id,
+                      [[maybe_unused]] const UsbPort& port) {
+                      LOGD("Found PS3 Eye camera {} on USB port {}", id,
+                           format_port(port));
+                      ids.push_back(id);
+                      return false;
+                  });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+std::expected<void, std::string> PS3EyeUSB::open() {
+    if (isOpen()) return {};
+
+    context_ = sharedContext();
+    if (!context_) {
+        return std::unexpected("Failed to initialize libusb");
+    }
+
+    // Find the camera by the port its id stands for
+    int open_result = LIBUSB_ERROR_NOT_FOUND;
+    visit_cameras(context_.get(),
+                  [&](libusb_device* device, int id, const UsbPort&) {
+                      if (id != config_.device_id) return false;
+                      open_result = libusb_open(device, &handle_);
+                      return true;
+                  });
+    if (open_result != 0) {
+        handle_ = nullptr;
+        close();
+        return std::unexpected("Failed to open PS3 Eye USB device " +
+                               std::to_string(config_.device_id) + ": " +
+                               libusb_error_name(open_result));
+    }
+
+    // Take the camera away from gspca_ov534 for as long as we hold it
+    libusb_set_auto_detach_kernel_driver(handle_, 1);
+    if (int result = libusb_claim_interface(handle_, 0); result != 0) {
+        close();
+        return std::unexpected(
+            std::string("Failed to claim PS3 Eye interface: ") +
+            libusb_error_name(result));
+    }
+    interface_claimed_ = true;
+
+    if (auto result = initSensor(); !result) {
+        close();
+        return result;
+    }
+    if (auto result = startStream(); !result) {
+        close();
+        return result;
+    }
+
+    LOGI("PS3 Eye USB camera {} streaming {}x{} at {} fps",
+         config_.device_id, width_, height_, fps_);
+    return {};
+}
+
+bool PS3EyeUSB::isOpen() const {
+    return handle_ && running_.load();
+}
+
+void PS3EyeUSB::close() {
+    if (running_.exchange(false)) {
+        {
+            std::lock_guard lock(control_mutex_);
+            regWrite(0xe0, 0x09);  // Stop the bridge
+            setLed(false);
+        }
+        for (auto* transfer : transfers_) libusb_cancel_transfer(transfer);
+    }
+    // The event thread drains the cancelled transfers before it exits
+    if (event_thread_.joinable()) event_thread_.join();
+    frame_ready_.notify_all();
+
+    for (auto* transfer : transfers_) libusb_free_transfer(transfer);
+    transfers_.clear();
+    transfer_buffers_.clear();
+    recorder_.close();
+
+    if (handle_) {
+        if (interface_claimed_) libusb_release_interface(handle_, 0);
+        interface_claimed_ = false;
+        libusb_close(handle_);
+        handle_ = nullptr;
+        LOGI("PS3 Eye USB camera {} closed", config_.device_id);
+    }
+    context_.reset();
+}
+
+std::expected<PS3EyeUSBFrame, std::string> PS3EyeUSB::waitFrame(
+    std::chrono::milliseconds timeout) {
+    std::unique_lock lock(frame_mutex_);
+    frame_ready_.wait_for(lock, timeout,
+                          [this] { return has_ready_ || !running_.load(); });
+    if (!has_ready_) {
+        if (!running_.load()) {
+            return std::unexpected("PS3 Eye USB camera is not streaming");
+        }
+        return std::unexpected("Timed out waiting for a PS3 Eye USB frame");
+    }
+
+    // Take the frame; the event thread keeps filling the other buffer
+    std::swap(ready_frame_, read_frame_);
+    has_ready_ = false;
+    return PS3EyeUSBFrame{
+        .data = read_frame_.data(),
+        .width = width_,
+        .height = height_,
+        .stride = static_cast<std::size_t>(width_) * 2,
+        .info = ready_info_,
+    };
+}
+
+void PS3EyeUSB::onTransfer(libusb_transfer* transfer) {
+    auto* self = static_cast<PS3EyeUSB*>(transfer->user_data);
+
+    switch (transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED: {
+            const std::span<const uint8_t> data(
+                transfer->buffer,
+                static_cast<std::size_t>(transfer->actual_length));
+            self->recorder_.write(data);
+            self->assembler_.feed(data);
+            break;
+        }
+        case LIBUSB_TRANSFER_CANCELLED:
+            break;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            LOGE("PS3 Eye USB camera {} was disconnected",
+                 self->config_.device_id);
+            self->running_.store(false);
+            self->frame_ready_.notify_all();
+            break;
+        default:
+            // A lost transfer tears the frame in flight, which the
+            // assembler drops when the next frame starts
+            LOGW("PS3 Eye USB transfer failed with status {}",
+                 static_cast<int>(transfer->status));
+            break;
+    }
+
+    if (self->running_.load() && libusb_submit_transfer(transfer) == 0) {
+        return;
+    }
+    self->in_flight_.fetch_sub(1);
+}
+
+void PS3EyeUSB::eventLoop() {
+    while (running_.load() || in_flight_.load() > 0) {
+        timeval timeout{.tv_sec = 0, .tv_usec = 50'000};
+        libusb_handle_events_timeout_completed(context_.get(), &timeout,
+                                               nullptr);
+    }
+}
+
+void PS3EyeUSB::onFrame(std::vector<uint8_t>& frame,
+                        const PS3EyeRawFrame& info) {
+    {
+        std::lock_guard lock(frame_mutex_);
+        if (has_ready_) ++unread_dropped_;  // The reader is falling behind
+        std::swap(frame, ready_frame_);
+        ready_info_ = info;
+        has_ready_ = true;
+        torn_dropped_ = assembler_.dropped();
+    }
+    frame_ready_.notify_one();
+}
+
+std::expected<void, std::string> PS3EyeUSB::initSensor() {
+    std::lock_guard lock(control_mutex_);
+
+    // Reset the bridge and point its SCCB master at the sensor
+    regWrite(0xe7, 0x3a);
+    regWrite(0xe0, 0x08);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    regWrite(OV534_REG_ADDRESS, 0x42);
+
+    if (!sccbWrite(0x12, 0x80)) {
+        return std::unexpected("Failed to reset the PS3 Eye sensor");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    const int id_high = sccbRead(0x0a);
+    const int id_low = sccbRead(0x0b);
+    if (id_high < 0 || id_low < 0) {
+        return std::unexpected("Failed to read the PS3 Eye sensor ID");
+    }
+    const uint16_t sensor_id = static_cast<uint16_t>(id_high << 8 | id_low);
+    if (sensor_id != OV7720_SENSOR_ID) {
+        LOGW("Unexpected PS3 Eye sensor ID {:#06x}, expected {:#06x}",
+             sensor_id, OV7720_SENSOR_ID);
+    }
+
+    for (const auto& [reg, value] : BRIDGE_INIT) regWrite(reg, value);
+    setLed(true);
+    for (const auto& [reg, value] : SENSOR_INIT) {
+        if (!sccbWrite(reg, value)) {
+            return std::unexpected("Failed to initialize the PS3 Eye sensor");
+        }
+    }
+    regWrite(0xe0, 0x09);
+    setLed(false);
+    return {};
+}
+
+std::expected<void, std::string> PS3EyeUSB::startStream() {
+    {
+        std::lock_guard lock(control_mutex_);
+        const bool qvga = config_.resolution == PS3EyeResolution::QVGA;
+        const std::span<const RegisterValue> bridge_start =
+            qvga ? std::span<const RegisterValue>(BRIDGE_START_QVGA)
+                 : std::span<const RegisterValue>(BRIDGE_START_VGA);
+        const std::span<const RegisterValue> sensor_start =
+            qvga ? std::span<const RegisterValue>(SENSOR_START_QVGA)
+                 : std::span<const RegisterValue>(SENSOR_START_VGA);
+        for (const auto& [reg, value] : bridge_start) regWrite(reg, value);
+        for (const auto& [reg, value] : sensor_start) sccbWrite(reg, value);
+        if (!setFrameRate()) {
+            return std::unexpected("Failed to set the PS3 Eye frame rate");
+        }
+    }
+
+    if (!config_.record_path.empty()) {
+        if (auto result = recorder_.open(config_.record_path); !result) {
+            return result;
+        }
+        LOGI("Recording PS3 Eye USB transfers to {}", config_.record_path);
+    }
+
+    // Queue the transfer ring before the bridge starts sending. The event
+    // thread runs first, so close() can drain a partly submitted ring.
+    transfer_buffers_.assign(config_.transfer_count,
+                             std::vector<uint8_t>(config_.transfer_size));
+    running_.store(true);
+    event_thread_ = std::thread([this] { eventLoop(); });
+    for (auto& buffer : transfer_buffers_) {
+        libusb_transfer* transfer = libusb_alloc_transfer(0);
+        if (!transfer) {
+            return std::unexpected("Failed to allocate a PS3 Eye USB transfer");
+        }
+        transfers_.push_back(transfer);
+        libusb_fill_bulk_transfer(transfer, handle_, VIDEO_ENDPOINT,
+                                  buffer.data(), static_cast<int>(buffer.size()),
+                                  &PS3EyeUSB::onTransfer, this, 0);
+        if (int result = libusb_submit_transfer(transfer); result != 0) {
+            return std::unexpected(
+                std::string("Failed to submit a PS3 Eye USB transfer: ") +
+                libusb_error_name(result));
+        }
+        in_flight_.fetch_add(1);
+    }
+
+    std::lock_guard lock(control_mutex_);
+    setLed(true);
+    regWrite(0xe0, 0x00);  // Start streaming
+    return {};
+}
+
+bool PS3EyeUSB::setFrameRate() {
+    const FrameRate& rate = pick_rate(rates_for(config_.resolution), fps_);
+    return sccbWrite(0x11, rate.r11) && sccbWrite(0x0d, rate.r0d) &&
+           regWrite(0xe5, rate.re5);
+}
+
+void PS3EyeUSB::setLed(bool on) {
+    int data = regRead(0x21);
+    if (data < 0) return;
+    regWrite(0x21, static_cast<uint8_t>(data | 0x80));
+
+    data = regRead(0x23);
+    if (data < 0) return;
+    regWrite(0x23, static_cast<uint8_t>(on ? data | 0x80 : data & ~0x80));
+
+    if (!on) {
+        data = regRead(0x21);
+        if (data < 0) return;
+        regWrite(0x21, static_cast<uint8_t>(data & ~0x80));
+    }
+}
+
+bool PS3EyeUSB::setAutoGain(bool enable) {
+    std::lock_guard lock(control_mutex_);
+    // Automatic gain and exposure (COM8 AGC | AEC) go together
+    return sccbUpdate(0x13, 0x05, enable ? 0x05 : 0x00) &&
+           sccbUpdate(0x64, 0x03, enable ? 0x03 : 0x00);
+}
+
+bool PS3EyeUSB::setGain(int gain) {
+    std::lock_guard lock(control_mutex_);
+    // Bits 4-5 select the analog gain stage, bits 0-3 the fine gain
+    const uint8_t fine = static_cast<uint8_t>(gain & 0x0f);
+    uint8_t value;
+    switch (gain & 0x30) {
+        case 0x00: value = fine; break;
+        case 0x10: value = fine | 0x30; break;
+        case 0x20: value = fine | 0x70; break;
+        default: value = fine | 0xf0; break;
+    }
+    return sccbWrite(0x00, value);
+}
+
+bool PS3EyeUSB::setExposure(int exposure) {
+    std::lock_guard lock(control_mutex_);
+    const uint8_t value = static_cast<uint8_t>(exposure);
+    return sccbWrite(0x08, value >> 7) &&
+           sccbWrite(0x10, static_cast<uint8_t>(value << 1));
+}
+
+bool PS3EyeUSB::setAutoWhiteBalance(bool enable) {
+    std::lock_guard lock(control_mutex_);
+    return sccbUpdate(0x13, 0x02, enable ? 0x02 : 0x00) &&
+           sccbWrite(0x63, enable ? 0xe0 : 0xaa);
+}
+
+bool PS3EyeUSB::setRedBalance(int red_balance) {
+    std::lock_guard lock(control_mutex_);
+    return sccbWrite(0x43, static_cast<uint8_t>(red_balance));
+}
+
+bool PS3EyeUSB::setBlueBalance(int blue_balance) {
+    std::lock_guard lock(control_mutex_);
+    return sccbWrite(0x42, static_cast<uint8_t>(blue_balance));
+}
+
+bool PS3EyeUSB::setFlip(bool horizontal, bool vertical) {
+    std::lock_guard lock(control_mutex_);
+    // The sensor is mounted mirrored, so a cleared bit means flipped
+    return sccbUpdate(0x0c, 0xc0,
+                      (horizontal ? 0x00 : 0x40) | (vertical ? 0x00 : 0x80));
+}
+
+int PS3EyeUSB::width() const {
+    return width_;
+}
+
+int PS3EyeUSB::height() const {
+    return height_;
+}
+
+int PS3EyeUSB::fps() const {
+    return fps_;
+}
+
+uint64_t PS3EyeUSB::dropped() const {
+    std::lock_guard lock(frame_mutex_);
+    return torn_dropped_ + unread_dropped_;
+}
+
+bool PS3EyeUSB::regWrite(uint16_t reg, uint8_t value) {
+    if (!handle_) return false;
+    const int result = libusb_control_transfer(
+        handle_,
+        LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR |
+            LIBUSB_RECIPIENT_DEVICE,
+        0x01, 0x0000, reg, &value, 1, CONTROL_TIMEOUT_MS);
+    if (result < 0) {
+        LOGW("PS3 Eye bridge write {:#04x} failed: {}", reg,
+             libusb_error_name(result));
+        return false;
+    }
+    return true;
+}
+
+int PS3EyeUSB::regRead(uint16_t reg) {
+    if (!handle_) return -1;
+    uint8_t value = 0;
+    const int result = libusb_control_transfer(
+        handle_,
+        LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR |
+            LIBUSB_RECIPIENT_DEVICE,
+        0x01, 0x0000, reg, &value, 1, CONTROL_TIMEOUT_MS);
+    if (result < 0) {
+        LOGW("PS3 Eye bridge read {:#04x} failed: {}", reg,
+             libusb_error_name(result));
+        return -1;
+    }
+    return value;
+}
+
+bool PS3EyeUSB::sccbCheckStatus() {
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        switch (regRead(OV534_REG_STATUS)) {
+            case 0x00: return true;   // Done
+            case 0x03:                // Busy, give the transaction time
+                std::this_thread::sleep_for(SCCB_BUSY_WAIT);
+                break;
+            case 0x04: return false;  // Sensor did not acknowledge
+            default: return false;
+        }
+    }
+    return false;
+}
+
+bool PS3EyeUSB::sccbWrite(uint8_t reg, uint8_t value) {
+    return regWrite(OV534_REG_SUBADDR, reg) &&
+           regWrite(OV534_REG_WRITE, value) &&
+           regWrite(OV534_REG_OPERATION, OV534_OP_WRITE_3) &&
+           sccbCheckStatus();
+}
+
+int PS3EyeUSB::sccbRead(uint8_t reg) {
+    if (!regWrite(OV534_REG_SUBADDR, reg) ||
+        !regWrite(OV534_REG_OPERATION, OV534_OP_WRITE_2) ||
+        !sccbCheckStatus() ||
+        !regWrite(OV534_REG_OPERATION, OV534_OP_READ_2) ||
+        !sccbCheckStatus()) {
+        return -1;
+    }
+    return regRead(OV534_REG_READ);
+}
+
+bool PS3EyeUSB::sccbUpdate(uint8_t reg, uint8_t clear, uint8_t set) {
+    const int value = sccbRead(reg);
+    if (value < 0) return false;
+    return sccbWrite(reg, static_cast<uint8_t>((value & ~clear) | set));
+}
+
+} // namespace pallas
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ps3_packets.h"
+
+struct libusb_context;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+namespace pallas {
+
+enum class PS3EyeResolution {
+    VGA,   // 640x480, up to 75 fps
+    QVGA,  // 320x240, up to 187 fps
+};
+
+struct PS3EyeUSBConfig {
+    int device_id{0};            // As listed by deviceIds()
+    PS3EyeResolution resolution{PS3EyeResolution::VGA};
+    int fps{60};                 // Rounded down to the nearest sensor rate
+    int transfer_count{8};       // Bulk transfers kept in flight
+    std::size_t transfer_size{64 * 1024}; // Multiple of PS3_EYE_PAYLOAD_SIZE
+    std::string record_path{};   // Record raw transfers here for replay
+};
+
+// A frame in the camera's YUYV format, valid until the next waitFrame()
+struct PS3EyeUSBFrame {
+    const uint8_t* data{nullptr};
+    int width{0};
+    int height{0};
+    std::size_t stride{0};  // Bytes per line
+    PS3EyeRawFrame info;
+};
+
+/**
+ * User-space driver for the PS3 Eye (OV534 bridge, OV7720 sensor) over
+ * libusb, bypassing the kernel's gspca driver.
+ *
+ * The camera streams over a bulk endpoint. A ring of asynchronous bulk
+ * transfers is kept in flight by a dedicated event thread, which
+ * reassembles frames and hands the newest one to waitFrame(). A frame that
+ * is not picked up before the next one completes is counted as dropped.
+ * Cameras in one process share a libusb context; libusb lets their event
+ * threads take turns handling its events.
+ *
+ * Sensor controls write the OV7720 registers directly over the bridge's
+ * SCCB interface, so colour balance and exposure are the sensor's own.
+ */
+class PS3EyeUSB {
+public:
+    explicit PS3EyeUSB(PS3EyeUSBConfig config = {});
+    ~PS3EyeUSB();
+
+    // Non-copyable
+    PS3EyeUSB(const PS3EyeUSB&) = delete;
+    PS3EyeUSB& operator=(const PS3EyeUSB&) = delete;
+
+    // libusb context shared by every camera and device scan in the process,
+    // released with its last user. Null if libusb fails to initialize.
+    static std::shared_ptr<libusb_context> sharedContext();
+
+    // Ids of the PS3 Eye cameras on the bus. An id stands for the USB port
+    // (bus and hub chain) the camera is plugged into, numbered in port order
+    // on the first scan and in order of appearance after that, so a camera
+    // keeps its id across unplugging and replugging into the same port and
+    // other cameras coming and going never renumber it.
+    static std::vector<int> deviceIds();
+
+    // Claims the camera, initializes the bridge and sensor and starts
+    // streaming
+    std::expected<void, std::string> open();
+
+    bool isOpen() const;
+
+    void close();
+
+    // Waits up to `timeout` for a frame newer than the last one returned
+    std::expected<PS3EyeUSBFrame, std::string> waitFrame(
+        std::chrono::milliseconds timeout);
+
+    bool setAutoGain(bool enable);
+    bool setGain(int gain);              // 0..63
+    bool setExposure(int exposure);      // 0..255
+    bool setAutoWhiteBalance(bool enable);
+    bool setRedBalance(int red_balance);   // 0..255
+    bool setBlueBalance(int blue_balance); // 0..255
+    bool setFlip(bool horizontal, bool vertical);
+
+    int width() const;
+    int height() const;
+    // Sensor frame rate actually selected
+    int fps() const;
+    // Frames lost to USB errors plus frames never picked up by waitFrame()
+    uint64_t dropped() const;
+
+private:
+    static void onTransfer(libusb_transfer* transfer);
+    void eventLoop();
+    void onFrame(std::vector<uint8_t>& frame, const PS3EyeRawFrame& info);
+
+    std::expected<void, std::string> initSensor();
+    std::expected<void, std::string> startStream();
+    bool setFrameRate();
+    void setLed(bool on);
+
+    // OV534 bridge registers
+    bool regWrite(uint16_t reg, uint8_t value);
+    int regRead(uint16_t reg);
+    // OV7720 sensor registers, over the bridge's SCCB bus
+    bool sccbCheckStatus();
+    bool sccbWrite(uint8_t reg, uint8_t value);
+    int sccbRead(uint8_t reg);
+    bool sccbUpdate(uint8_t reg, uint8_t clear, uint8_t set);
+
+    PS3EyeUSBConfig config_;
+    int width_;
+    int height_;
+    int fps_;
+    std::shared_ptr<libusb_context> context_;
+    libusb_device_handle* handle_{nullptr};
+    bool interface_claimed_{false};
+    std::mutex control_mutex_;  // Serializes multi-step register sequences
+
+    std::vector<libusb_transfer*> transfers_;
+    std::vector<std::vector<uint8_t>> transfer_buffers_;
+    std::atomic<int> in_flight_{0};
+    std::atomic<bool> running_{false};
+    std::thread event_thread_;
+
+    PS3EyeFrameAssembler assembler_;
+    PS3EyePacketRecorder recorder_;
+
+    // Frame handoff from the event thread to waitFrame()
+    mutable std::mutex frame_mutex_;
+    std::condition_variable frame_ready_;
+    std::vector<uint8_t> ready_frame_;
+    std::vector<uint8_t> read_frame_;
+    PS3EyeRawFrame ready_info_;
+    bool has_ready_{false};
+    uint64_t unread_dropped_{0};
+    uint64_t torn_dropped_{0};  // Assembler drops, as of the last frame
+};
+
+} // namespace pallas
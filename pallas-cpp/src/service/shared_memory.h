@@ -0,0 +1,202 @@
+#pragma once
+#include <core/logger.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace pallas {
+
+// Let the kernel place pages wherever it likes
+constexpr int NUMA_NODE_ANY = -1;
+// Bind pages to the NUMA node of the thread that creates the mapping
+constexpr int NUMA_NODE_LOCAL = -2;
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+constexpr const char* HUGETLBFS_MOUNT = "/dev/hugepages";
+
+/**
+ * How the pages behind a shared-memory frame queue are backed.
+ *
+ * The defaults match plain shm_open + mmap with 4 KiB pages that are faulted
+ * in lazily by whoever touches them first.
+ */
+struct SharedMemoryOptions {
+    // Back the mapping with 2 MiB pages. Uses a file on hugetlbfs when one is
+    // mounted with enough reserved pages, otherwise asks for transparent huge
+    // pages on /dev/shm via madvise(MADV_HUGEPAGE).
+    bool huge_pages = false;
+    // Fault every page in at creation so the first frames do not stall
+    bool populate = false;
+    // NUMA node to bind the pages to, or NUMA_NODE_ANY / NUMA_NODE_LOCAL
+    int numa_node = NUMA_NODE_ANY;
+};
+
+/**
+ * A named shared-memory mapping, either in /dev/shm or on hugetlbfs.
+ *
+ * Consumers Open() by name without knowing how the producer created it.
+ */
+struct SharedMemoryRegion {
+    int fd = -1;
+    void* memory = MAP_FAILED;
+    size_t size = 0;
+    bool huge_pages = false;
+
+    bool is_valid() const { return memory != MAP_FAILED && memory != nullptr; }
+
+    static SharedMemoryRegion Create(const std::string& name, size_t size,
+                                     const SharedMemoryOptions& options = {}) {
+        SharedMemoryRegion region;
+        if (options.huge_pages) {
+            region = map_hugetlbfs(name, size);
+            if (!region.is_valid()) {
+                LOGW(
+                    "No hugetlbfs pages available for {}, falling back to "
+                    "transparent huge pages",
+                    name);
+                region = map_shm(name, round_up(size, HUGE_PAGE_SIZE));
+                if (region.is_valid() &&
+                    madvise(region.memory, region.size, MADV_HUGEPAGE) == -1) {
+                    LOGW("madvise(MADV_HUGEPAGE) failed for {}: {}", name,
+                         std::strerror(errno));
+                }
+            }
+        } else {
+            region = map_shm(name, size);
+        }
+        if (!region.is_valid()) return region;
+
+        // Bind before faulting anything in, so pages land on the right node
+        if (options.numa_node != NUMA_NODE_ANY) {
+            bind_to_node(region, options.numa_node, name);
+        }
+        if (options.populate) {
+            populate(region);
+        }
+        LOGI("Created shared memory {} of {} bytes (huge_pages={}, numa={})",
+             name, region.size, region.huge_pages, options.numa_node);
+        return region;
+    }
+
+    static SharedMemoryRegion Open(const std::string& name) {
+        SharedMemoryRegion region;
+        region.fd = shm_open(name.c_str(), O_RDWR, 0666);
+        if (region.fd == -1) {
+            region.fd = open(hugetlbfs_path(name).c_str(), O_RDWR);
+            region.huge_pages = region.fd != -1;
+        }
+        if (region.fd == -1) return region;
+
+        struct stat sb;
+        if (fstat(region.fd, &sb) == -1) return region;
+        region.size = sb.st_size;
+        region.memory = mmap(NULL, region.size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, region.fd, 0);
+        return region;
+    }
+
+    // Removes the name from both /dev/shm and hugetlbfs
+    static void Unlink(const std::string& name) {
+        shm_unlink(name.c_str());
+        unlink(hugetlbfs_path(name).c_str());
+    }
+
+   private:
+    static size_t round_up(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static std::string hugetlbfs_path(const std::string& name) {
+        const size_t start = name.find_first_not_of('/');
+        return std::string(HUGETLBFS_MOUNT) + "/" +
+               (start == std::string::npos ? name : name.substr(start));
+    }
+
+    static SharedMemoryRegion map_fd(int fd, size_t size) {
+        SharedMemoryRegion region;
+        region.fd = fd;
+        if (fd == -1 || ftruncate(fd, size) == -1) return region;
+        region.size = size;
+        region.memory =
+            mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return region;
+    }
+
+    static SharedMemoryRegion map_shm(const std::string& name, size_t size) {
+        SharedMemoryRegion region =
+            map_fd(shm_open(name.c_str(), O_CREAT | O_RDWR, 0666), size);
+        if (!region.is_valid()) shm_unlink(name.c_str());
+        return region;
+    }
+
+    static SharedMemoryRegion map_hugetlbfs(const std::string& name,
+                                            size_t size) {
+        const std::string path = hugetlbfs_path(name);
+        SharedMemoryRegion region =
+            map_fd(open(path.c_str(), O_CREAT | O_RDWR, 0666),
+                   round_up(size, HUGE_PAGE_SIZE));
+        region.huge_pages = true;
+        if (!region.is_valid()) {
+            // mmap fails with ENOMEM when the hugepage pool is too small
+            if (region.fd != -1) close(region.fd);
+            unlink(path.c_str());
+            region.fd = -1;
+        }
+        return region;
+    }
+
+    // Calls mbind directly so we do not need libnuma at build time
+    static void bind_to_node(const SharedMemoryRegion& region, int node,
+                             const std::string& name) {
+        constexpr int MPOL_BIND_MODE = 2;
+        constexpr size_t MAX_NODES = 1024;
+
+        if (node == NUMA_NODE_LOCAL) {
+            unsigned cpu = 0, local_node = 0;
+            if (syscall(SYS_getcpu, &cpu, &local_node, nullptr) == -1) {
+                LOGW("getcpu failed, not binding {} to a NUMA node", name);
+                return;
+            }
+            node = static_cast<int>(local_node);
+        }
+        if (node < 0 || static_cast<size_t>(node) >= MAX_NODES) {
+            LOGW("Invalid NUMA node {} for {}", node, name);
+            return;
+        }
+
+        unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+        mask[node / (8 * sizeof(unsigned long))] |=
+            1UL << (node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_mbind, region.memory, region.size, MPOL_BIND_MODE,
+                    mask, MAX_NODES + 1, 0) == -1) {
+            LOGW("mbind of {} to NUMA node {} failed: {}", name, node,
+                 std::strerror(errno));
+        }
+    }
+
+    static void populate(const SharedMemoryRegion& region) {
+#ifndef MADV_POPULATE_WRITE
+        constexpr int MADV_POPULATE_WRITE = 23;  // Linux 5.14
+#endif
+        if (madvise(region.memory, region.size, MADV_POPULATE_WRITE) == 0) {
+            return;
+        }
+        // Older kernels: touch one byte per page. The region is freshly
+        // created so it is all zeroes and writing zero keeps it that way.
+        const size_t page_size = sysconf(_SC_PAGE_SIZE);
+        auto* bytes = static_cast<volatile uint8_t*>(region.memory);
+        for (size_t offset = 0; offset < region.size; offset += page_size) {
+            bytes[offset] = 0;
+        }
+    }
+};
+
+}  // namespace pallas
@@ -1,33 +1,25 @@
 #include "stream_service.h"
 
 #include <core/logger.h>
+#include <core/trace.h>
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <regex>
+#include <sstream>
 #include <thread>
 #include <vector>
 
 namespace pallas {
 
-// Cache for preprocessed JPEG frames to avoid redundant encoding
-struct CachedFrame {
-    std::vector<uint8_t> jpeg_data;
-    std::chrono::steady_clock::time_point timestamp;
-    int original_width;
-    int original_height;
-    bool has_detections;
-};
-
-// Static cache with a mutex to protect access
-static std::mutex frame_cache_mutex;
-static std::unordered_map<std::string, CachedFrame> frame_cache;
-static constexpr int CACHE_TTL_MS = 32; // Cache for 32ms (~30fps)
 static constexpr int JPEG_QUALITY_STREAMING = 85; // Better quality-to-size ratio
 static constexpr int MAX_DISPLAY_WIDTH = 640; // Larger frames for better quality
+// Pace of the test frame generator when no camera queue is available
+static constexpr auto TEST_FRAME_TICK = std::chrono::milliseconds(33);
 
 // Helper function to read a file into a string
 static std::string readFile(const std::string& path) {
@@ -76,6 +68,41 @@ StreamService::StreamService(StreamServiceConfig config)
       use_gpu_(config.use_gpu),
       active_detection_camera_(config.active_detection_camera),
       yolo_(nullptr) {
+    MetricsRegistry& metrics = MetricsRegistry::Shared();
+    for (const auto& camera_id : camera_ids_) {
+        const MetricLabels labels = {{"camera", camera_id}};
+        camera_metrics_.emplace(
+            camera_id,
+            CameraMetrics{
+                .frames_received = metrics.counter(
+                    "pallas_stream_frames_received_total",
+                    "Frames taken from the camera queue", labels),
+                .producer_dropped = metrics.counter(
+                    "pallas_stream_producer_dropped_frames_total",
+                    "Frames the camera lost before publishing", labels),
+                .consumer_dropped = metrics.counter(
+                    "pallas_stream_consumer_dropped_frames_total",
+                    "Frames skipped or overwritten before this service "
+                    "took them",
+                    labels),
+                .queue_depth = metrics.gauge(
+                    "pallas_stream_queue_depth",
+                    "Frames waiting in the camera queue when last polled",
+                    labels),
+                .detect_latency = metrics.duration(
+                    "pallas_stream_detect_seconds",
+                    "Time to run person detection on a frame", labels),
+                .encode_latency = metrics.duration(
+                    "pallas_stream_encode_seconds",
+                    "Time to encode a frame to JPEG", labels),
+                .encoded_bytes = metrics.counter(
+                    "pallas_stream_encoded_bytes_total",
+                    "Size of the encoded JPEG frames", labels),
+                .sent_bytes = metrics.counter(
+                    "pallas_stream_sent_bytes_total",
+                    "JPEG bytes queued to HTTP clients", labels),
+            });
+    }
           
     if (use_person_detector_) {
         LOGI("Initializing YOLO person detector with model {} and labels {}", 
@@ -97,6 +124,15 @@ StreamService::StreamService(StreamServiceConfig config)
             use_person_detector_ = false;
         }
     }
+
+    buildPipeline();
+}
+
+// Only the tick thread, its queue watches and the pipeline: the HTTP server
+// may never have been started. All must end before the queues are unmapped
+StreamService::~StreamService() {
+    Service::stop();
+    pipeline_.stop();
 }
 
 void StreamService::eventHandler(struct mg_connection* c, int ev,
@@ -112,6 +148,21 @@ void StreamService::eventHandler(struct mg_connection* c, int ev,
         if (uri == "/api/cameras") {
             // List all cameras
             handleListCameras(c, service);
+        } else if (uri == "/metrics") {
+            // Prometheus scrape
+            std::ostringstream metrics;
+            MetricsRegistry::Shared().write_prometheus(metrics);
+            mg_http_reply(c, 200,
+                          "Content-Type: text/plain; version=0.0.4\r\n",
+                          "%s", metrics.str().c_str());
+        } else if (uri == "/api/trace") {
+            // Chrome trace of the recent spans of every thread
+            std::ostringstream trace;
+            Tracer::write_chrome_trace(trace);
+            mg_http_reply(c, 200,
+                          "Content-Type: application/json\r\n"
+                          "Access-Control-Allow-Origin: *\r\n",
+                          "%s", trace.str().c_str());
         } else if (uri.find("/api/cameras/") == 0 &&
                    uri.find("/stream") != std::string::npos) {
             // MJPEG streaming endpoint
@@ -155,7 +206,8 @@ void StreamService::eventHandler(struct mg_connection* c, int ev,
                 {"endpoints",
                  {"/api/cameras", "/api/cameras/{camera_id}",
                   "/api/cameras/{camera_id}/frame",
-                  "/api/cameras/{camera_id}/stream"}},
+                  "/api/cameras/{camera_id}/stream", "/api/trace",
+                  "/metrics"}},
                 {"message", "Pallas Stream Service API"}};
 
             std::string json_str = api_info.dump(2);
@@ -284,6 +336,7 @@ void StreamService::handleMjpegStream(struct mg_connection* c,
             // Timer callback - send frame to all active MJPEG connections
             auto* conn_map = static_cast<std::unordered_map<mg_connection*, std::string>*>(arg);
             if (!conn_map) return;  // Safety check
+            TRACE_SCOPE("http.mjpeg_send");
             
             // Use mutex to protect the connections map
             static std::mutex mjpeg_connections_mutex;
@@ -318,6 +371,16 @@ void StreamService::handleMjpegStream(struct mg_connection* c,
                 }
             }
             
+            // Shared by every StreamService of the process, like the map
+            static Gauge& clients = MetricsRegistry::Shared().gauge(
+                "pallas_stream_mjpeg_clients",
+                "Connected MJPEG stream clients");
+            double client_count = 0;
+            for (const auto& [cam_id, connections] : connections_by_camera) {
+                client_count += connections.size();
+            }
+            clients.set(client_count);
+
             // Process each camera's frame once and send to all connections
             for (auto& [cam_id, connections] : connections_by_camera) {
                 if (connections.empty()) continue;
@@ -370,14 +433,14 @@ void StreamService::handleMjpegStream(struct mg_connection* c,
                             mg_send(conn, header.data(), header.size());
                             mg_send(conn, jpeg_buffer.data(), jpeg_buffer.size());
                             mg_send(conn, "\r\n", 2);  // End with CRLF
+                            svc->camera_metrics_.at(cam_id).sent_bytes.add(
+                                jpeg_buffer.size());
                         }
                     }
                 } catch (const std::exception& e) {
                     // On error, mark all connections for this camera as expired
-                    static int error_log_counter = 0;
-                    if (++error_log_counter % 10 == 0) {
-                        LOGE("Error processing MJPEG stream for camera {}: {}", cam_id, e.what());
-                    }
+                    LOGE_EVERY_MS(1000, "Error processing MJPEG stream for camera {}: {}",
+                                  cam_id, e.what());
                     
                     for (auto* conn : connections) {
                         expired_connections.push_back(conn);
@@ -479,6 +542,7 @@ void StreamService::handleGetCameraFrame(struct mg_connection* c,
     }
 
     try {
+        TRACE_SCOPE("http.frame_send");
         // Create buffer for the response
         std::vector<uint8_t> jpeg_buffer;
         {
@@ -488,7 +552,7 @@ void StreamService::handleGetCameraFrame(struct mg_connection* c,
 
         if (!jpeg_buffer.empty()) {
             // Send the JPEG image
-            LOGI("Sending frame for camera {}, size: {} bytes", camera_id,
+            LOGD("Sending frame for camera {}, size: {} bytes", camera_id,
                  jpeg_buffer.size());
 
             // Send headers with additional cache control
@@ -505,6 +569,8 @@ void StreamService::handleGetCameraFrame(struct mg_connection* c,
 
             // Send binary data directly
             mg_send(c, jpeg_buffer.data(), jpeg_buffer.size());
+            service->camera_metrics_.at(camera_id).sent_bytes.add(
+                jpeg_buffer.size());
         } else {
             // Not found or error encoding
             LOGE("No valid frame available for camera {}", camera_id);
@@ -564,16 +630,26 @@ bool StreamService::start() {
                 camera_id);
             // Keep going, we'll generate test frames
         } else {
-            LOGI("Successfully opened shared memory queue for camera {}",
-                 camera_id);
+            LOGI(
+                "Successfully opened shared memory queue for camera {} ({} "
+                "slots of up to {} bytes)",
+                camera_id, queue->capacity(), queue->max_frame_size());
+            // Tick when the camera pushes a frame instead of polling
+            queue->watch(events());
             camera_queues_[camera_id] = std::move(queue);
             generate_test_frames = false;
         }
     }
 
+    if (!pipeline_.start()) {
+        LOGE("Failed to start the frame pipeline");
+        return false;
+    }
+
     // Create a test frame right away
     if (generate_test_frames) {
         LOGI("Generating test frames since no camera queues are available");
+        events().add_timer(TEST_FRAME_TICK);
         for (const auto& camera_id : camera_ids_) {
             // Create a basic colored frame with timestamp
             cv::Mat test_frame(480, 640, CV_8UC3,
@@ -593,6 +669,8 @@ bool StreamService::start() {
 
             // Store in latest frames
             latest_frames_[camera_id] = test_frame.clone();
+            pipeline_input_->push(StreamFrame{
+                .camera_id = camera_id, .source = latest_frames_[camera_id]});
             LOGI("Generated test frame for camera {}", camera_id);
         }
     }
@@ -648,10 +726,20 @@ void StreamService::stop() {
     // Free Mongoose event manager
     mg_mgr_free(&mgr_);
 
+    // Stop the tick thread before tearing down the queues it waits on, then
+    // the pipeline, which drops the frames still in flight
+    Service::stop();
+    pipeline_.stop();
+
+    // Release leased frames before the queues they point into
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        latest_frames_.clear();
+        latest_leases_.clear();
+    }
+
     // Clear camera queues
     camera_queues_.clear();
-
-    Service::stop();
 }
 
 void StreamService::setFrameProcessingRate(int every_n_frames) {
@@ -666,216 +754,57 @@ void StreamService::setFrameProcessingRate(int every_n_frames) {
 
 std::expected<void, std::string> StreamService::tick() {
     // Lock for thread safety when updating latest frames
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
 
     // Flag to track if we got frames from any queue
     bool any_frames_received = false;
 
     // Process frames from all camera queues
     for (auto& [camera_id, queue] : camera_queues_) {
-        cv::Mat frame;
-        if (queue->try_pop_zero_copy(frame)) {
-            // Process frame and store the latest frame for each camera
-            LOGI("New frame received from camera {}", camera_id);
-
-            // Store the latest frame - we need to make a deep copy to ensure it's not overwritten
-            // For detection to work reliably, we need stable frames that don't change
-            if (!frame.empty()) {
-                latest_frames_[camera_id] = frame.clone(); // Make a deep copy for stability
-                LOGD("Stored new frame for camera {} ({}x{})", 
-                    camera_id, latest_frames_[camera_id].cols, latest_frames_[camera_id].rows);
-            } else {
-                LOGW("Received empty frame from camera {}, ignoring", camera_id);
-            }
-            any_frames_received = true;
-            
-            // Run person detection if enabled, but at a reduced rate
-            // Only run detection if we have a valid frame and the detector is enabled
-            if (use_person_detector_ && yolo_ && latest_frames_.find(camera_id) != latest_frames_.end() && 
-                !latest_frames_[camera_id].empty()) {
-                
-                // Skip frames based on counter for better performance
-                bool should_run_detection = (frame_counter_++ % process_every_n_frames_ == 0);
-                
-                // If active_detection_camera is set, only run detection on that camera
-                if (!active_detection_camera_.empty() && camera_id != active_detection_camera_) {
-                    should_run_detection = false;
-                }
-                
-                // Add time-based throttling on top of frame skipping
-                static std::unordered_map<std::string, std::chrono::steady_clock::time_point> last_detection_time;
-                static constexpr int DETECTION_INTERVAL_MS = 200; // Run detection at ~5fps
-                
-                auto now = std::chrono::steady_clock::now();
-                
-                // Check if we've run detection recently for this camera
-                auto time_it = last_detection_time.find(camera_id);
-                if (time_it != last_detection_time.end() && should_run_detection) {
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        now - time_it->second).count();
-                    should_run_detection = elapsed >= DETECTION_INTERVAL_MS;
-                }
-                
-                if (should_run_detection) {
-                    try {
-                        // Update detection time
-                        last_detection_time[camera_id] = now;
-                        
-                        // YOLO detection needs properly formatted frames
-                        // Always make a deep copy for detection to ensure proper memory layout
-                        cv::Mat detection_frame;
-                        int target_size = 416; // Optimal size for YOLO
-                        double scale_factor = 1.0;
-                        
-                        // Use the stored frame copy that we confirmed is valid
-                        cv::Mat& current_frame = latest_frames_[camera_id];
-                        
-                        // Double check the frame is still valid
-                        if (current_frame.empty()) {
-                            LOGE("Empty stored frame for camera {}, skipping YOLO detection", camera_id);
-                            continue;
-                        }
-                        
-                        LOGI("Processing detection for camera {} with frame size {}x{}", 
-                             camera_id, current_frame.cols, current_frame.rows);
-                        
-                        // Ensure we have a proper continuous BGR image for YOLO
-                        cv::Mat continuous_frame;
-                        try {
-                            if (!current_frame.isContinuous()) {
-                                // Make a continuous copy for proper processing
-                                current_frame.copyTo(continuous_frame);
-                            } else {
-                                // Frame is already continuous but we'll still make a copy
-                                // to ensure memory layout compatibility with YOLO
-                                continuous_frame = current_frame.clone();
-                            }
-                            
-                            // Verify the copy worked
-                            if (continuous_frame.empty()) {
-                                LOGE("Failed to create continuous frame");
-                                continue;
-                            }
-                        } catch (const cv::Exception& e) {
-                            LOGE("OpenCV error creating continuous frame: {}", e.what());
-                            continue;
-                        }
-                        
-                        // Resize for optimal YOLO processing
-                        if (continuous_frame.cols <= target_size && continuous_frame.rows <= target_size) {
-                            // Small enough, but still need a properly formatted copy
-                            detection_frame = continuous_frame.clone();
-                        } else {
-                            // Need to resize - compute scale factors
-                            scale_factor = std::min(
-                                static_cast<double>(target_size) / continuous_frame.cols,
-                                static_cast<double>(target_size) / continuous_frame.rows);
-                            int new_width = static_cast<int>(continuous_frame.cols * scale_factor);
-                            int new_height = static_cast<int>(continuous_frame.rows * scale_factor);
-                            
-                            // Resize to target size
-                            cv::resize(continuous_frame, detection_frame, cv::Size(new_width, new_height), 
-                                      0, 0, cv::INTER_LINEAR);
-                        }
-                        
-                        // Make sure we have a valid frame before trying conversions
-                        if (detection_frame.empty()) {
-                            LOGE("Empty detection frame, skipping YOLO detection");
-                            continue;
-                        }
-                        
-                        // Create a proper BGR copy for YOLO processing
-                        // This ensures consistent memory layout and format
-                        cv::Mat bgr_detection_frame;
-                        
-                        try {
-                            // Check what format we're working with
-                            if (detection_frame.channels() == 3) {
-                                // For 3-channel images, clone to ensure proper format
-                                // This avoids potential memory layout issues
-                                bgr_detection_frame = detection_frame.clone();
-                            } else if (detection_frame.channels() == 1) {
-                                // Convert grayscale to BGR
-                                cv::cvtColor(detection_frame, bgr_detection_frame, cv::COLOR_GRAY2BGR);
-                            } else {
-                                // Handle unexpected format by creating a blank BGR image
-                                LOGW("Unexpected image format with {} channels", detection_frame.channels());
-                                bgr_detection_frame = cv::Mat(detection_frame.rows, detection_frame.cols, CV_8UC3, cv::Scalar(0, 0, 0));
-                            }
-                        } catch (const cv::Exception& e) {
-                            LOGE("OpenCV error during format conversion: {}", e.what());
-                            continue;
-                        }
-                        
-                        // Run YOLO detection with default thresholds
-                        const float confidence_threshold = 0.25f;
-                        const float iou_threshold = 0.45f;
-                        
-                        // Log detailed information about the frame being passed to YOLO
-                        LOGI("Detecting on frame: type={}, size={}x{}, channels={}, continuous={}, empty={}",
-                             bgr_detection_frame.type(), bgr_detection_frame.cols, bgr_detection_frame.rows,
-                             bgr_detection_frame.channels(), 
-                             bgr_detection_frame.isContinuous() ? "yes" : "no",
-                             bgr_detection_frame.empty() ? "yes" : "no");
-                            
-                        // Additional logging for memory alignment and structure which can affect YOLO
-                        LOGI("Frame memory: step={}, elemSize={}, total={}",
-                             bgr_detection_frame.step[0], 
-                             bgr_detection_frame.elemSize(),
-                             bgr_detection_frame.total());
-                        
-                        std::vector<Detection> detections;
-                        try {
-                            // Attempt detection with better error handling
-                            detections = yolo_->detect(bgr_detection_frame, confidence_threshold, iou_threshold);
-                            LOGI("Detection successful - found {} objects", detections.size());
-                        } catch (const std::exception& e) {
-                            LOGE("YOLO detection failed with exception: {}", e.what());
-                            continue;
-                        }
-                        
-                        // If we resized, scale detections back to original size 
-                        if (scale_factor != 1.0) {
-                            // No need to recalculate scales - just use the inverse of scale_factor
-                            double inverse_scale = 1.0 / scale_factor;
-                            
-                            for (auto& detection : detections) {
-                                detection.box.center.x *= inverse_scale;
-                                detection.box.center.y *= inverse_scale;
-                                detection.box.width *= inverse_scale;
-                                detection.box.height *= inverse_scale;
-                            }
-                        }
-                        
-                        // Store detections directly (no extra copy)
-                        latest_detections_[camera_id] = std::move(detections);
-                        
-                        // Log only occasionally to reduce overhead
-                        static int log_counter = 0;
-                        if (++log_counter % 10 == 0) {
-                            // Count person detections
-                            int person_count = 0;
-                            for (const auto& detection : latest_detections_[camera_id]) {
-                                if (detection.class_id == 0) { // Person class
-                                    person_count++;
-                                }
-                            }
-                            
-                            if (!latest_detections_[camera_id].empty()) {
-                                LOGI("Detected {} objects ({} people) in camera {}",
-                                     latest_detections_[camera_id].size(), person_count, camera_id);
-                            }
-                        }
-                    } catch (const std::exception& e) {
-                        // Log errors less frequently
-                        static int error_counter = 0;
-                        if (++error_counter % 10 == 0) {
-                            LOGE("Error during person detection: {}", e.what());
-                        }
-                    }
-                }
-            }
+        // Lease the newest frame in place, skipping any backlog so the view
+        // is never more than a frame behind. The slot stays pinned in shared
+        // memory until the next frame for this camera replaces the lease and
+        // the pipeline is done with it, so no stage has to copy it
+        CameraMetrics& metrics = camera_metrics_.at(camera_id);
+        metrics.queue_depth.set(static_cast<double>(queue->backlog()));
+        FrameLease lease;
+        if (!queue->try_acquire_latest(lease)) {
+            continue;
+        }
+        const uint64_t consumer_dropped = queue->dropped();
+        metrics.consumer_dropped.add(consumer_dropped -
+                                     metrics.last_consumer_dropped);
+        metrics.last_consumer_dropped = consumer_dropped;
+        any_frames_received = true;
+        LOGD("New frame received from camera {}", camera_id);
+
+        if (lease.mat().empty()) {
+            LOGW("Received empty frame from camera {}, ignoring", camera_id);
+            continue;
         }
+
+        const FrameInfo& info = lease.info();
+        latest_frame_stats_[camera_id] = {info, info.age_ms()};
+        metrics.frames_received.add();
+        // The frame carries the producer's running total, which starts
+        // over when the producer restarts
+        metrics.producer_dropped.add(
+            info.dropped >= metrics.last_producer_dropped
+                ? info.dropped - metrics.last_producer_dropped
+                : info.dropped);
+        metrics.last_producer_dropped = info.dropped;
+        // From capture in the camera process until this thread took it
+        Tracer::record("frame.queue", info.capture_ns, monotonic_ns(), true);
+        LOGD("Frame {} from camera {} arrived after {:.2f} ms", info.sequence,
+             camera_id, info.age_ms());
+
+        auto shared_lease = std::make_shared<FrameLease>(std::move(lease));
+        latest_frames_[camera_id] = shared_lease->mat();
+        latest_leases_[camera_id] = shared_lease;
+        pipeline_input_->push(StreamFrame{.camera_id = camera_id,
+                                          .lease = std::move(shared_lease),
+                                          .source = latest_frames_[camera_id],
+                                          .info = info});
     }
 
     // If we didn't get any frames from queues, update test frames
@@ -911,201 +840,255 @@ std::expected<void, std::string> StreamService::tick() {
                             cv::Point(380, 480), cv::FONT_HERSHEY_SIMPLEX, 1.8,
                             cv::Scalar(255, 255, 255), 2);
 
-                // Move the test frame directly to avoid any copying
+                // Move the test frame directly to avoid any copying. It is
+                // replaced, never drawn on, so the pipeline can share it
                 latest_frames_[camera_id] = std::move(test_frame);
+                pipeline_input_->push(
+                    StreamFrame{.camera_id = camera_id,
+                                .source = latest_frames_[camera_id]});
                 LOGI("Updated test frame for camera {}", camera_id);
             }
         }
     }
 
-    // Reduce memory usage by cleaning up old cached frames
-    {
-        std::lock_guard<std::mutex> cache_lock(frame_cache_mutex);
-        auto now = std::chrono::steady_clock::now();
-        for (auto it = frame_cache.begin(); it != frame_cache.end();) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - it->second.timestamp).count();
-            if (elapsed > 5000) { // Remove frames older than 5 seconds
-                it = frame_cache.erase(it);
-            } else {
-                ++it;
-            }
-        }
+    return {};
+}
+
+void StreamService::buildPipeline() {
+    // Every edge keeps the newest frames: a stage that falls behind skips
+    // frames rather than delaying the ones after it
+    const std::size_t capacity = std::max<std::size_t>(2, camera_ids_.size());
+    const auto stage_config = [this, capacity](const std::string& stage) {
+        return PipelineStageConfig{
+            .base = {.name = Service::name() + "-" + stage,
+                     .port = 0,
+                     .interval_ms = 0},
+            .output_capacity = capacity,
+            .output_policy = DropPolicy::DropOldest};
+    };
+
+    pipeline_input_ =
+        pipeline_.source<StreamFrame>(capacity, DropPolicy::DropOldest);
+    auto resized = pipeline_.stage(
+        stage_config("resize"), pipeline_input_,
+        [this](StreamFrame&& frame) { return resizeStage(std::move(frame)); });
+    auto detected = pipeline_.stage(
+        stage_config("detect"), resized,
+        [this](StreamFrame&& frame) { return detectStage(std::move(frame)); });
+    auto annotated = pipeline_.stage(
+        stage_config("annotate"), detected, [this](StreamFrame&& frame) {
+            return annotateStage(std::move(frame));
+        });
+    auto encoded = pipeline_.stage(
+        stage_config("encode"), annotated,
+        [this](StreamFrame&& frame) { return encodeStage(std::move(frame)); });
+    pipeline_.sink(stage_config("publish").base, encoded,
+                   [this](StreamFrame&& frame) {
+                       publishStage(std::move(frame));
+                   });
+}
+
+std::optional<StreamService::StreamFrame> StreamService::resizeStage(
+    StreamFrame&& frame) {
+    TRACE_SCOPE("stream.resize");
+    const cv::Mat& source = frame.source;
+    if (source.cols <= MAX_DISPLAY_WIDTH) {
+        // Already small enough, later stages read the source in place
+        frame.display = source;
+        return std::move(frame);
     }
 
-    // Smaller sleep to avoid busy waiting
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    return {};
+    // Keep the aspect ratio
+    const int width = MAX_DISPLAY_WIDTH;
+    const int height = static_cast<int>(
+        width * static_cast<double>(source.rows) / source.cols);
+    // INTER_NEAREST is much faster for big reductions, INTER_AREA looks
+    // better when downsampling slightly
+    const int interpolation = source.cols > width * 2 ? cv::INTER_NEAREST
+                                                      : cv::INTER_AREA;
+    cv::resize(source, frame.display, cv::Size(width, height), 0, 0,
+               interpolation);
+    return std::move(frame);
 }
 
-void StreamService::serveLatestFrame(const std::string& camera_id,
-                                     std::vector<uint8_t>& jpeg_buffer) {
-    // Note: This method should always be called with mutex_ locked by the caller
-    
-    // Ensure jpeg_buffer is empty at the start
-    jpeg_buffer.clear();
-    
-    // Check frame cache first (under its own mutex to reduce contention)
-    bool use_cached = false;
-    {
-        std::lock_guard<std::mutex> cache_lock(frame_cache_mutex);
-        auto cache_it = frame_cache.find(camera_id);
-        if (cache_it != frame_cache.end()) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::steady_clock::now() - cache_it->second.timestamp).count();
-            if (elapsed < CACHE_TTL_MS) {
-                // Use cached frame
-                jpeg_buffer = cache_it->second.jpeg_data;
-                use_cached = true;
-            }
-        }
+std::optional<StreamService::StreamFrame> StreamService::detectStage(
+    StreamFrame&& frame) {
+    if (!use_person_detector_ || !yolo_) {
+        return std::move(frame);
     }
-    
-    if (use_cached) {
-        // Used cached frame, exit early
-        return;
+    const std::string& camera_id = frame.camera_id;
+
+    // Skip frames based on counter for better performance, and only run on
+    // the active detection camera if one is set
+    bool should_run_detection =
+        (frame_counter_++ % process_every_n_frames_ == 0) &&
+        (active_detection_camera_.empty() ||
+         camera_id == active_detection_camera_);
+
+    // Add time-based throttling on top of frame skipping
+    static constexpr int DETECTION_INTERVAL_MS = 200;  // Run detection at ~5fps
+    const auto now = std::chrono::steady_clock::now();
+    auto time_it = last_detection_time_.find(camera_id);
+    if (should_run_detection && time_it != last_detection_time_.end()) {
+        should_run_detection =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - time_it->second)
+                .count() >= DETECTION_INTERVAL_MS;
     }
-    
-    auto it = latest_frames_.find(camera_id);
-    if (it != latest_frames_.end() && !it->second.empty()) {
+
+    if (should_run_detection) {
+        TRACE_SCOPE("stream.detect");
+        last_detection_time_[camera_id] = now;
         try {
-            // Validate the source frame first to ensure it's usable
-            if (it->second.cols <= 0 || it->second.rows <= 0 || it->second.type() <= 0) {
-                LOGE("Invalid frame dimensions or type for camera {}: {}x{} type={}", 
-                     camera_id, it->second.cols, it->second.rows, it->second.type());
-                throw std::runtime_error("Invalid frame dimensions or type");
+            // Detect on a frame that fits YOLO's input, then scale the boxes
+            // back to the source frame
+            const cv::Mat& source = frame.source;
+            constexpr int target_size = 416;
+            double scale_factor = 1.0;
+            cv::Mat detection_frame = source;
+            if (source.cols > target_size || source.rows > target_size) {
+                scale_factor =
+                    std::min(static_cast<double>(target_size) / source.cols,
+                             static_cast<double>(target_size) / source.rows);
+                cv::resize(source, detection_frame,
+                           cv::Size(static_cast<int>(source.cols * scale_factor),
+                                    static_cast<int>(source.rows * scale_factor)),
+                           0, 0, cv::INTER_LINEAR);
             }
-            
-            // Create a clone of the frame to ensure it doesn't change during encoding
-            // Must be a deep copy for thread safety
-            cv::Mat original_frame;
-            it->second.copyTo(original_frame); // Use copyTo for safer cloning
-            
-            // Use original frame directly if it's already the right size
-            cv::Mat* frame_to_process = &original_frame;
-            cv::Mat resized;
-            
-            // Original dimensions
-            int orig_width = original_frame.cols;
-            int orig_height = original_frame.rows;
-            
-            // Only resize if necessary
-            if (orig_width > MAX_DISPLAY_WIDTH) {
-                // Calculate aspect ratio and new size (maintain aspect ratio)
-                int target_width = std::min(MAX_DISPLAY_WIDTH, orig_width);
-                double aspect_ratio = static_cast<double>(orig_height) / orig_width;
-                int target_height = static_cast<int>(target_width * aspect_ratio);
-                
-                // Fast resize using the most appropriate algorithm
-                // Use INTER_NEAREST for higher speed if the size reduction is significant
-                if (orig_width > target_width * 2 || orig_height > target_height * 2) {
-                    cv::resize(original_frame, resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_NEAREST);
-                } else {
-                    // Use INTER_AREA for better quality when downsampling slightly
-                    cv::resize(original_frame, resized, cv::Size(target_width, target_height), 0, 0, cv::INTER_AREA);
-                }
-                frame_to_process = &resized;
+            if (detection_frame.channels() == 1) {
+                cv::cvtColor(detection_frame, detection_frame,
+                             cv::COLOR_GRAY2BGR);
             }
-            
-            // Flag to track if we have detections
-            bool has_detections = false;
-            
-            // Draw bounding boxes for detections if enabled (directly on the frame we're processing)
-            if (use_person_detector_ && yolo_) {
-                auto detection_it = latest_detections_.find(camera_id);
-                if (detection_it != latest_detections_.end() && !detection_it->second.empty()) {
-                    try {
-                        // Only scale bounding boxes if we resized the frame
-                        // Create a drawing frame - note: we need to store this in a variable 
-                        // that doesn't go out of scope before encoding
-                        resized = frame_to_process->clone(); // Reuse resized variable to avoid dangling pointers
-                        
-                        if (frame_to_process == &original_frame) {
-                            // Draw all detections on the frame directly
-                            // No scaling needed since we're using original coordinates
-                            yolo_->drawBoundingBox(resized, detection_it->second);
-                        } else {
-                            // Scale detections to match the current frame size
-                            std::vector<Detection> scaled_detections;
-                            double scale_x = static_cast<double>(resized.cols) / orig_width;
-                            double scale_y = static_cast<double>(resized.rows) / orig_height;
-                            
-                            for (const auto& detection : detection_it->second) {
-                                Detection scaled = detection;
-                                scaled.box.center.x *= scale_x;
-                                scaled.box.center.y *= scale_y;
-                                scaled.box.width *= scale_x;
-                                scaled.box.height *= scale_y;
-                                scaled_detections.push_back(scaled);
-                            }
-                            
-                            // Draw on the resized frame
-                            yolo_->drawBoundingBox(resized, scaled_detections);
-                        }
-                        
-                        // Use the drawing frame for further processing
-                        frame_to_process = &resized;
-                        
-                        has_detections = true;
-                        
-                        // Log only occasionally to reduce overhead
-                        static int log_counter = 0;
-                        if (++log_counter % 30 == 0) {
-                            LOGI("Drew {} detection boxes on frame for camera {}", 
-                                detection_it->second.size(), camera_id);
-                        }
-                    } catch (const std::exception& e) {
-                        // Log error but continue without boxes
-                        LOGE("Error drawing detection boxes: {}", e.what());
-                    }
+
+            // Run YOLO detection with default thresholds
+            const float confidence_threshold = 0.25f;
+            const float iou_threshold = 0.45f;
+            const int64_t detect_start_ns = monotonic_ns();
+            // Detecting into the camera's last detections reuses them
+            std::vector<Detection>& detections = stage_detections_[camera_id];
+            yolo_->detect(detection_frame, detections, confidence_threshold,
+                          iou_threshold);
+            camera_metrics_.at(camera_id).detect_latency.record(
+                monotonic_ns() - detect_start_ns);
+            if (scale_factor != 1.0) {
+                const double inverse_scale = 1.0 / scale_factor;
+                for (auto& detection : detections) {
+                    detection.box.center.x *= inverse_scale;
+                    detection.box.center.y *= inverse_scale;
+                    detection.box.width *= inverse_scale;
+                    detection.box.height *= inverse_scale;
                 }
             }
-            
-            // Encode to JPEG with optimized settings for streaming
-            std::vector<int> params = {
-                cv::IMWRITE_JPEG_QUALITY, JPEG_QUALITY_STREAMING,
-                cv::IMWRITE_JPEG_OPTIMIZE, 1,  // Enable optimization
-                cv::IMWRITE_JPEG_PROGRESSIVE, 0  // Disable progressive (faster)
-            };
-            
-            // Ensure we're using a valid Mat for encoding
-            // If frame_to_process is a pointer to a local variable that will go out of scope,
-            // we need to be careful
-            if (frame_to_process && !frame_to_process->empty()) {
-                cv::imencode(".jpg", *frame_to_process, jpeg_buffer, params);
-            } else {
-                // Fallback to original frame if frame_to_process is invalid
-                LOGW("Invalid frame for encoding, using original frame");
-                cv::imencode(".jpg", original_frame, jpeg_buffer, params);
-            }
-            
-            // Only log once in a while to reduce overhead
-            static int encode_log_counter = 0;
-            if (++encode_log_counter % 100 == 0) {
-                LOGI("Encoded frame {}x{} → {}x{}, size: {} bytes",
-                    orig_width, orig_height, frame_to_process->cols, frame_to_process->rows, jpeg_buffer.size());
-            }
-            
-            // Cache the encoded frame
-            {
-                std::lock_guard<std::mutex> cache_lock(frame_cache_mutex);
-                frame_cache[camera_id] = {
-                    jpeg_buffer,
-                    std::chrono::steady_clock::now(),
-                    orig_width,
-                    orig_height,
-                    has_detections
-                };
+
+            // Log only occasionally to reduce overhead
+            if (!detections.empty()) {
+                LOGI_EVERY_N(10, "Detected {} objects ({} people) in camera {}",
+                             detections.size(),
+                             std::count_if(detections.begin(), detections.end(),
+                                           [](const Detection& detection) {
+                                               // Person class
+                                               return detection.class_id == 0;
+                                           }),
+                             camera_id);
             }
-            
-            return;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_detections_[camera_id] = detections;
+            latest_detection_sequence_[camera_id] = frame.info.sequence;
         } catch (const std::exception& e) {
-            LOGE("Error processing frame: {}", e.what());
-            jpeg_buffer.clear();
-            // Fall through to fallback frame
+            // Log errors less frequently
+            LOGE_EVERY_MS(1000, "Error during person detection: {}", e.what());
         }
-    } 
+    }
+
+    // Frames between detections show the latest boxes of their camera
+    if (auto it = stage_detections_.find(camera_id);
+        it != stage_detections_.end()) {
+        frame.detections = it->second;
+    }
+    return std::move(frame);
+}
+
+std::optional<StreamService::StreamFrame> StreamService::annotateStage(
+    StreamFrame&& frame) {
+    if (frame.detections.empty()) {
+        return std::move(frame);
+    }
+    TRACE_SCOPE("stream.annotate");
+
+    // Never draw on the source, it may be a frame in shared memory
+    if (frame.display.data == frame.source.data) {
+        frame.display = frame.source.clone();
+    }
+
+    // Detections are in source coordinates
+    const double scale_x =
+        static_cast<double>(frame.display.cols) / frame.source.cols;
+    const double scale_y =
+        static_cast<double>(frame.display.rows) / frame.source.rows;
+    for (auto& detection : frame.detections) {
+        detection.box.center.x *= scale_x;
+        detection.box.center.y *= scale_y;
+        detection.box.width *= scale_x;
+        detection.box.height *= scale_y;
+    }
+    yolo_->drawBoundingBox(frame.display, frame.detections);
+    return std::move(frame);
+}
+
+std::optional<StreamService::StreamFrame> StreamService::encodeStage(
+    StreamFrame&& frame) {
+    TRACE_SCOPE("stream.encode");
+    // Encode to JPEG with optimized settings for streaming
+    static const std::vector<int> params = {
+        cv::IMWRITE_JPEG_QUALITY, JPEG_QUALITY_STREAMING,
+        cv::IMWRITE_JPEG_OPTIMIZE, 1,  // Enable optimization
+        cv::IMWRITE_JPEG_PROGRESSIVE, 0  // Disable progressive (faster)
+    };
+    const int64_t encode_start_ns = monotonic_ns();
+    cv::imencode(".jpg", frame.display, frame.jpeg, params);
+    const CameraMetrics& metrics = camera_metrics_.at(frame.camera_id);
+    metrics.encode_latency.record(monotonic_ns() - encode_start_ns);
+    metrics.encoded_bytes.add(frame.jpeg.size());
+
+    // Only log once in a while to reduce overhead
+    LOGD_EVERY_N(100, "Encoded frame {}x{} → {}x{}, size: {} bytes",
+                 frame.source.cols, frame.source.rows, frame.display.cols,
+                 frame.display.rows, frame.jpeg.size());
+
+    // Done with the pixels, unpin the shared-memory slot
+    frame.display = cv::Mat();
+    frame.source = cv::Mat();
+    frame.lease.reset();
+    return std::move(frame);
+}
+
+void StreamService::publishStage(StreamFrame&& frame) {
+    if (frame.jpeg.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(jpeg_mutex_);
+    latest_jpegs_[frame.camera_id] = std::move(frame.jpeg);
+}
+
+void StreamService::serveLatestFrame(const std::string& camera_id,
+                                     std::vector<uint8_t>& jpeg_buffer) {
+    // Note: This method should always be called with mutex_ locked by the caller
     
+    // Ensure jpeg_buffer is empty at the start
+    jpeg_buffer.clear();
+
+    // The pipeline resizes, annotates and encodes every frame off the HTTP
+    // thread; serve the newest JPEG it published
+    {
+        std::lock_guard<std::mutex> lock(jpeg_mutex_);
+        auto it = latest_jpegs_.find(camera_id);
+        if (it != latest_jpegs_.end()) {
+            jpeg_buffer = it->second;
+            return;
+        }
+    }
+
     // Use cached fallback frame if possible
     static std::mutex fallback_mutex;
     static std::unordered_map<std::string, std::vector<uint8_t>> fallback_frames;
@@ -1183,7 +1166,7 @@ nlohmann::json StreamService::getCameraInfo(const std::string& camera_id) {
         int height = it->second.rows;
         
         // Log the original resolution
-        LOGI("Camera {} original resolution: {}x{}", camera_id, width, height);
+        LOGD("Camera {} original resolution: {}x{}", camera_id, width, height);
         
         // Original resolution before resizing
         camera_info["resolution"] = {{"width", width}, {"height", height}};
@@ -1192,11 +1175,25 @@ nlohmann::json StreamService::getCameraInfo(const std::string& camera_id) {
         camera_info["display_resolution"] = {{"width", 640}, {"height", 480}};
     } else {
         // If no frame is available, use default values
-        LOGI("No frame available for camera {}, using default resolution", camera_id);
+        LOGD("No frame available for camera {}, using default resolution", camera_id);
         camera_info["resolution"] = {{"width", 1280}, {"height", 720}};
         camera_info["display_resolution"] = {{"width", 640}, {"height", 480}};
     }
     
+    // Frame age and loss, measured from the capture timestamp
+    auto stats_it = latest_frame_stats_.find(camera_id);
+    auto queue_it = camera_queues_.find(camera_id);
+    if (stats_it != latest_frame_stats_.end()) {
+        const FrameStats& stats = stats_it->second;
+        camera_info["frame"] = {
+            {"sequence", stats.info.sequence},
+            {"latency_ms", stats.latency_ms},
+            {"producer_dropped", stats.info.dropped},
+            {"consumer_dropped", queue_it != camera_queues_.end()
+                                     ? queue_it->second->dropped()
+                                     : 0}};
+    }
+
     // Add detection information if available
     if (use_person_detector_ && yolo_) {
         auto detection_it = latest_detections_.find(camera_id);
@@ -1231,6 +1228,8 @@ nlohmann::json StreamService::getCameraInfo(const std::string& camera_id) {
             
             camera_info["detections"] = detections_json;
             camera_info["detection_counts"] = class_counts;
+            camera_info["detection_sequence"] =
+                latest_detection_sequence_[camera_id];
             
             // Quick summary of people detected
             camera_info["people_detected"] = class_counts[0];
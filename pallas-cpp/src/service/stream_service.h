@@ -3,16 +3,21 @@
 // Define for Mongoose HTTP library
 #define MG_ENABLE_OPENSSL 0
 
+#include <core/metrics.h>
+#include <core/pipeline.h>
 #include <core/service.h>
 #include <mongoose.h>
 #include <vision/yolo.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <expected>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <opencv2/core.hpp>
+#include <optional>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -39,6 +44,7 @@ class StreamService : public Service {
     using Service::Service;
 
     StreamService(StreamServiceConfig config);
+    ~StreamService() override;
     bool start() override;
     void stop() override;
     
@@ -58,14 +64,40 @@ class StreamService : public Service {
     std::expected<void, std::string> tick() override;
 
    private:
-  // using Queue = MatQueue<2764800>; // Resolution for webcam
-  using Queue = MatQueue<921600>; // Resolution for webcam  
+    using Queue = MatQueue;
 
     std::string shared_memory_name_;
     uint16_t http_port_;
     std::vector<std::string> camera_ids_;
     std::unordered_map<std::string, std::unique_ptr<Queue>> camera_queues_;
     std::unordered_map<std::string, cv::Mat> latest_frames_;
+    // Pins the shared-memory slots that latest_frames_ views point into;
+    // shared with the frames still in the pipeline
+    std::unordered_map<std::string, std::shared_ptr<FrameLease>>
+        latest_leases_;
+
+    // Capture info of the latest frame, and how long it took to arrive
+    struct FrameStats {
+        FrameInfo info;
+        double latency_ms = 0.0;  // Capture to receipt by this service
+    };
+    std::unordered_map<std::string, FrameStats> latest_frame_stats_;
+
+    // Exported at /metrics. The map is filled by the constructor and only
+    // read afterwards, so any thread may look a camera up
+    struct CameraMetrics {
+        Counter& frames_received;
+        Counter& producer_dropped;
+        Counter& consumer_dropped;
+        Gauge& queue_depth;
+        DurationMetric& detect_latency;
+        DurationMetric& encode_latency;
+        Counter& encoded_bytes;
+        Counter& sent_bytes;
+        uint64_t last_consumer_dropped = 0;  // Tick thread only
+        uint64_t last_producer_dropped = 0;  // Tick thread only
+    };
+    std::unordered_map<std::string, CameraMetrics> camera_metrics_;
 
     // Mongoose HTTP server
     struct mg_mgr mgr_;
@@ -78,6 +110,8 @@ class StreamService : public Service {
     std::string active_detection_camera_;  // Only run detection on this camera (empty = all)
     std::unique_ptr<YouOnlyLookOnce> yolo_;
     std::unordered_map<std::string, std::vector<Detection>> latest_detections_;
+    // Sequence number of the frame latest_detections_ were computed on
+    std::unordered_map<std::string, uint64_t> latest_detection_sequence_;
     
     // Frame processing control
     int frame_counter_{0};
@@ -86,6 +120,39 @@ class StreamService : public Service {
     // Mutex for thread safety
     std::mutex mutex_;
 
+    // A frame on its way from the queue to the HTTP clients. Every stage
+    // runs on its own thread, so detecting one frame overlaps with encoding
+    // the one before it
+    struct StreamFrame {
+        std::string camera_id;
+        std::shared_ptr<FrameLease> lease;  // Unset for test frames
+        cv::Mat source;   // View of the leased frame, never written to
+        FrameInfo info;
+        cv::Mat display;  // Resized, then annotated copy of source
+        std::vector<Detection> detections;  // In source coordinates
+        std::vector<uint8_t> jpeg;
+    };
+
+    void buildPipeline();
+    std::optional<StreamFrame> resizeStage(StreamFrame&& frame);
+    std::optional<StreamFrame> detectStage(StreamFrame&& frame);
+    std::optional<StreamFrame> annotateStage(StreamFrame&& frame);
+    std::optional<StreamFrame> encodeStage(StreamFrame&& frame);
+    void publishStage(StreamFrame&& frame);
+
+    // Owned by the detect stage's thread
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+        last_detection_time_;
+    std::unordered_map<std::string, std::vector<Detection>> stage_detections_;
+
+    // Newest encoded frame of each camera, what the HTTP clients are sent
+    std::mutex jpeg_mutex_;
+    std::unordered_map<std::string, std::vector<uint8_t>> latest_jpegs_;
+
+    // Last, so its stages stop before the state they use is destroyed
+    Pipeline pipeline_;
+    std::shared_ptr<PipelineEdge<StreamFrame>> pipeline_input_;
+
     // HTTP server event handler
     static void eventHandler(struct mg_connection* c, int ev, void* ev_data);
 
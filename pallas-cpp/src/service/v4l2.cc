@@ -0,0 +1,255 @@
+#include "v4l2.h"
+
+#include <core/logger.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace pallas {
+
+V4L2Capture::V4L2Capture(V4L2Config config) : config_(config) {}
+
+V4L2Capture::~V4L2Capture() {
+    close();
+}
+
+int V4L2Capture::xioctl(unsigned long request, void* arg) const {
+    int result;
+    do {
+        result = ioctl(fd_, request, arg);
+    } while (result == -1 && errno == EINTR);
+    return result;
+}
+
+std::expected<void, std::string> V4L2Capture::fail(const std::string& what) {
+    const std::string message = what + " on /dev/video" +
+                                std::to_string(config_.device_id) + ": " +
+                                std::strerror(errno);
+    close();
+    return std::unexpected(message);
+}
+
+std::expected<void, std::string> V4L2Capture::open() {
+    if (isOpen()) return {};
+
+    const std::string path = "/dev/video" + std::to_string(config_.device_id);
+    fd_ = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ == -1) {
+        return std::unexpected("Failed to open " + path + ": " +
+                               std::strerror(errno));
+    }
+
+    v4l2_capability capability{};
+    if (xioctl(VIDIOC_QUERYCAP, &capability) == -1) {
+        return fail("VIDIOC_QUERYCAP failed");
+    }
+    const uint32_t caps = (capability.capabilities & V4L2_CAP_DEVICE_CAPS)
+                              ? capability.device_caps
+                              : capability.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        errno = ENOTSUP;
+        return fail("No streaming video capture");
+    }
+
+    // The driver picks the closest size it supports
+    v4l2_format format{};
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    format.fmt.pix.width = config_.width;
+    format.fmt.pix.height = config_.height;
+    format.fmt.pix.pixelformat = config_.pixel_format;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(VIDIOC_S_FMT, &format) == -1) {
+        return fail("VIDIOC_S_FMT failed");
+    }
+    if (format.fmt.pix.pixelformat != config_.pixel_format) {
+        errno = ENOTSUP;
+        return fail("Pixel format not supported");
+    }
+    config_.width = static_cast<int>(format.fmt.pix.width);
+    config_.height = static_cast<int>(format.fmt.pix.height);
+    stride_ = format.fmt.pix.bytesperline;
+
+    v4l2_streamparm parm{};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = config_.fps;
+    if (xioctl(VIDIOC_S_PARM, &parm) == 0 &&
+        parm.parm.capture.timeperframe.numerator != 0) {
+        config_.fps = static_cast<int>(
+            parm.parm.capture.timeperframe.denominator /
+            parm.parm.capture.timeperframe.numerator);
+    } else {
+        LOGW("Failed to set frame rate on {}, using the driver default", path);
+    }
+
+    v4l2_requestbuffers request{};
+    request.count = config_.buffer_count;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(VIDIOC_REQBUFS, &request) == -1) {
+        return fail("VIDIOC_REQBUFS failed");
+    }
+    if (request.count < 2) {
+        errno = ENOMEM;
+        return fail("Not enough driver buffers");
+    }
+    config_.buffer_count = static_cast<int>(request.count);
+
+    buffers_.resize(request.count);
+    for (uint32_t i = 0; i < request.count; ++i) {
+        v4l2_buffer buffer{};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = i;
+        if (xioctl(VIDIOC_QUERYBUF, &buffer) == -1) {
+            return fail("VIDIOC_QUERYBUF failed");
+        }
+        void* start = mmap(nullptr, buffer.length, PROT_READ, MAP_SHARED, fd_,
+                           buffer.m.offset);
+        if (start == MAP_FAILED) {
+            return fail("Failed to map driver buffer");
+        }
+        buffers_[i] = MappedBuffer{start, buffer.length};
+
+        if (xioctl(VIDIOC_QBUF, &buffer) == -1) {
+            return fail("VIDIOC_QBUF failed");
+        }
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(VIDIOC_STREAMON, &type) == -1) {
+        return fail("VIDIOC_STREAMON failed");
+    }
+    streaming_ = true;
+
+    LOGI("V4L2 capture on {} streaming {}x{} at {} fps with {} buffers", path,
+         config_.width, config_.height, config_.fps, config_.buffer_count);
+    return {};
+}
+
+bool V4L2Capture::isOpen() const {
+    return fd_ != -1 && streaming_;
+}
+
+void V4L2Capture::close() {
+    if (fd_ == -1) return;
+
+    if (streaming_) {
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(VIDIOC_STREAMOFF, &type);
+        streaming_ = false;
+    }
+    for (const auto& buffer : buffers_) {
+        if (buffer.start) munmap(buffer.start, buffer.length);
+    }
+    buffers_.clear();
+
+    // Release the driver buffers so the next open can size the ring again
+    v4l2_requestbuffers request{};
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    xioctl(VIDIOC_REQBUFS, &request);
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+std::expected<V4L2Buffer, std::string> V4L2Capture::dequeue(
+    std::chrono::milliseconds timeout) {
+    if (!isOpen()) {
+        return std::unexpected("V4L2 capture is not open");
+    }
+
+    pollfd poll_fd{.fd = fd_, .events = POLLIN, .revents = 0};
+    int ready;
+    do {
+        ready = poll(&poll_fd, 1, static_cast<int>(timeout.count()));
+    } while (ready == -1 && errno == EINTR);
+    if (ready == -1) {
+        return std::unexpected(std::string("poll failed: ") +
+                               std::strerror(errno));
+    }
+    if (ready == 0) {
+        return std::unexpected("Timed out waiting for a V4L2 frame");
+    }
+    if (poll_fd.revents & (POLLERR | POLLHUP)) {
+        return std::unexpected("V4L2 device reported an error");
+    }
+
+    v4l2_buffer buffer{};
+    buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(VIDIOC_DQBUF, &buffer) == -1) {
+        return std::unexpected(std::string("VIDIOC_DQBUF failed: ") +
+                               std::strerror(errno));
+    }
+
+    V4L2Buffer result{
+        .index = buffer.index,
+        .data = static_cast<const uint8_t*>(buffers_[buffer.index].start),
+        .bytes_used = buffer.bytesused,
+        .width = config_.width,
+        .height = config_.height,
+        .stride = stride_,
+        .pixel_format = config_.pixel_format,
+        .sequence = buffer.sequence,
+        .timestamp_ns = static_cast<int64_t>(buffer.timestamp.tv_sec) *
+                            1'000'000'000 +
+                        static_cast<int64_t>(buffer.timestamp.tv_usec) * 1'000,
+    };
+
+    // A corrupted frame still holds a driver buffer; hand it back and report
+    if (buffer.flags & V4L2_BUF_FLAG_ERROR || result.bytes_used == 0) {
+        requeue(result);
+        return std::unexpected("V4L2 driver returned a corrupted frame");
+    }
+    return result;
+}
+
+bool V4L2Capture::requeue(const V4L2Buffer& buffer) {
+    if (!isOpen()) return false;
+
+    v4l2_buffer queued{};
+    queued.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    queued.memory = V4L2_MEMORY_MMAP;
+    queued.index = buffer.index;
+    if (xioctl(VIDIOC_QBUF, &queued) == -1) {
+        LOGW("VIDIOC_QBUF failed for buffer {}: {}", buffer.index,
+             std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+int V4L2Capture::exportDmabuf(uint32_t index) const {
+    if (!isOpen() || index >= buffers_.size()) return -1;
+
+    v4l2_exportbuffer expbuf{};
+    expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = index;
+    expbuf.flags = O_RDONLY | O_CLOEXEC;
+    if (xioctl(VIDIOC_EXPBUF, &expbuf) == -1) {
+        LOGW("VIDIOC_EXPBUF failed for buffer {}: {}", index,
+             std::strerror(errno));
+        return -1;
+    }
+    return expbuf.fd;
+}
+
+bool V4L2Capture::setControl(uint32_t id, int32_t value) {
+    if (fd_ == -1) return false;
+
+    v4l2_control control{.id = id, .value = value};
+    return xioctl(VIDIOC_S_CTRL, &control) == 0;
+}
+
+const V4L2Config& V4L2Capture::getConfig() const {
+    return config_;
+}
+
+} // namespace pallas
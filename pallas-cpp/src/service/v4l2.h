@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <linux/videodev2.h>
+#include <string>
+#include <vector>
+
+namespace pallas {
+
+struct V4L2Config {
+    int device_id{0};       // /dev/video<device_id>
+    int width{640};         // Requested frame width
+    int height{480};        // Requested frame height
+    int fps{60};            // Requested frame rate
+    uint32_t pixel_format{V4L2_PIX_FMT_YUYV};  // Device pixel format
+    int buffer_count{4};    // Number of mmap buffers in the driver ring
+};
+
+/**
+ * A filled driver buffer, valid until it is handed back with requeue().
+ * The pixels are in the device format (YUYV for the PS3 Eye), so callers
+ * convert them straight into their destination.
+ */
+struct V4L2Buffer {
+    uint32_t index{0};       // Driver buffer index, passed back to requeue()
+    const uint8_t* data{nullptr};
+    std::size_t bytes_used{0};
+    int width{0};
+    int height{0};
+    std::size_t stride{0};   // Bytes per line
+    uint32_t pixel_format{0};
+    uint64_t sequence{0};    // Driver frame counter; gaps are lost frames
+    int64_t timestamp_ns{0}; // Capture time on CLOCK_MONOTONIC
+};
+
+/**
+ * Native V4L2 streaming capture over a ring of mmap'ed driver buffers.
+ *
+ * Usage:
+ *     V4L2Capture capture{{.device_id = 0}};
+ *     capture.open();
+ *     auto buffer = capture.dequeue(std::chrono::milliseconds(100));
+ *     .. convert buffer->data ..
+ *     capture.requeue(*buffer);
+ *
+ * Holding on to a buffer keeps it out of the ring, so dequeue at most
+ * buffer_count - 1 at a time.
+ */
+class V4L2Capture {
+public:
+    explicit V4L2Capture(V4L2Config config = {});
+    ~V4L2Capture();
+
+    // Non-copyable
+    V4L2Capture(const V4L2Capture&) = delete;
+    V4L2Capture& operator=(const V4L2Capture&) = delete;
+
+    // Opens the device, negotiates the format, maps the buffers and starts
+    // streaming. The negotiated size may differ from the requested one.
+    std::expected<void, std::string> open();
+
+    bool isOpen() const;
+
+    void close();
+
+    // Waits up to `timeout` for the next filled buffer
+    std::expected<V4L2Buffer, std::string> dequeue(
+        std::chrono::milliseconds timeout);
+
+    // Hands a dequeued buffer back to the driver
+    bool requeue(const V4L2Buffer& buffer);
+
+    // Exports a driver buffer as a DMABUF file descriptor, e.g. to import it
+    // into a GPU API. The caller owns the returned fd. Returns -1 on failure.
+    int exportDmabuf(uint32_t index) const;
+
+    // Sets a V4L2 control (V4L2_CID_*). Returns false if the driver rejects
+    // it or does not have it.
+    bool setControl(uint32_t id, int32_t value);
+
+    // Negotiated format
+    const V4L2Config& getConfig() const;
+
+private:
+    struct MappedBuffer {
+        void* start{nullptr};
+        std::size_t length{0};
+    };
+
+    int xioctl(unsigned long request, void* arg) const;
+    std::expected<void, std::string> fail(const std::string& what);
+
+    V4L2Config config_;
+    std::size_t stride_{0};
+    int fd_{-1};
+    bool streaming_{false};
+    std::vector<MappedBuffer> buffers_;
+};
+
+} // namespace pallas
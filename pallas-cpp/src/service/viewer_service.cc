@@ -3,12 +3,11 @@
 #include <core/logger.h>
 #include <fmt/format.h>
 
-#include <chrono>
 #include <expected>
 #include <filesystem>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/imgcodecs.hpp>
-#include <thread>
+#include <vector>
 
 #include "mat_queue_utils.h"
 
@@ -24,6 +23,9 @@ ViewerService::ViewerService(ViewerServiceConfig config)
         shared_memory_names_.size(), fmt::join(shared_memory_names_, ","));
 }
 
+// Stop the thread and its queue watches before the queues are unmapped
+ViewerService::~ViewerService() { stop(); }
+
 bool ViewerService::start() {
     auto open_result = utils::open_verified_queues<Queue>(shared_memory_names_);
     if (!open_result) {
@@ -31,19 +33,26 @@ bool ViewerService::start() {
     }
     queue_by_name_ = std::move(*open_result);
 
+    // Tick when a producer pushes instead of polling on an interval
+    for (const auto& [name, queue_ptr] : queue_by_name_) {
+        queue_ptr->watch(events());
+    }
+
     std::filesystem::create_directories("./viewer_service");
 
     return Service::start();
 }
 
 void ViewerService::stop() {
-    queue_by_name_.clear();
-
+    // Stop the tick thread before closing the queues it reads
     Service::stop();
+
+    queue_by_name_.clear();
 }
 
 std::expected<void, std::string> ViewerService::tick() {
-    LOGI("ViewerService::tick()");
+    LOGT("ViewerService::tick()");
+
     for (const auto& [name, queue_ptr] : queue_by_name_) {
         if (!queue_ptr) {
             return std::unexpected(
@@ -51,17 +60,15 @@ std::expected<void, std::string> ViewerService::tick() {
         }
 
         cv::Mat frame;
-        if (!queue_ptr->try_pop(frame)) {
-            return std::unexpected("Failed to pop frame on tick.");
+        if (!queue_ptr->try_pop_latest(frame) || frame.empty()) {
+            continue;
         }
 
-        if (!frame.empty()) {
-            // Write frames as images
-            static int frame_idx{0};
-            std::string filename = "./viewer_service/frame_" +
-                                   std::to_string(frame_idx++) + ".png";
-            cv::imwrite(filename, frame);
-        }
+        // Write frames as images
+        static int frame_idx{0};
+        std::string filename =
+            "./viewer_service/frame_" + std::to_string(frame_idx++) + ".png";
+        cv::imwrite(filename, frame);
     }
 
     return std::expected<void, std::string>{};
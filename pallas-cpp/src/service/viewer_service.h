@@ -19,9 +19,10 @@ struct ViewerServiceConfig {
 
 class ViewerService : public Service {
    public:
-    using Queue = MatQueue<2764800>;
+    using Queue = MatQueue;
 
     ViewerService(ViewerServiceConfig config);
+    ~ViewerService() override;
     bool start() override;
     void stop() override;
 
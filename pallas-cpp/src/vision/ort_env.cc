@@ -0,0 +1,57 @@
+#include "ort_env.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "../core/logger.h"
+
+namespace pallas {
+namespace {
+
+std::mutex env_mutex;
+OrtThreadConfig env_config;
+bool env_created = false;
+
+}  // namespace
+
+bool configure_ort_threads(const OrtThreadConfig& config) {
+    std::lock_guard<std::mutex> lock(env_mutex);
+    if (env_created) {
+        LOGW("ONNX Runtime thread pools already created, ignoring new config");
+        return false;
+    }
+    env_config = config;
+    return true;
+}
+
+Ort::Env& shared_ort_env() {
+    static Ort::Env env = []() {
+        std::lock_guard<std::mutex> lock(env_mutex);
+        env_created = true;
+
+        const int intra_op_threads =
+            env_config.intra_op_threads > 0
+                ? env_config.intra_op_threads
+                : std::max(1u, std::thread::hardware_concurrency());
+        Ort::ThreadingOptions threading;
+        threading.SetGlobalIntraOpNumThreads(intra_op_threads);
+        threading.SetGlobalInterOpNumThreads(
+            std::max(1, env_config.inter_op_threads));
+        threading.SetGlobalSpinControl(env_config.allow_spinning ? 1 : 0);
+
+        LOGI("ONNX Runtime global thread pool: {} intra-op threads, {}",
+             intra_op_threads,
+             env_config.allow_spinning ? "spinning" : "not spinning");
+        return Ort::Env(threading, ORT_LOGGING_LEVEL_WARNING, "pallas");
+    }();
+    return env;
+}
+
+Ort::SessionOptions shared_session_options() {
+    Ort::SessionOptions options;
+    options.DisablePerSessionThreads();
+    return options;
+}
+
+}  // namespace pallas
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <onnxruntime_cxx_api.h>
+
+namespace pallas {
+
+// Threads of the process-wide ONNX Runtime pools every session runs on
+struct OrtThreadConfig {
+    int intra_op_threads{0};  // 0 = one per core
+    int inter_op_threads{1};  // Only used by sessions in parallel mode
+    // Idle pool threads spin for new work. Lower latency for one model, but
+    // burns the cores the other models and services need
+    bool allow_spinning{false};
+};
+
+// Sets the pools the shared environment is created with. Returns false if
+// shared_ort_env() has already created it.
+bool configure_ort_threads(const OrtThreadConfig& config);
+
+// The one ONNX Runtime environment of the process, created with global
+// thread pools on first use. YOLO and SAM sessions created from it share
+// those threads instead of each sizing pools to the whole machine.
+Ort::Env& shared_ort_env();
+
+// Session options that run the session on the global pools
+Ort::SessionOptions shared_session_options();
+
+}  // namespace pallas
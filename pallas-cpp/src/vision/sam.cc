@@ -2,6 +2,8 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "ort_env.h"
+
 namespace pallas {
 SegmentAnything::SegmentAnything() {}
 SegmentAnything::~SegmentAnything() {
@@ -70,7 +72,12 @@ bool SegmentAnything::loadModel(const std::string& encoderPath,
         }
         for (int i = 0; i < 2; i++) {
             auto& option = sessionOptions[i];
-            option.SetIntraOpNumThreads(threadsNumber);
+            if (threadsNumber > 0) {
+                option = Ort::SessionOptions();
+                option.SetIntraOpNumThreads(threadsNumber);
+            } else {
+                option = shared_session_options();
+            }
             option.SetGraphOptimizationLevel(
                 GraphOptimizationLevel::ORT_ENABLE_ALL);
             if (device == "cpu") {
@@ -84,9 +91,9 @@ bool SegmentAnything::loadModel(const std::string& encoderPath,
             }
         }
         sessionEncoder = std::make_unique<Ort::Session>(
-            env, encoderPath.c_str(), sessionOptions[0]);
+            shared_ort_env(), encoderPath.c_str(), sessionOptions[0]);
         sessionDecoder = std::make_unique<Ort::Session>(
-            env, decoderPath.c_str(), sessionOptions[1]);
+            shared_ort_env(), decoderPath.c_str(), sessionOptions[1]);
         inputShapeEncoder = sessionEncoder->GetInputTypeInfo(0)
                                 .GetTensorTypeAndShapeInfo()
                                 .GetShape();
@@ -15,7 +15,6 @@ namespace pallas {
 
 class SegmentAnything {
     std::unique_ptr<Ort::Session> sessionEncoder, sessionDecoder;
-    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "test"};
     Ort::SessionOptions sessionOptions[2];
     Ort::RunOptions runOptionsEncoder;
     Ort::MemoryInfo memoryInfo{
@@ -36,6 +35,8 @@ class SegmentAnything {
     void clearPreviousMasks();
     void resizePreviousMasks(int previousMaskIdx);
     void terminatePreprocessing();
+    // threadsNumber = 0 runs on the process-wide pools shared with YOLO,
+    // > 0 gives each session a pool of its own
     bool loadModel(const std::string& encoderPath,
                    const std::string& decoderPath, int threadsNumber,
                    std::string device = "cpu");
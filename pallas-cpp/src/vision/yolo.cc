@@ -1,10 +1,15 @@
 #include "yolo.h"
 
+#include <future>
 #include <opencv2/imgproc.hpp>
 #include <dlfcn.h>
 #include "cuda_workarounds.h"
+#include "ort_env.h"
 
+#include "../core/executor.h"
+#include "../core/letterbox.h"
 #include "../core/logger.h"
+#include "../core/trace.h"
 
 // Define a replacement for ONNX Runtime's GetStackTrace to prevent segfaults
 extern "C" {
@@ -19,11 +24,8 @@ namespace pallas {
 
 YouOnlyLookOnce::YouOnlyLookOnce(const std::string& modelPath,
                                  const std::string& labelsPath, bool useGPU) {
-    env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "ONNX_DETECTION");
-    sessionOptions = Ort::SessionOptions();
-
-    sessionOptions.SetIntraOpNumThreads(
-        std::min(6, static_cast<int>(std::thread::hardware_concurrency())));
+    // Run on the process-wide pools shared with SAM, not a pool of our own
+    sessionOptions = shared_session_options();
     sessionOptions.SetGraphOptimizationLevel(
         GraphOptimizationLevel::ORT_ENABLE_ALL);
 
@@ -80,9 +82,10 @@ YouOnlyLookOnce::YouOnlyLookOnce(const std::string& modelPath,
 
 #ifdef _WIN32
     std::wstring w_modelPath(modelPath.begin(), modelPath.end());
-    session = Ort::Session(env, w_modelPath.c_str(), sessionOptions);
+    session = Ort::Session(shared_ort_env(), w_modelPath.c_str(),
+                           sessionOptions);
 #else
-    session = Ort::Session(env, modelPath.c_str(), sessionOptions);
+    session = Ort::Session(shared_ort_env(), modelPath.c_str(), sessionOptions);
 #endif
 
     Ort::AllocatorWithDefaultOptions allocator;
@@ -93,6 +96,8 @@ YouOnlyLookOnce::YouOnlyLookOnce(const std::string& modelPath,
     isDynamicInputShape =
         (inputTensorShapeVec.size() >= 4) &&
         (inputTensorShapeVec[2] == -1 && inputTensorShapeVec[3] == -1);
+    isDynamicBatch =
+        !inputTensorShapeVec.empty() && inputTensorShapeVec[0] == -1;
 
     auto input_name = session.GetInputNameAllocated(0, allocator);
     inputNodeNameAllocatedStrings.push_back(std::move(input_name));
@@ -109,69 +114,145 @@ YouOnlyLookOnce::YouOnlyLookOnce(const std::string& modelPath,
         throw std::runtime_error("Invalid input tensor shape.");
     }
 
+    // A static output shape lets every workspace bind its own output buffer
+    const std::vector<int64_t> outputTensorShapeVec =
+        session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (!isDynamicInputShape && outputTensorShapeVec.size() == 3 &&
+        outputTensorShapeVec[1] > 0 && outputTensorShapeVec[2] > 0) {
+        outputFeatures = outputTensorShapeVec[1];
+        outputDetections = outputTensorShapeVec[2];
+    }
+
     numInputNodes = session.GetInputCount();
     numOutputNodes = session.GetOutputCount();
 
     classNames_ = utils::getClassNames(labelsPath);
     classColors = utils::generateColors(classNames_);
 
-    LOGI("Model loaded with {} input nodes and {} output nodes.", numInputNodes,
-         numOutputNodes);
+    LOGI("Model loaded with {} input nodes and {} output nodes{}.",
+         numInputNodes, numOutputNodes,
+         isDynamicBatch ? ", dynamic batch" : "");
 }
 
-cv::Mat YouOnlyLookOnce::preprocess(const cv::Mat& image, float*& blob,
-                                    std::vector<int64_t>& inputTensorShape) {
-    cv::Mat resizedImage;
-    utils::letterBox(image, resizedImage, inputImageShape,
-                     cv::Scalar(114, 114, 114), isDynamicInputShape, false,
-                     true, 32);
-
-    cv::Mat rgbImage;
-    cv::cvtColor(resizedImage, rgbImage, cv::COLOR_BGR2RGB);
-
-    rgbImage.convertTo(rgbImage, CV_32FC3, 1.0f / 255.0f);
+YouOnlyLookOnce::WorkspaceLease::WorkspaceLease(YouOnlyLookOnce& owner)
+    : owner_{owner} {
+    {
+        std::lock_guard<std::mutex> lock(owner_.workspaceMutex);
+        if (!owner_.idleWorkspaces.empty()) {
+            workspace_ = std::move(owner_.idleWorkspaces.back());
+            owner_.idleWorkspaces.pop_back();
+            return;
+        }
+        // Room for every workspace, so returning one never allocates
+        owner_.idleWorkspaces.reserve(++owner_.workspaceCount);
+    }
+    workspace_ = std::make_unique<Workspace>(owner_.session);
+}
 
-    blob = new float[rgbImage.cols * rgbImage.rows * rgbImage.channels()];
+YouOnlyLookOnce::WorkspaceLease::~WorkspaceLease() {
+    std::lock_guard<std::mutex> lock(owner_.workspaceMutex);
+    owner_.idleWorkspaces.push_back(std::move(workspace_));
+}
 
-    std::vector<cv::Mat> chw(rgbImage.channels());
-    for (int i = 0; i < rgbImage.channels(); ++i) {
-        chw[i] = cv::Mat(rgbImage.rows, rgbImage.cols, CV_32FC1,
-                         blob + i * rgbImage.cols * rgbImage.rows);
+void YouOnlyLookOnce::bindBuffers(Workspace& workspace,
+                                  const std::array<int64_t, 4>& inputShape) {
+    if (workspace.inputShape == inputShape) {
+        return;
+    }
+    workspace.inputShape = inputShape;
+    workspace.binding.ClearBoundInputs();
+    workspace.binding.ClearBoundOutputs();
+
+    // Shrinking keeps the capacity, so alternating shapes do not reallocate
+    workspace.input.resize(inputShape[0] * inputShape[1] * inputShape[2] *
+                           inputShape[3]);
+    workspace.inputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, workspace.input.data(), workspace.input.size(),
+        inputShape.data(), inputShape.size());
+    workspace.binding.BindInput(inputNames[0], workspace.inputTensor);
+
+    if (outputFeatures > 0) {
+        bindOutput(workspace,
+                   {inputShape[0], outputFeatures, outputDetections});
+    } else {
+        // Until the first run tells the output shape, see run()
+        workspace.outputBound = false;
+        workspace.binding.BindOutput(outputNames[0], memoryInfo);
     }
-    cv::split(rgbImage, chw);
+}
 
-    return rgbImage;
+void YouOnlyLookOnce::bindOutput(Workspace& workspace,
+                                 const std::array<int64_t, 3>& outputShape) {
+    workspace.outputShape = outputShape;
+    workspace.output.resize(outputShape[0] * outputShape[1] * outputShape[2]);
+    workspace.outputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, workspace.output.data(), workspace.output.size(),
+        workspace.outputShape.data(), workspace.outputShape.size());
+    workspace.binding.BindOutput(outputNames[0], workspace.outputTensor);
+    workspace.outputBound = true;
 }
 
-std::vector<Detection> YouOnlyLookOnce::postprocess(
-    const cv::Size& originalImageSize, const cv::Size& resizedImageShape,
-    const std::vector<Ort::Value>& outputTensors, float confThreshold,
-    float iouThreshold) {
-    std::vector<Detection> detections;
-    const float* rawOutput = outputTensors[0].GetTensorData<float>();
-    const std::vector<int64_t> outputShape =
-        outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
+void YouOnlyLookOnce::preprocess(const cv::Mat& image,
+                                 const utils::LetterBoxGeometry& geometry,
+                                 float* blob) {
+    const cv::Size size = geometry.size();
+    letterbox_bgr_to_planar_rgb(image.data, image.step, image.cols,
+                                image.rows, blob,
+                                LetterboxLayout{
+                                    .width = size.width,
+                                    .height = size.height,
+                                    .scaled_width = geometry.scaled.width,
+                                    .scaled_height = geometry.scaled.height,
+                                    .pad_left = geometry.padLeft,
+                                    .pad_top = geometry.padTop,
+                                });
+}
 
-    const size_t num_features = outputShape[1];
-    const size_t num_detections = outputShape[2];
+std::pair<const float*, std::array<int64_t, 3>> YouOnlyLookOnce::run(
+    Workspace& workspace, std::vector<Ort::Value>& allocatedOutputs) {
+    {
+        TRACE_SCOPE("yolo.run");
+        session.Run(Ort::RunOptions{nullptr}, workspace.binding);
+    }
+    if (workspace.outputBound) {
+        return {workspace.output.data(), workspace.outputShape};
+    }
 
+    // ONNX Runtime allocated this output. Its shape holds for as long as
+    // the input shape does, so later runs write into a bound buffer
+    allocatedOutputs = workspace.binding.GetOutputValues();
+    const std::vector<int64_t> shape =
+        allocatedOutputs[0].GetTensorTypeAndShapeInfo().GetShape();
+    const std::array<int64_t, 3> outputShape{shape[0], shape[1], shape[2]};
+    bindOutput(workspace, outputShape);
+    return {allocatedOutputs[0].GetTensorData<float>(), outputShape};
+}
+
+void YouOnlyLookOnce::postprocess(const cv::Size& originalImageSize,
+                                  const cv::Size& resizedImageShape,
+                                  const float* rawOutput, size_t num_features,
+                                  size_t num_detections, float confThreshold,
+                                  float iouThreshold, Workspace& workspace,
+                                  std::vector<Detection>& detections) {
+    detections.clear();
     if (num_detections == 0) {
-        return detections;
+        return;
     }
 
     const int numClasses = static_cast<int>(num_features) - 4;
     if (numClasses <= 0) {
-        return detections;
+        return;
     }
 
-    std::vector<BoundingBox> boxes;
-    boxes.reserve(num_detections);
-    std::vector<float> confs;
-    confs.reserve(num_detections);
-    std::vector<int> classIds;
-    classIds.reserve(num_detections);
-    std::vector<BoundingBox> nms_boxes;
-    nms_boxes.reserve(num_detections);
+    // Candidates go to the workspace, whose vectors keep their capacity
+    std::vector<BoundingBox>& boxes = workspace.boxes;
+    std::vector<float>& confs = workspace.confs;
+    std::vector<int>& classIds = workspace.classIds;
+    std::vector<BoundingBox>& nms_boxes = workspace.nmsBoxes;
+    boxes.clear();
+    confs.clear();
+    classIds.clear();
+    nms_boxes.clear();
 
     const float* ptr = rawOutput;
 
@@ -218,7 +299,7 @@ std::vector<Detection> YouOnlyLookOnce::postprocess(
         }
     }
 
-    std::vector<int> indices;
+    std::vector<int>& indices = workspace.indices;
     utils::NMSBoxes(nms_boxes, confs, confThreshold, iouThreshold, indices);
 
     detections.reserve(indices.size());
@@ -226,53 +307,140 @@ std::vector<Detection> YouOnlyLookOnce::postprocess(
         detections.emplace_back(
             Detection{boxes[idx], classIds[idx], confs[idx]});
     }
-
-    return detections;
 }
 
 std::vector<Detection> YouOnlyLookOnce::detect(const cv::Mat& image,
                                                float confThreshold,
                                                float iouThreshold) {
-    if (image.empty()) {
-        LOGW("Error: Empty image provided to detector");
-        return {};
-    }
-
-    float* blobPtr = nullptr;
-    std::vector<int64_t> inputTensorShape = {1, 3, inputImageShape.height,
-                                             inputImageShape.width};
+    std::vector<Detection> detections;
+    detect(image, detections, confThreshold, iouThreshold);
+    return detections;
+}
 
-    cv::Mat preprocessedImage = preprocess(image, blobPtr, inputTensorShape);
+void YouOnlyLookOnce::detect(const cv::Mat& image,
+                             std::vector<Detection>& detections,
+                             float confThreshold, float iouThreshold) {
+    if (image.empty() || image.type() != CV_8UC3) {
+        LOGW("Error: Detector needs a non-empty 8-bit BGR image");
+        detections.clear();
+        return;
+    }
 
-    size_t inputTensorSize = utils::vectorProduct(inputTensorShape);
+    const utils::LetterBoxGeometry geometry = utils::letterBoxGeometry(
+        image.size(), inputImageShape, isDynamicInputShape, false, true, 32);
+    const cv::Size inputSize = geometry.size();
+    WorkspaceLease workspace(*this);
+    {
+        TRACE_SCOPE("yolo.preprocess");
+        bindBuffers(*workspace, {1, 3, inputSize.height, inputSize.width});
+        preprocess(image, geometry, workspace->input.data());
+    }
 
-    std::vector<float> inputTensorValues(blobPtr, blobPtr + inputTensorSize);
+    std::vector<Ort::Value> allocatedOutputs;
+    const auto [rawOutput, outputShape] = run(*workspace, allocatedOutputs);
 
-    delete[] blobPtr;
+    TRACE_SCOPE("yolo.postprocess");
+    postprocess(image.size(), inputSize, rawOutput, outputShape[1],
+                outputShape[2], confThreshold, iouThreshold, *workspace,
+                detections);
+}
 
-    static Ort::MemoryInfo memoryInfo =
-        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+std::vector<std::vector<Detection>> YouOnlyLookOnce::detect_batch(
+    std::span<const cv::Mat> images, float confThreshold,
+    float iouThreshold) {
+    std::vector<std::vector<Detection>> results(images.size());
+    if (!isDynamicBatch) {
+        Executor& executor = Executor::Shared();
+        std::vector<std::future<std::vector<Detection>>> pending;
+        pending.reserve(images.size());
+        for (const cv::Mat& image : images) {
+            pending.push_back(executor.submit(
+                [this, &image, confThreshold, iouThreshold]() {
+                    return detect(image, confThreshold, iouThreshold);
+                }));
+        }
+        for (std::size_t i = 0; i < pending.size(); ++i) {
+            results[i] = executor.get(pending[i]);
+        }
+        return results;
+    }
 
-    Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-        memoryInfo, inputTensorValues.data(), inputTensorSize,
-        inputTensorShape.data(), inputTensorShape.size());
+    // Frames are letterboxed as detect() does them, so both give the same
+    // detections. Unusable frames get none and no place in a batch
+    std::vector<utils::LetterBoxGeometry> geometries(images.size());
+    std::vector<std::size_t> pending;
+    pending.reserve(images.size());
+    for (std::size_t i = 0; i < images.size(); ++i) {
+        if (images[i].empty() || images[i].type() != CV_8UC3) {
+            LOGW("Error: Detector needs a non-empty 8-bit BGR image");
+        } else {
+            geometries[i] = utils::letterBoxGeometry(
+                images[i].size(), inputImageShape, isDynamicInputShape, false,
+                true, 32);
+            pending.push_back(i);
+        }
+    }
 
-    std::vector<Ort::Value> outputTensors =
-        session.Run(Ort::RunOptions{nullptr}, inputNames.data(), &inputTensor,
-                    numInputNodes, outputNames.data(), numOutputNodes);
+    // Frames of one input size stack into one tensor. That is all of them
+    // for a fixed input shape; with a dynamic one the stride padding
+    // depends on the frame size, so each size runs as its own batch
+    WorkspaceLease workspace(*this);
+    std::vector<std::size_t> batched;
+    batched.reserve(pending.size());
+    while (!pending.empty()) {
+        const cv::Size inputSize = geometries[pending.front()].size();
+        batched.clear();
+        std::size_t kept = 0;
+        for (const std::size_t i : pending) {
+            if (geometries[i].size() == inputSize) {
+                batched.push_back(i);
+            } else {
+                pending[kept++] = i;
+            }
+        }
+        pending.resize(kept);
+        runBatch(images, geometries, batched, confThreshold, iouThreshold,
+                 *workspace, results);
+    }
+    return results;
+}
 
-    cv::Size resizedImageShape(static_cast<int>(inputTensorShape[3]),
-                               static_cast<int>(inputTensorShape[2]));
+void YouOnlyLookOnce::runBatch(
+    std::span<const cv::Mat> images,
+    const std::vector<utils::LetterBoxGeometry>& geometries,
+    const std::vector<std::size_t>& batched, float confThreshold,
+    float iouThreshold, Workspace& workspace,
+    std::vector<std::vector<Detection>>& results) {
+    const cv::Size inputSize = geometries[batched.front()].size();
+    {
+        TRACE_SCOPE("yolo.preprocess");
+        bindBuffers(workspace, {static_cast<int64_t>(batched.size()), 3,
+                                inputSize.height, inputSize.width});
+        const size_t imageSize = 3 * inputSize.area();
+        for (std::size_t k = 0; k < batched.size(); ++k) {
+            preprocess(images[batched[k]], geometries[batched[k]],
+                       workspace.input.data() + k * imageSize);
+        }
+    }
 
-    std::vector<Detection> detections =
-        postprocess(image.size(), resizedImageShape, outputTensors,
-                    confThreshold, iouThreshold);
+    std::vector<Ort::Value> allocatedOutputs;
+    const auto [rawOutput, outputShape] = run(workspace, allocatedOutputs);
 
-    return detections;
+    // The output is {batch, features, detections}, one block per frame
+    TRACE_SCOPE("yolo.postprocess");
+    const size_t num_features = outputShape[1];
+    const size_t num_detections = outputShape[2];
+    for (std::size_t k = 0; k < batched.size(); ++k) {
+        postprocess(images[batched[k]].size(), inputSize,
+                    rawOutput + k * num_features * num_detections,
+                    num_features, num_detections, confThreshold,
+                    iouThreshold, workspace, results[batched[k]]);
+    }
 }
 
 void YouOnlyLookOnce::drawBoundingBox(
     cv::Mat& image, const std::vector<Detection>& detections) const {
+    TRACE_SCOPE("yolo.draw");
     utils::drawBoundingBox(image, detections, classNames_, classColors);
 }
 
@@ -2,18 +2,26 @@
 
 #include <onnxruntime_cxx_api.h>
 
+#include <array>
 #include <memory>
+#include <mutex>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/types.hpp>
+#include <span>
 #include <string>
 #include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "geometry.h"
 
 namespace pallas {
 
+namespace utils {
+struct LetterBoxGeometry;
+}  // namespace utils
+
 struct BoundingBox {
     Point center;
 
@@ -32,6 +40,17 @@ struct Detection {
 
 std::ostream& operator<<(std::ostream& os, const Detection& detection);
 
+/**
+ * YOLO detector on ONNX Runtime. Safe to call from several threads at once.
+ *
+ * Each run uses a workspace of buffers that outlives it: the input tensor
+ * that preprocessing writes into, and the output tensor, both bound to the
+ * session once through an IoBinding. Idle
+ * workspaces are pooled, one per concurrent caller, and rebound only when
+ * the input shape changes, so steady-state detection does not allocate
+ * tensors. Passing the same detections vector to detect() each frame
+ * keeps the whole steady-state call free of allocations.
+ */
 class YouOnlyLookOnce {
    public:
     YouOnlyLookOnce(const std::string& modelPath, const std::string& labelsPath,
@@ -41,6 +60,22 @@ class YouOnlyLookOnce {
                                   float confThreshold = 0.4f,
                                   float iouThreshold = 0.45f);
 
+    // Same, replacing the contents of detections, whose capacity is reused
+    void detect(const cv::Mat& image, std::vector<Detection>& detections,
+                float confThreshold = 0.4f, float iouThreshold = 0.45f);
+
+    // Detects on several frames, e.g. one per camera, returning their
+    // detections in order, the same as detect() gives for each. Models
+    // exported with a dynamic batch dimension run frames of one input size
+    // as one NCHW batch; others run one frame at a time, in parallel on the
+    // shared executor
+    std::vector<std::vector<Detection>> detect_batch(
+        std::span<const cv::Mat> images, float confThreshold = 0.4f,
+        float iouThreshold = 0.45f);
+
+    // Whether detect_batch() runs the frames as one batch
+    bool supports_batch() const { return isDynamicBatch; }
+
     void drawBoundingBox(cv::Mat& image,
                          const std::vector<Detection>& detections) const;
 
@@ -51,11 +86,60 @@ class YouOnlyLookOnce {
     const std::vector<std::string>& class_names() const;
 
    private:
-    Ort::Env env{nullptr};
+    // Buffers of one run at a time, see the class comment
+    struct Workspace {
+        explicit Workspace(Ort::Session& session) : binding{session} {}
+
+        Ort::IoBinding binding;
+        std::array<int64_t, 4> inputShape{};  // NCHW as bound, 0 = unbound
+        std::vector<float> input;
+        Ort::Value inputTensor{nullptr};
+        // When the output shape depends on the input's, ONNX Runtime
+        // allocates the output of the first run after each rebinding, and
+        // later runs reuse a buffer of its shape
+        bool outputBound{false};
+        std::vector<float> output;
+        std::array<int64_t, 3> outputShape{};
+        Ort::Value outputTensor{nullptr};
+
+        // Postprocessing candidates
+        std::vector<BoundingBox> boxes;
+        std::vector<BoundingBox> nmsBoxes;
+        std::vector<float> confs;
+        std::vector<int> classIds;
+        std::vector<int> indices;
+    };
+
+    // Holds a pooled workspace, or a new one if all are busy, for one run
+    class WorkspaceLease {
+       public:
+        explicit WorkspaceLease(YouOnlyLookOnce& owner);
+        ~WorkspaceLease();
+        WorkspaceLease(const WorkspaceLease&) = delete;
+        WorkspaceLease& operator=(const WorkspaceLease&) = delete;
+
+        Workspace& operator*() const { return *workspace_; }
+        Workspace* operator->() const { return workspace_.get(); }
+
+       private:
+        YouOnlyLookOnce& owner_;
+        std::unique_ptr<Workspace> workspace_;
+    };
+
     Ort::SessionOptions sessionOptions{nullptr};
     Ort::Session session{nullptr};
+    Ort::MemoryInfo memoryInfo{
+        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)};
     bool isDynamicInputShape{};
+    bool isDynamicBatch{};
     cv::Size inputImageShape;
+    // Output {features, detections}, 0 where they depend on the input
+    int64_t outputFeatures{0};
+    int64_t outputDetections{0};
+
+    std::mutex workspaceMutex;
+    std::vector<std::unique_ptr<Workspace>> idleWorkspaces;
+    size_t workspaceCount{0};  // Idle or leased
 
     std::vector<Ort::AllocatedStringPtr> inputNodeNameAllocatedStrings;
     std::vector<const char*> inputNames;
@@ -67,13 +151,40 @@ class YouOnlyLookOnce {
     std::vector<std::string> classNames_;
     std::vector<cv::Scalar> classColors;
 
-    cv::Mat preprocess(const cv::Mat& image, float*& blob,
-                       std::vector<int64_t>& inputTensorShape);
-
-    std::vector<Detection> postprocess(
-        const cv::Size& originalImageSize, const cv::Size& resizedImageShape,
-        const std::vector<Ort::Value>& outputTensors, float confThreshold,
-        float iouThreshold);
+    // Binds input and output buffers for inputShape, unless already bound
+    void bindBuffers(Workspace& workspace,
+                     const std::array<int64_t, 4>& inputShape);
+
+    // Binds a buffer of outputShape as the workspace's output
+    void bindOutput(Workspace& workspace,
+                    const std::array<int64_t, 3>& outputShape);
+
+    // Letterboxes a BGR image into blob as normalized RGB planes, in one
+    // pass, see letterbox_bgr_to_planar_rgb()
+    void preprocess(const cv::Mat& image,
+                    const utils::LetterBoxGeometry& geometry, float* blob);
+
+    // Runs the frames at `batched`, whose geometries share one input size,
+    // as one batch and stores their detections in results
+    void runBatch(std::span<const cv::Mat> images,
+                  const std::vector<utils::LetterBoxGeometry>& geometries,
+                  const std::vector<std::size_t>& batched,
+                  float confThreshold, float iouThreshold,
+                  Workspace& workspace,
+                  std::vector<std::vector<Detection>>& results);
+
+    // Runs the bound buffers and returns the {batch, features, detections}
+    // output and its shape
+    std::pair<const float*, std::array<int64_t, 3>> run(
+        Workspace& workspace, std::vector<Ort::Value>& allocatedOutputs);
+
+    // rawOutput is one image's {features, detections} block of the output.
+    // Replaces the contents of detections
+    void postprocess(const cv::Size& originalImageSize,
+                     const cv::Size& resizedImageShape, const float* rawOutput,
+                     size_t num_features, size_t num_detections,
+                     float confThreshold, float iouThreshold,
+                     Workspace& workspace, std::vector<Detection>& detections);
 };
 
 namespace utils {
@@ -90,6 +201,25 @@ typename std::enable_if<std::is_arithmetic<T>::value, T>::type inline clamp(
 std::vector<std::string> getClassNames(const std::string& path);
 size_t vectorProduct(const std::vector<int64_t>& vector);
 
+// Where letterBox() puts an image: scaled to `scaled`, then padded
+struct LetterBoxGeometry {
+    cv::Size scaled;
+    int padLeft{0};
+    int padRight{0};
+    int padTop{0};
+    int padBottom{0};
+
+    cv::Size size() const {
+        return {scaled.width + padLeft + padRight,
+                scaled.height + padTop + padBottom};
+    }
+};
+
+LetterBoxGeometry letterBoxGeometry(const cv::Size& imageSize,
+                                    const cv::Size& newShape, bool auto_ = true,
+                                    bool scaleFill = false, bool scaleUp = true,
+                                    int stride = 32);
+
 void letterBox(const cv::Mat& image, cv::Mat& outImage,
                const cv::Size& newShape,
                const cv::Scalar& color = cv::Scalar(114, 114, 114),
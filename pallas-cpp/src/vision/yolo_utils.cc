@@ -29,18 +29,18 @@ size_t vectorProduct(const std::vector<int64_t>& vector) {
                            std::multiplies<size_t>());
 }
 
-void letterBox(const cv::Mat& image, cv::Mat& outImage,
-               const cv::Size& newShape, const cv::Scalar& color, bool auto_,
-               bool scaleFill, bool scaleUp, int stride) {
-    float ratio = std::min(static_cast<float>(newShape.height) / image.rows,
-                           static_cast<float>(newShape.width) / image.cols);
+LetterBoxGeometry letterBoxGeometry(const cv::Size& imageSize,
+                                    const cv::Size& newShape, bool auto_,
+                                    bool scaleFill, bool scaleUp, int stride) {
+    float ratio = std::min(static_cast<float>(newShape.height) / imageSize.height,
+                           static_cast<float>(newShape.width) / imageSize.width);
 
     if (!scaleUp) {
         ratio = std::min(ratio, 1.0f);
     }
 
-    int newUnpadW = static_cast<int>(std::round(image.cols * ratio));
-    int newUnpadH = static_cast<int>(std::round(image.rows * ratio));
+    int newUnpadW = static_cast<int>(std::round(imageSize.width * ratio));
+    int newUnpadH = static_cast<int>(std::round(imageSize.height * ratio));
 
     int dw = newShape.width - newUnpadW;
     int dh = newShape.height - newUnpadH;
@@ -51,42 +51,34 @@ void letterBox(const cv::Mat& image, cv::Mat& outImage,
     } else if (scaleFill) {
         newUnpadW = newShape.width;
         newUnpadH = newShape.height;
-        ratio = std::min(static_cast<float>(newShape.width) / image.cols,
-                         static_cast<float>(newShape.height) / image.rows);
         dw = 0;
         dh = 0;
-    } else {
-        int padLeft = dw / 2;
-        int padRight = dw - padLeft;
-        int padTop = dh / 2;
-        int padBottom = dh - padTop;
-
-        if (image.cols != newUnpadW || image.rows != newUnpadH) {
-            cv::resize(image, outImage, cv::Size(newUnpadW, newUnpadH), 0, 0,
-                       cv::INTER_LINEAR);
-        } else {
-            outImage = image;
-        }
-
-        cv::copyMakeBorder(outImage, outImage, padTop, padBottom, padLeft,
-                           padRight, cv::BORDER_CONSTANT, color);
-        return;
     }
 
-    if (image.cols != newUnpadW || image.rows != newUnpadH) {
-        cv::resize(image, outImage, cv::Size(newUnpadW, newUnpadH), 0, 0,
-                   cv::INTER_LINEAR);
+    LetterBoxGeometry geometry;
+    geometry.scaled = cv::Size(newUnpadW, newUnpadH);
+    geometry.padLeft = dw / 2;
+    geometry.padRight = dw - geometry.padLeft;
+    geometry.padTop = dh / 2;
+    geometry.padBottom = dh - geometry.padTop;
+    return geometry;
+}
+
+void letterBox(const cv::Mat& image, cv::Mat& outImage,
+               const cv::Size& newShape, const cv::Scalar& color, bool auto_,
+               bool scaleFill, bool scaleUp, int stride) {
+    const LetterBoxGeometry geometry = letterBoxGeometry(
+        image.size(), newShape, auto_, scaleFill, scaleUp, stride);
+
+    if (image.size() != geometry.scaled) {
+        cv::resize(image, outImage, geometry.scaled, 0, 0, cv::INTER_LINEAR);
     } else {
         outImage = image;
     }
 
-    int padLeft = dw / 2;
-    int padRight = dw - padLeft;
-    int padTop = dh / 2;
-    int padBottom = dh - padTop;
-
-    cv::copyMakeBorder(outImage, outImage, padTop, padBottom, padLeft, padRight,
-                       cv::BORDER_CONSTANT, color);
+    cv::copyMakeBorder(outImage, outImage, geometry.padTop,
+                       geometry.padBottom, geometry.padLeft,
+                       geometry.padRight, cv::BORDER_CONSTANT, color);
 }
 
 BoundingBox scaleCoords(const cv::Size& imageShape, BoundingBox coords,
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+
+#include <core/color_convert.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace pallas {
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t size, uint32_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>((i * 131 + seed) ^ (i >> 5) * 17);
+    }
+    return bytes;
+}
+
+uint8_t clamp_u8(double value) {
+    return static_cast<uint8_t>(std::clamp(std::lround(value), 0l, 255l));
+}
+
+// BT.601 video range in floating point
+void reference_bgr(int y, int u, int v, uint8_t* bgr) {
+    const double luma = 1.164383 * (y - 16);
+    bgr[0] = clamp_u8(luma + 2.017232 * (u - 128));
+    bgr[1] = clamp_u8(luma - 0.391762 * (u - 128) - 0.812968 * (v - 128));
+    bgr[2] = clamp_u8(luma + 1.596027 * (v - 128));
+}
+
+// Mirrors a packed image of `channels` bytes per pixel
+std::vector<uint8_t> flipped(const std::vector<uint8_t>& image, int width,
+                             int height, int channels, bool horizontal,
+                             bool vertical) {
+    std::vector<uint8_t> out(image.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int to_y = vertical ? height - 1 - y : y;
+            const int to_x = horizontal ? width - 1 - x : x;
+            std::memcpy(&out[(to_y * width + to_x) * channels],
+                        &image[(y * width + x) * channels], channels);
+        }
+    }
+    return out;
+}
+
+int reflect(int i, int size) {
+    if (i < 0) return -i;
+    if (i >= size) return 2 * size - 2 - i;
+    return i;
+}
+
+// Straightforward bilinear demosaic of an RGGB mosaic
+std::vector<uint8_t> reference_rggb(const std::vector<uint8_t>& mosaic,
+                                    int width, int height) {
+    const auto at = [&](int x, int y) -> int {
+        return mosaic[reflect(y, height) * width + reflect(x, width)];
+    };
+    std::vector<uint8_t> bgr(width * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int cross =
+                (at(x - 1, y) + at(x + 1, y) + at(x, y - 1) + at(x, y + 1) +
+                 2) >> 2;
+            const int diagonal = (at(x - 1, y - 1) + at(x + 1, y - 1) +
+                                  at(x - 1, y + 1) + at(x + 1, y + 1) + 2) >>
+                                 2;
+            const int horizontal = (at(x - 1, y) + at(x + 1, y) + 1) >> 1;
+            const int vertical = (at(x, y - 1) + at(x, y + 1) + 1) >> 1;
+            int b, g, r;
+            if (y % 2 == 0 && x % 2 == 0) {  // R
+                r = at(x, y), g = cross, b = diagonal;
+            } else if (y % 2 == 1 && x % 2 == 1) {  // B
+                b = at(x, y), g = cross, r = diagonal;
+            } else if (y % 2 == 0) {  // G on a red row
+                g = at(x, y), r = horizontal, b = vertical;
+            } else {  // G on a blue row
+                g = at(x, y), b = horizontal, r = vertical;
+            }
+            uint8_t* pixel = &bgr[(y * width + x) * 3];
+            pixel[0] = static_cast<uint8_t>(b);
+            pixel[1] = static_cast<uint8_t>(g);
+            pixel[2] = static_cast<uint8_t>(r);
+        }
+    }
+    return bgr;
+}
+
+}  // namespace
+
+// Widths straddle the vector block sizes so every kernel runs its tail
+class ColorConvertTests : public ::testing::TestWithParam<int> {
+   protected:
+    static constexpr int HEIGHT = 6;
+};
+
+TEST_P(ColorConvertTests, YuyvToBgrMatchesBt601) {
+    const int width = GetParam();
+    const auto yuyv = pattern(width * HEIGHT * 2, 3);
+    std::vector<uint8_t> bgr(width * HEIGHT * 3);
+    yuyv_to_bgr(yuyv.data(), width * 2, bgr.data(), width * 3, width, HEIGHT);
+
+    for (int i = 0; i < width * HEIGHT; ++i) {
+        const uint8_t* pair = &yuyv[(i / 2) * 4];
+        uint8_t expected[3];
+        reference_bgr(pair[(i % 2) * 2], pair[1], pair[3], expected);
+        for (int c = 0; c < 3; ++c) {
+            ASSERT_LE(std::abs(expected[c] - bgr[i * 3 + c]), 2)
+                << "pixel " << i << " channel " << c;
+        }
+    }
+}
+
+TEST_P(ColorConvertTests, YuyvToBgrFusesFlips) {
+    const int width = GetParam();
+    const auto yuyv = pattern(width * HEIGHT * 2, 11);
+    std::vector<uint8_t> plain(width * HEIGHT * 3);
+    yuyv_to_bgr(yuyv.data(), width * 2, plain.data(), width * 3, width, HEIGHT);
+
+    for (bool horizontal : {false, true}) {
+        for (bool vertical : {false, true}) {
+            std::vector<uint8_t> bgr(plain.size());
+            yuyv_to_bgr(yuyv.data(), width * 2, bgr.data(), width * 3, width,
+                        HEIGHT, horizontal, vertical);
+            EXPECT_EQ(flipped(plain, width, HEIGHT, 3, horizontal, vertical),
+                      bgr);
+        }
+    }
+}
+
+TEST_P(ColorConvertTests, YuyvToGrayKeepsLuma) {
+    const int width = GetParam();
+    const auto yuyv = pattern(width * HEIGHT * 2, 5);
+    std::vector<uint8_t> luma(width * HEIGHT);
+    for (size_t i = 0; i < luma.size(); ++i) luma[i] = yuyv[2 * i];
+
+    for (bool horizontal : {false, true}) {
+        for (bool vertical : {false, true}) {
+            std::vector<uint8_t> gray(luma.size());
+            yuyv_to_gray(yuyv.data(), width * 2, gray.data(), width, width,
+                         HEIGHT, horizontal, vertical);
+            EXPECT_EQ(flipped(luma, width, HEIGHT, 1, horizontal, vertical),
+                      gray);
+        }
+    }
+}
+
+TEST_P(ColorConvertTests, BayerToBgrMatchesBilinear) {
+    const int width = GetParam();
+    const auto mosaic = pattern(width * HEIGHT, 7);
+    const auto expected = reference_rggb(mosaic, width, HEIGHT);
+
+    for (bool horizontal : {false, true}) {
+        for (bool vertical : {false, true}) {
+            std::vector<uint8_t> bgr(expected.size());
+            bayer_to_bgr(mosaic.data(), width, bgr.data(), width * 3, width,
+                         HEIGHT, BayerPattern::RGGB, horizontal, vertical);
+            EXPECT_EQ(
+                flipped(expected, width, HEIGHT, 3, horizontal, vertical), bgr);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Widths, ColorConvertTests,
+                         ::testing::Values(2, 16, 18, 40, 64, 98));
+
+TEST(ColorConvertTests, RespectsStrides) {
+    constexpr int WIDTH = 34, HEIGHT = 3, PADDING = 10;
+    const auto yuyv = pattern((WIDTH * 2 + PADDING) * HEIGHT, 9);
+    std::vector<uint8_t> bgr((WIDTH * 3 + PADDING) * HEIGHT, 0xaa);
+    yuyv_to_bgr(yuyv.data(), WIDTH * 2 + PADDING, bgr.data(),
+                WIDTH * 3 + PADDING, WIDTH, HEIGHT);
+
+    for (int y = 0; y < HEIGHT; ++y) {
+        const uint8_t* row = &bgr[y * (WIDTH * 3 + PADDING)];
+        // Padding is never written
+        for (int i = 0; i < PADDING; ++i) EXPECT_EQ(0xaa, row[WIDTH * 3 + i]);
+    }
+}
+
+TEST(ColorConvertTests, BayerConstantColorIsExact) {
+    constexpr int WIDTH = 40, HEIGHT = 8;
+    constexpr uint8_t B = 30, G = 140, R = 220;
+    for (auto pattern_kind : {BayerPattern::BGGR, BayerPattern::GBRG,
+                              BayerPattern::GRBG, BayerPattern::RGGB}) {
+        // Colours of the top-left 2x2 block, row by row
+        std::array<uint8_t, 4> block{};
+        switch (pattern_kind) {
+            case BayerPattern::BGGR: block = {B, G, G, R}; break;
+            case BayerPattern::GBRG: block = {G, B, R, G}; break;
+            case BayerPattern::GRBG: block = {G, R, B, G}; break;
+            case BayerPattern::RGGB: block = {R, G, G, B}; break;
+        }
+        std::vector<uint8_t> mosaic(WIDTH * HEIGHT);
+        for (int y = 0; y < HEIGHT; ++y) {
+            for (int x = 0; x < WIDTH; ++x) {
+                mosaic[y * WIDTH + x] = block[(y % 2) * 2 + x % 2];
+            }
+        }
+
+        std::vector<uint8_t> bgr(WIDTH * HEIGHT * 3);
+        bayer_to_bgr(mosaic.data(), WIDTH, bgr.data(), WIDTH * 3, WIDTH,
+                     HEIGHT, pattern_kind);
+        for (int i = 0; i < WIDTH * HEIGHT; ++i) {
+            ASSERT_EQ(B, bgr[i * 3]) << "pixel " << i;
+            ASSERT_EQ(G, bgr[i * 3 + 1]) << "pixel " << i;
+            ASSERT_EQ(R, bgr[i * 3 + 2]) << "pixel " << i;
+        }
+    }
+}
+
+TEST(ColorConvertTests, ReportsSelectedIsa) {
+    EXPECT_NE(nullptr, color_convert_isa());
+    EXPECT_GT(std::strlen(color_convert_isa()), 0u);
+}
+
+}  // namespace pallas
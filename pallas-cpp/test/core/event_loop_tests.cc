@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "core/event_loop.h"
+#include "core/futex.h"
+
+namespace pallas {
+
+class EventLoopTests : public testing::Test {
+   protected:
+    static constexpr auto TIMEOUT = std::chrono::milliseconds(500);
+
+    // What a producer does after publishing: bump the word, then wake any
+    // sleeper it knows about
+    void push() {
+        word_.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) != 0) {
+            futex_wake(&word_);
+        }
+    }
+
+    EventLoop loop_;
+    std::atomic<uint32_t> word_{0};
+    std::atomic<uint32_t> waiters_{0};
+};
+
+TEST_F(EventLoopTests, TimesOutWithoutSources) {
+    ASSERT_TRUE(loop_.is_valid());
+    EXPECT_TRUE(loop_.empty());
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+}
+
+TEST_F(EventLoopTests, FiresReadableFd) {
+    const int fd = eventfd(0, EFD_NONBLOCK);
+    ASSERT_GE(fd, 0);
+    int calls = 0;
+    ASSERT_TRUE(loop_.add_fd(fd, EPOLLIN, [&]() {
+        uint64_t count;
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(count)),
+                  ::read(fd, &count, sizeof(count)));
+        ++calls;
+    }));
+
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+    const uint64_t one = 1;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(one)), ::write(fd, &one, sizeof(one)));
+    EXPECT_EQ(1, loop_.wait(TIMEOUT));
+    EXPECT_EQ(1, calls);
+
+    loop_.remove_fd(fd);
+    EXPECT_TRUE(loop_.empty());
+    ::close(fd);
+}
+
+TEST_F(EventLoopTests, FiresTimerEveryPeriod) {
+    int calls = 0;
+    const int fd =
+        loop_.add_timer(std::chrono::milliseconds(2), [&]() { ++calls; });
+    ASSERT_GE(fd, 0);
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(1, loop_.wait(TIMEOUT));
+    EXPECT_EQ(5, calls);
+
+    loop_.remove_fd(fd);
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(10)));
+}
+
+TEST_F(EventLoopTests, FiresOnFutexChangeFromAnotherThread) {
+    int calls = 0;
+    ASSERT_TRUE(loop_.add_futex(&word_, &waiters_, [&]() { ++calls; }));
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+
+    std::thread producer([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        push();
+    });
+    EXPECT_EQ(1, loop_.wait(TIMEOUT));
+    producer.join();
+    EXPECT_EQ(1, calls);
+
+    // The watcher sleeps again once it has reported the change
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+}
+
+TEST_F(EventLoopTests, ReportsChangeBeforeWatcherStarted) {
+    ASSERT_TRUE(loop_.add_futex(&word_, &waiters_));
+    push();
+    EXPECT_EQ(1, loop_.wait(TIMEOUT));
+}
+
+TEST_F(EventLoopTests, CoalescesBurstOfPushes) {
+    ASSERT_TRUE(loop_.add_futex(&word_, &waiters_));
+    for (int i = 0; i < 100; ++i) push();
+    EXPECT_EQ(1, loop_.wait(TIMEOUT));
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+}
+
+TEST_F(EventLoopTests, StopsWatchingRemovedFutex) {
+    std::atomic<uint32_t> other{0};
+    ASSERT_TRUE(loop_.add_futex(&word_, &waiters_));
+    ASSERT_TRUE(loop_.add_futex(&other));
+    loop_.remove_futex(&word_);
+    EXPECT_EQ(0u, waiters_.load());
+
+    push();
+    EXPECT_EQ(0, loop_.wait(std::chrono::milliseconds(5)));
+    other.fetch_add(1);
+    futex_wake(&other);
+    EXPECT_EQ(1, loop_.wait(TIMEOUT));
+
+    loop_.clear();
+    EXPECT_TRUE(loop_.empty());
+}
+
+TEST_F(EventLoopTests, WakeInterruptsWait) {
+    ASSERT_TRUE(loop_.add_futex(&word_, &waiters_));
+    std::thread waker([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        loop_.wake();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(0, loop_.wait(std::chrono::nanoseconds(-1)));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, TIMEOUT);
+    waker.join();
+}
+
+}  // namespace pallas
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "core/executor.h"
+
+namespace pallas {
+
+TEST(ExecutorTests, RunsEveryPostedTask) {
+    std::atomic<int> done{0};
+    {
+        Executor executor(4);
+        EXPECT_EQ(4u, executor.worker_count());
+        for (int i = 0; i < 1000; ++i) {
+            executor.post([&done]() { done.fetch_add(1); });
+        }
+    }  // Drains before joining
+    EXPECT_EQ(1000, done.load());
+}
+
+TEST(ExecutorTests, SubmitReturnsResult) {
+    Executor executor(2);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10; ++i) {
+        results.push_back(executor.submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(i * i, executor.get(results[i]));
+    }
+}
+
+TEST(ExecutorTests, NestedTasksDoNotDeadlockSingleWorker) {
+    Executor executor(1);
+    auto outer = executor.submit([&executor]() {
+        std::vector<std::future<int>> inner;
+        for (int i = 1; i <= 4; ++i) {
+            inner.push_back(executor.submit([i]() { return i; }));
+        }
+        int sum = 0;
+        // The only worker is busy here, so it runs the inner tasks itself
+        for (auto& future : inner) sum += executor.get(future);
+        return sum;
+    });
+    EXPECT_EQ(10, executor.get(outer));
+}
+
+TEST(ExecutorTests, IdleWorkersStealQueuedTasks) {
+    Executor executor(2);
+    std::atomic<int> done{0};
+    std::atomic<bool> release{false};
+
+    // The tasks land on the blocked worker's own deque, so only a thief can
+    // run them
+    executor.post([&]() {
+        for (int i = 0; i < 8; ++i) {
+            executor.post([&done]() { done.fetch_add(1); });
+        }
+        while (done.load() < 8 && !release.load()) {
+            std::this_thread::yield();
+        }
+    });
+
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (done.load() < 8 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    release.store(true);
+    EXPECT_EQ(8, done.load());
+    EXPECT_GE(executor.steals(), 8u);
+}
+
+TEST(ExecutorTests, SharedExecutorIsOnePerProcess) {
+    Executor& shared = Executor::Shared();
+    EXPECT_EQ(&shared, &Executor::Shared());
+    EXPECT_GE(shared.worker_count(), 1u);
+    auto result = shared.submit([]() { return 42; });
+    EXPECT_EQ(42, shared.get(result));
+}
+
+}  // namespace pallas
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "service/frame_matcher.h"
+
+namespace pallas {
+
+class FrameMatcherTests : public testing::Test {
+   protected:
+    static constexpr int64_t MS = 1'000'000;
+
+    // Frame ids of a set, in stream order
+    static std::vector<int> ids(
+        const std::vector<FrameMatcher<int>::Pending>& set) {
+        std::vector<int> result;
+        for (const auto& pending : set) result.push_back(pending.frame);
+        return result;
+    }
+
+    FrameMatcher<int> matcher_{2, 2 * MS};
+    std::vector<FrameMatcher<int>::Pending> set_;
+};
+
+TEST_F(FrameMatcherTests, MatchesFramesWithinTolerance) {
+    matcher_.add(0, 1, 100 * MS);
+    EXPECT_FALSE(matcher_.match(set_));
+
+    matcher_.add(1, 2, 101 * MS);
+    ASSERT_TRUE(matcher_.match(set_));
+    EXPECT_EQ((std::vector<int>{1, 2}), ids(set_));
+    EXPECT_EQ(100 * MS, set_[0].capture_ns);
+    EXPECT_EQ(101 * MS, set_[1].capture_ns);
+    EXPECT_EQ(0u, matcher_.pending());
+    EXPECT_EQ(1u, matcher_.matched());
+}
+
+TEST_F(FrameMatcherTests, SkipsFramesTheOtherStreamMissed) {
+    // Stream 1 lost the frame at 116 ms
+    for (int i = 0; i < 3; ++i) matcher_.add(0, i, (100 + 16 * i) * MS);
+    matcher_.add(1, 10, 101 * MS);
+    matcher_.add(1, 12, 133 * MS);
+
+    ASSERT_TRUE(matcher_.match(set_));
+    EXPECT_EQ((std::vector<int>{0, 10}), ids(set_));
+    ASSERT_TRUE(matcher_.match(set_));
+    EXPECT_EQ((std::vector<int>{2, 12}), ids(set_));
+    EXPECT_FALSE(matcher_.match(set_));
+    EXPECT_EQ(1u, matcher_.unmatched());
+}
+
+TEST_F(FrameMatcherTests, WaitsForLaggingStream) {
+    matcher_.add(0, 1, 100 * MS);
+    matcher_.add(0, 2, 116 * MS);
+    EXPECT_FALSE(matcher_.match(set_));
+    EXPECT_EQ(2u, matcher_.pending());
+
+    matcher_.add(1, 3, 115 * MS);
+    ASSERT_TRUE(matcher_.match(set_));
+    EXPECT_EQ((std::vector<int>{2, 3}), ids(set_));
+    EXPECT_EQ(1u, matcher_.unmatched());
+}
+
+TEST_F(FrameMatcherTests, BoundsFramesHeldForStalledStream) {
+    FrameMatcher<int> matcher(2, 2 * MS, 3);
+    for (int i = 0; i < 10; ++i) matcher.add(0, i, i * 16 * MS);
+    EXPECT_EQ(3u, matcher.pending());
+    EXPECT_EQ(7u, matcher.unmatched());
+
+    matcher.clear(0);
+    EXPECT_EQ(0u, matcher.pending());
+    EXPECT_EQ(10u, matcher.unmatched());
+}
+
+TEST_F(FrameMatcherTests, MatchesThreeStreamsOfMoveOnlyFrames) {
+    FrameMatcher<std::unique_ptr<int>> matcher(3, 1 * MS);
+    std::vector<FrameMatcher<std::unique_ptr<int>>::Pending> set;
+    matcher.add(0, std::make_unique<int>(0), 200 * MS);
+    matcher.add(1, std::make_unique<int>(1), 200 * MS + MS / 2);
+    matcher.add(2, std::make_unique<int>(2), 198 * MS);  // Too early
+    EXPECT_FALSE(matcher.match(set));
+
+    matcher.add(2, std::make_unique<int>(3), 201 * MS);
+    ASSERT_TRUE(matcher.match(set));
+    ASSERT_EQ(3u, set.size());
+    EXPECT_EQ(0, *set[0].frame);
+    EXPECT_EQ(1, *set[1].frame);
+    EXPECT_EQ(3, *set[2].frame);
+}
+
+}  // namespace pallas
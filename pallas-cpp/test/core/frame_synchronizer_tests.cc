@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "service/frame_synchronizer.h"
+#include "service/mat_queue.h"
+
+namespace pallas {
+
+class FrameSynchronizerTests : public testing::Test {
+   protected:
+    static constexpr int ROWS = 4;
+    static constexpr int COLS = 8;
+    static constexpr const char* OUTPUT = "sync_test_out";
+
+    void SetUp() override {
+        for (const auto& name : names_) {
+            inputs_.push_back(MatQueue::Create(
+                name, 4, FrameGeometry::Of(2 * ROWS, COLS, CV_8UC3)));
+        }
+        synchronizer_ = std::make_unique<FrameSynchronizer>(
+            FrameSynchronizerConfig{
+                .base = {.name = "sync-test", .port = 0, .interval_ms = 0},
+                .input_queue_names = names_,
+                .output_queue_name = OUTPUT,
+                .output_frame_capacity = 4,
+                .tolerance_ns = 1'000'000});
+        ASSERT_TRUE(synchronizer_->start());
+        // Inputs attach on their first poll and only see later frames
+        ASSERT_TRUE(wait_for([&] {
+            for (const auto& input : inputs_) {
+                if (input.consumer_count() != 1) return false;
+            }
+            return true;
+        }));
+    }
+
+    void TearDown() override {
+        synchronizer_.reset();
+        inputs_.clear();
+        for (const auto& name : names_) MatQueue::Close(name);
+        MatQueue::Close(OUTPUT);
+    }
+
+    static bool wait_for(const std::function<bool()>& done) {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // One frame of `rows` per input, filled with value + input index and
+    // captured 100 us apart
+    void push_set(int64_t capture_ns, int rows, uint8_t value) {
+        for (std::size_t i = 0; i < inputs_.size(); ++i) {
+            const cv::Mat frame(rows, COLS, CV_8UC3,
+                                cv::Scalar::all(value + static_cast<int>(i)));
+            ASSERT_TRUE(inputs_[i].try_push(
+                frame, FrameInfo{.sequence = static_cast<uint64_t>(value),
+                                 .capture_ns = capture_ns +
+                                               static_cast<int64_t>(i) * 100'000}));
+        }
+    }
+
+    // Waits until the output holds sets of `rows` per view
+    bool wait_for_output(int rows) {
+        const std::size_t size =
+            FrameGeometry::Of(rows * static_cast<int>(inputs_.size()), COLS,
+                              CV_8UC3)
+                .max_frame_size;
+        return wait_for([&] {
+            const MatQueue output = MatQueue::Open(OUTPUT);
+            return output.is_valid() && output.max_frame_size() == size;
+        });
+    }
+
+    static std::size_t open_descriptors() {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/fd"),
+                             std::filesystem::directory_iterator{});
+    }
+
+    std::vector<std::string> names_{"sync_test_a", "sync_test_b"};
+    std::vector<MatQueue> inputs_;
+    std::unique_ptr<FrameSynchronizer> synchronizer_;
+};
+
+TEST_F(FrameSynchronizerTests, PublishesMatchedSetsStacked) {
+    // The first set creates the output queue
+    push_set(1'000'000'000, ROWS, 10);
+    ASSERT_TRUE(wait_for_output(ROWS));
+    MatQueue output = MatQueue::Open(OUTPUT);
+    ASSERT_NE(-1, output.register_consumer());
+
+    push_set(2'000'000'000, ROWS, 20);
+    cv::Mat set;
+    ASSERT_TRUE(output.wait_pop(set, std::chrono::seconds(1)));
+    ASSERT_EQ(2 * ROWS, set.rows);
+    ASSERT_EQ(COLS, set.cols);
+    EXPECT_EQ(cv::Scalar(20, 20, 20), cv::mean(set.rowRange(0, ROWS)));
+    EXPECT_EQ(cv::Scalar(21, 21, 21), cv::mean(set.rowRange(ROWS, 2 * ROWS)));
+    // Stamped with the earliest view
+    EXPECT_EQ(2'000'000'000, output.last_info().capture_ns);
+}
+
+TEST_F(FrameSynchronizerTests, RestartWatchesOpenInputs) {
+    push_set(1'000'000'000, ROWS, 10);
+    ASSERT_TRUE(wait_for_output(ROWS));
+    MatQueue output = MatQueue::Open(OUTPUT);
+    ASSERT_NE(-1, output.register_consumer());
+
+    synchronizer_->stop();
+    ASSERT_TRUE(synchronizer_->start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // A push wakes the synchronizer well before its 500 ms retry timer
+    push_set(2'000'000'000, ROWS, 20);
+    cv::Mat set;
+    ASSERT_TRUE(output.wait_pop(set, std::chrono::milliseconds(250)));
+    EXPECT_EQ(cv::Scalar(20, 20, 20), cv::mean(set.rowRange(0, ROWS)));
+}
+
+TEST_F(FrameSynchronizerTests, ResizingTheOutputReleasesTheOldQueue) {
+    push_set(1'000'000'000, ROWS, 1);
+    ASSERT_TRUE(wait_for_output(ROWS));
+    const std::size_t descriptors = open_descriptors();
+
+    // Each change of frame size replaces the output queue
+    for (int i = 0; i < 8; ++i) {
+        const int rows = i % 2 == 0 ? 2 * ROWS : ROWS;
+        push_set(2'000'000'000 + i * 1'000'000'000ll, rows,
+                 static_cast<uint8_t>(2 + i));
+        ASSERT_TRUE(wait_for_output(rows));
+    }
+    EXPECT_EQ(descriptors, open_descriptors());
+}
+
+}  // namespace pallas
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <core/histogram.h>
+
+#include <cstdint>
+
+namespace pallas {
+
+TEST(LatencyHistogramTests, EmptyReportsZero) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0, histogram.percentile_ns(50));
+    EXPECT_EQ(0.0, histogram.mean_ns());
+}
+
+TEST(LatencyHistogramTests, SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (int64_t ns = 0; ns < 8; ++ns) histogram.record(ns);
+    EXPECT_EQ(8u, histogram.count());
+    EXPECT_EQ(0, histogram.percentile_ns(0));
+    EXPECT_EQ(3, histogram.percentile_ns(50));
+    EXPECT_EQ(7, histogram.percentile_ns(100));
+    EXPECT_DOUBLE_EQ(3.5, histogram.mean_ns());
+}
+
+TEST(LatencyHistogramTests, PercentilesWithinBucketError) {
+    LatencyHistogram histogram;
+    // 1 to 1000 microseconds
+    for (int64_t us = 1; us <= 1000; ++us) histogram.record(us * 1000);
+
+    for (double p : {10.0, 50.0, 90.0, 99.0}) {
+        const double exact = p * 10 * 1000;
+        const double reported = histogram.percentile_ns(p);
+        EXPECT_GE(reported, exact) << "p" << p;
+        EXPECT_LE(reported, exact * 1.125) << "p" << p;
+    }
+    EXPECT_EQ(1'000'000, histogram.percentile_ns(100));
+    EXPECT_EQ(1'000'000, histogram.max_ns());
+}
+
+TEST(LatencyHistogramTests, CountsSamplesAtMostBound) {
+    LatencyHistogram histogram;
+    for (int64_t ns = 0; ns < 8; ++ns) histogram.record(ns);
+    EXPECT_EQ(4u, histogram.count_at_most(3));
+
+    // 1024 falls in the bucket [1024, 1151]
+    histogram.record(1024);
+    histogram.record(4096);
+    EXPECT_EQ(8u, histogram.count_at_most(1150));
+    EXPECT_EQ(9u, histogram.count_at_most(1151));
+    EXPECT_EQ(10u, histogram.count_at_most(INT64_MAX));
+    EXPECT_EQ(28 + 1024 + 4096, histogram.sum_ns());
+}
+
+TEST(LatencyHistogramTests, HandlesExtremesAndReset) {
+    LatencyHistogram histogram;
+    histogram.record(-5);  // Clock went backwards; counted as 0
+    histogram.record(INT64_MAX);
+    EXPECT_EQ(0, histogram.percentile_ns(50));
+    EXPECT_EQ(INT64_MAX, histogram.percentile_ns(100));
+
+    histogram.reset();
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0, histogram.max_ns());
+}
+
+}  // namespace pallas
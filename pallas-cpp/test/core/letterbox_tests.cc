@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <core/letterbox.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace pallas {
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t size, uint32_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>((i * 131 + seed) ^ (i >> 5) * 17);
+    }
+    return bytes;
+}
+
+// Straightforward bilinear letterbox in double precision
+std::vector<float> reference(const std::vector<uint8_t>& src, size_t stride,
+                             int src_width, int src_height,
+                             const LetterboxLayout& layout) {
+    const size_t plane = static_cast<size_t>(layout.width) * layout.height;
+    std::vector<float> out(3 * plane, 114.0f / 255.0f);
+    const auto tap = [](int d, int src_size, int dst_size, int& index,
+                        double& weight) {
+        const double position =
+            (d + 0.5) * src_size / static_cast<double>(dst_size) - 0.5;
+        index = static_cast<int>(std::floor(position));
+        weight = position - index;
+        if (index < 0) {
+            index = 0;
+            weight = 0;
+        } else if (index >= src_size - 1) {
+            index = src_size - 1;
+            weight = 0;
+        }
+    };
+    for (int dy = 0; dy < layout.scaled_height; ++dy) {
+        int y0;
+        double wy;
+        tap(dy, src_height, layout.scaled_height, y0, wy);
+        const int y1 = std::min(y0 + 1, src_height - 1);
+        for (int dx = 0; dx < layout.scaled_width; ++dx) {
+            int x0;
+            double wx;
+            tap(dx, src_width, layout.scaled_width, x0, wx);
+            const int x1 = std::min(x0 + 1, src_width - 1);
+            const auto at = [&](int x, int y, int c) {
+                return static_cast<double>(src[y * stride + 3 * x + c]);
+            };
+            const size_t out_index =
+                static_cast<size_t>(dy + layout.pad_top) * layout.width +
+                dx + layout.pad_left;
+            for (int c = 0; c < 3; ++c) {
+                const double top = at(x0, y0, c) * (1 - wx) + at(x1, y0, c) * wx;
+                const double bottom =
+                    at(x0, y1, c) * (1 - wx) + at(x1, y1, c) * wx;
+                // Planes are RGB, the source is BGR
+                out[(2 - c) * plane + out_index] =
+                    static_cast<float>((top * (1 - wy) + bottom * wy) / 255.0);
+            }
+        }
+    }
+    return out;
+}
+
+void expect_matches_reference(int src_width, int src_height,
+                              const LetterboxLayout& layout) {
+    const size_t stride = 3 * src_width + 5;  // Padded rows
+    const auto src = pattern(stride * src_height, src_width);
+    std::vector<float> out(3 * layout.width * layout.height, -1.0f);
+    letterbox_bgr_to_planar_rgb(src.data(), stride, src_width, src_height,
+                                out.data(), layout);
+
+    const auto expected =
+        reference(src, stride, src_width, src_height, layout);
+    ASSERT_EQ(expected.size(), out.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_NEAR(expected[i], out[i], 1e-4f)
+            << "at " << i << " of " << src_width << "x" << src_height;
+    }
+}
+
+}  // namespace
+
+TEST(LetterboxTests, CopiesWithoutScaling) {
+    const int width = 37, height = 5;
+    const auto src = pattern(3 * width * height, 7);
+    const LetterboxLayout layout{.width = width,
+                                 .height = height,
+                                 .scaled_width = width,
+                                 .scaled_height = height};
+    std::vector<float> out(3 * width * height);
+    letterbox_bgr_to_planar_rgb(src.data(), 3 * width, width, height,
+                                out.data(), layout);
+
+    const size_t plane = width * height;
+    for (size_t i = 0; i < plane; ++i) {
+        EXPECT_FLOAT_EQ(src[3 * i + 2] / 255.0f, out[i]);
+        EXPECT_FLOAT_EQ(src[3 * i + 1] / 255.0f, out[plane + i]);
+        EXPECT_FLOAT_EQ(src[3 * i] / 255.0f, out[2 * plane + i]);
+    }
+}
+
+TEST(LetterboxTests, DownscalesIntoPaddedCanvas) {
+    // 640x480 camera into a 640x640 input: bars above and below
+    expect_matches_reference(640, 480,
+                             {.width = 640,
+                              .height = 640,
+                              .scaled_width = 640,
+                              .scaled_height = 480,
+                              .pad_left = 0,
+                              .pad_top = 80});
+    expect_matches_reference(1280, 720,
+                             {.width = 640,
+                              .height = 640,
+                              .scaled_width = 640,
+                              .scaled_height = 360,
+                              .pad_left = 0,
+                              .pad_top = 140});
+    // Odd sizes leave a scalar tail and bars on every side
+    expect_matches_reference(101, 77,
+                             {.width = 64,
+                              .height = 64,
+                              .scaled_width = 53,
+                              .scaled_height = 40,
+                              .pad_left = 5,
+                              .pad_top = 12});
+}
+
+TEST(LetterboxTests, Upscales) {
+    expect_matches_reference(33, 17,
+                             {.width = 96,
+                              .height = 96,
+                              .scaled_width = 96,
+                              .scaled_height = 49,
+                              .pad_left = 0,
+                              .pad_top = 23});
+    expect_matches_reference(1, 1,
+                             {.width = 16,
+                              .height = 16,
+                              .scaled_width = 16,
+                              .scaled_height = 16});
+}
+
+TEST(LetterboxTests, FillsPaddingWithPadValue) {
+    const auto src = pattern(3 * 8 * 8, 3);
+    const LetterboxLayout layout{.width = 12,
+                                 .height = 10,
+                                 .scaled_width = 8,
+                                 .scaled_height = 8,
+                                 .pad_left = 2,
+                                 .pad_top = 1};
+    std::vector<float> out(3 * 12 * 10, -1.0f);
+    letterbox_bgr_to_planar_rgb(src.data(), 3 * 8, 8, 8, out.data(), layout,
+                                50, 1.0f);
+
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < 10; ++y) {
+            for (int x = 0; x < 12; ++x) {
+                const bool inside = y >= 1 && y < 9 && x >= 2 && x < 10;
+                const float value = out[(c * 10 + y) * 12 + x];
+                if (inside) {
+                    EXPECT_GE(value, 0.0f);
+                } else {
+                    EXPECT_EQ(50.0f, value) << c << " " << x << "," << y;
+                }
+            }
+        }
+    }
+}
+
+}  // namespace pallas
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "core/async_log_sink.h"
+#include "core/logger.h"
+
+namespace pallas {
+
+namespace {
+
+std::size_t count_lines(const std::string& text) {
+    return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+}  // namespace
+
+TEST(LoggerTests, AsyncSinkWritesRecordsInOrder) {
+    std::ostringstream out;
+    auto target = std::make_shared<spdlog::sinks::ostream_sink_st>(out);
+    {
+        auto sink = std::make_shared<AsyncLogSink>(target, 64);
+        sink->set_pattern("%n %l %v");
+        spdlog::logger logger("async", sink);
+        for (int i = 0; i < 10; ++i) {
+            logger.info("record {}", i);
+        }
+        logger.warn("{}", std::string(1000, 'x'));
+    }
+
+    std::string expected;
+    for (int i = 0; i < 10; ++i) {
+        expected += "async info record " + std::to_string(i) + "\n";
+    }
+    expected += "async warning " + std::string(1000, 'x') + "\n";
+    EXPECT_EQ(expected, out.str());
+}
+
+TEST(LoggerTests, AsyncSinkDropsWhenFull) {
+    std::ostringstream out;
+    auto target = std::make_shared<spdlog::sinks::ostream_sink_st>(out);
+    uint64_t dropped = 0;
+    {
+        auto sink = std::make_shared<AsyncLogSink>(target, 4);
+        sink->set_pattern("%v");
+        spdlog::logger logger("async", sink);
+        // The background thread drains every few milliseconds, so a burst
+        // overflows the ring
+        for (int i = 0; i < 1000; ++i) {
+            logger.info("record {}", i);
+        }
+        dropped = sink->dropped();
+    }
+
+    EXPECT_GT(dropped, 0u);
+    const std::string text = out.str();
+    EXPECT_NE(std::string::npos, text.find("record 0\n"));
+    EXPECT_NE(std::string::npos, text.find("log records, the log ring was full"));
+    // Every record is either written or counted, plus the drop report(s)
+    EXPECT_LE(1000 - dropped, count_lines(text));
+}
+
+TEST(LoggerTests, AsyncSinkWritesErrorsBeforeReturning) {
+    std::ostringstream out;
+    auto target = std::make_shared<spdlog::sinks::ostream_sink_st>(out);
+    auto sink = std::make_shared<AsyncLogSink>(target, 64);
+    sink->set_pattern("%l %v");
+    spdlog::logger logger("async", sink);
+
+    // Queued records are written first, then the error, all before
+    // error() returns, so nothing waits for the background thread
+    logger.info("queued {}", 1);
+    logger.info("queued {}", 2);
+    logger.error("failed {}", 3);
+    EXPECT_EQ("info queued 1\ninfo queued 2\nerror failed 3\n", out.str());
+
+    logger.critical("fatal");
+    EXPECT_EQ("info queued 1\ninfo queued 2\nerror failed 3\n"
+              "critical fatal\n",
+              out.str());
+}
+
+TEST(LoggerTests, AsyncSinkNeverDropsErrors) {
+    std::ostringstream out;
+    auto target = std::make_shared<spdlog::sinks::ostream_sink_st>(out);
+    auto sink = std::make_shared<AsyncLogSink>(target, 4);
+    sink->set_pattern("%v");
+    spdlog::logger logger("async", sink);
+
+    for (int i = 0; i < 1000; ++i) {
+        logger.info("record {}", i);
+        if (i % 100 == 0) {
+            logger.error("error {}", i);
+        }
+    }
+    // Writes the remaining infos, so the background thread is done with out
+    logger.flush();
+    const std::string text = out.str();
+    for (int i = 0; i < 1000; i += 100) {
+        EXPECT_NE(std::string::npos, text.find("error " + std::to_string(i) +
+                                               "\n"))
+            << i;
+    }
+}
+
+TEST(LoggerTests, AsyncSinkFlushWritesQueuedRecords) {
+    std::ostringstream out;
+    auto target = std::make_shared<spdlog::sinks::ostream_sink_st>(out);
+    auto sink = std::make_shared<AsyncLogSink>(target, 64);
+    sink->set_pattern("%v");
+    spdlog::logger logger("async", sink);
+
+    logger.info("one");
+    logger.warn("two");
+    logger.flush();
+    EXPECT_EQ("one\ntwo\n", out.str());
+}
+
+TEST(LoggerTests, EveryNLogsOneInN) {
+    std::ostringstream out;
+    auto previous = spdlog::default_logger();
+    auto logger = std::make_shared<spdlog::logger>(
+        "every_n", std::make_shared<spdlog::sinks::ostream_sink_st>(out));
+    logger->set_pattern("%v");
+    spdlog::set_default_logger(logger);
+
+    for (int i = 0; i < 25; ++i) {
+        LOGI_EVERY_N(10, "call {}", i);
+    }
+
+    spdlog::set_default_logger(previous);
+    EXPECT_EQ("call 0\ncall 10\ncall 20\n", out.str());
+}
+
+TEST(LoggerTests, EveryMsRateLimits) {
+    std::ostringstream out;
+    auto previous = spdlog::default_logger();
+    auto logger = std::make_shared<spdlog::logger>(
+        "every_ms", std::make_shared<spdlog::sinks::ostream_sink_st>(out));
+    logger->set_pattern("%v");
+    spdlog::set_default_logger(logger);
+
+    auto log = [](int i) { LOGI_EVERY_MS(50, "call {}", i); };
+    for (int i = 0; i < 100; ++i) {
+        log(i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    log(100);
+
+    spdlog::set_default_logger(previous);
+    EXPECT_EQ("call 0\ncall 100\n", out.str());
+}
+
+}  // namespace pallas
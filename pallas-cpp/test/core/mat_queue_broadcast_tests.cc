@@ -2,23 +2,25 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <opencv2/core.hpp>
 #include <thread>
 
-#include "service/spmc_mat_queue.h"
+#include "service/mat_queue.h"
 
 namespace pallas {
 
-class SimpleMatQueueTests : public testing::Test {
+class MatQueueBroadcastTests : public testing::Test {
    protected:
-    using Queue = MultiConsumerMatQueue<300>;
+    using Queue = MatQueue;
 
     void SetUp() override {
         // Clean up any leftover shared memory
         Queue::Close("simple_test");
 
         // Create a fresh queue for testing
-        queue_ = Queue::Create("simple_test", 5);
+        queue_ = Queue::Create("simple_test", 5, FrameGeometry{300});
 
         frames_.reserve(5);
         frames_.push_back(cv::Mat(10, 10, CV_8UC3, cv::Scalar(0, 0, 0)));
@@ -34,7 +36,7 @@ class SimpleMatQueueTests : public testing::Test {
     std::vector<cv::Mat> frames_;
 };
 
-TEST_F(SimpleMatQueueTests, RegisterThenPush) {
+TEST_F(MatQueueBroadcastTests, RegisterThenPush) {
     // First, make sure we have a valid queue
     EXPECT_TRUE(queue_.is_valid());
 
@@ -75,7 +77,7 @@ TEST_F(SimpleMatQueueTests, RegisterThenPush) {
     EXPECT_FALSE(queue_.is_consumer());
 }
 
-TEST_F(SimpleMatQueueTests, PushThenRegister) {
+TEST_F(MatQueueBroadcastTests, PushThenRegister) {
     // First, make sure we have a valid queue
     EXPECT_TRUE(queue_.is_valid());
 
@@ -114,7 +116,7 @@ TEST_F(SimpleMatQueueTests, PushThenRegister) {
     EXPECT_TRUE(queue_.unregister_consumer());
 }
 
-TEST_F(SimpleMatQueueTests, TwoConsumers) {
+TEST_F(MatQueueBroadcastTests, TwoConsumers) {
     // First, make sure we have a valid queue
     EXPECT_TRUE(queue_.is_valid());
 
@@ -181,4 +183,91 @@ TEST_F(SimpleMatQueueTests, TwoConsumers) {
     EXPECT_TRUE(queue_.unregister_consumer());
     EXPECT_TRUE(consumer2_queue.unregister_consumer());
 }
+
+TEST_F(MatQueueBroadcastTests, WaitPopWakesOnPush) {
+    EXPECT_GE(queue_.register_consumer(), 0);
+
+    cv::Mat popped;
+    EXPECT_FALSE(queue_.wait_pop(popped, std::chrono::milliseconds(5)));
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue_.try_push(frames_[2]);
+    });
+    EXPECT_TRUE(queue_.wait_pop(popped, std::chrono::seconds(5)));
+    producer.join();
+
+    double min, max;
+    cv::minMaxIdx(popped, &min, &max);
+    EXPECT_DOUBLE_EQ(2.0, max);
+    EXPECT_TRUE(queue_.unregister_consumer());
+}
+TEST_F(MatQueueBroadcastTests, SlowConsumerDoesNotBlockProducer) {
+    auto fast = Queue::Open("simple_test");
+    auto slow = Queue::Open("simple_test");
+    EXPECT_GE(fast.register_consumer(), 0);
+    EXPECT_GE(slow.register_consumer(), 0);
+
+    // The fast consumer sees every frame while the slow one never reads.
+    for (int i = 0; i < 20; ++i) {
+        cv::Mat frame(10, 10, CV_8UC3, cv::Scalar(i, 0, 0));
+        EXPECT_TRUE(queue_.try_push(frame));
+        cv::Mat popped;
+        ASSERT_TRUE(fast.try_pop(popped));
+        double min, max;
+        cv::minMaxIdx(popped, &min, &max);
+        EXPECT_DOUBLE_EQ(static_cast<double>(i), max);
+    }
+    EXPECT_EQ(0u, fast.dropped());
+
+    // The slow consumer was lapped: it gets the newest 5 and counts the rest.
+    std::size_t popped_count = 0;
+    cv::Mat popped;
+    while (slow.try_pop(popped)) ++popped_count;
+    EXPECT_EQ(5u, popped_count);
+    EXPECT_EQ(15u, slow.dropped());
+}
+
+TEST_F(MatQueueBroadcastTests, MoreThanEightConsumers) {
+    std::vector<Queue> consumers;
+    for (int i = 0; i < 20; ++i) {
+        consumers.push_back(Queue::Open("simple_test"));
+        EXPECT_GE(consumers.back().register_consumer(), 0);
+    }
+    EXPECT_EQ(20u, queue_.consumer_count());
+
+    EXPECT_TRUE(queue_.try_push(frames_[3]));
+    for (auto& consumer : consumers) {
+        cv::Mat popped;
+        EXPECT_TRUE(consumer.try_pop(popped));
+    }
+
+    consumers.clear();
+    EXPECT_EQ(0u, queue_.consumer_count());
+}
+
+TEST_F(MatQueueBroadcastTests, DeadConsumerIsReaped) {
+    // A consumer process leases every slot and dies without releasing them.
+    const pid_t child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0) {
+        auto consumer = Queue::Open("simple_test");
+        std::vector<FrameLease> leases(frames_.size());
+        for (std::size_t i = 0; i < frames_.size(); ++i) {
+            consumer.try_push(frames_[i]);
+            consumer.try_acquire(leases[i]);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+
+    EXPECT_EQ(1u, queue_.consumer_count());
+    EXPECT_FALSE(queue_.try_push(frames_[0]));
+
+    // Once its process is gone the cursor and its leases are returned.
+    EXPECT_EQ(1u, queue_.reap_dead_consumers(std::chrono::nanoseconds(0)));
+    EXPECT_EQ(0u, queue_.consumer_count());
+    EXPECT_TRUE(queue_.try_push(frames_[0]));
+}
 }  // namespace pallas
@@ -1,7 +1,12 @@
 #include <core/logger.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <opencv2/core.hpp>
+#include <thread>
 
 #include "service/mat_queue.h"
 
@@ -9,10 +14,10 @@ namespace pallas {
 
 class MatQueueTests : public testing::Test {
    protected:
-    using Queue = MatQueue<300>;
+    using Queue = MatQueue;
 
     void SetUp() override {
-        queue_ = Queue::Create("test", 5);
+        queue_ = Queue::Create("test", 5, FrameGeometry{300});
 
         frames_.reserve(5);
         frames_.push_back(cv::Mat(10, 10, CV_8UC3, cv::Scalar(0, 0, 0)));
@@ -38,20 +43,365 @@ TEST_F(MatQueueTests, SingleConsumer) {
     cv::Mat pushed(10, 10, CV_8UC3, cv::Scalar(6, 0, 0));
     EXPECT_TRUE(queue_.try_push(pushed));
 
+    // The oldest frame was dropped, the remainder frames should be preserved.
+    for (std::size_t i = 1; i < frames_.size(); ++i) {
+        cv::Mat popped;
+        EXPECT_TRUE(queue_.try_pop(popped));
+        double min, max;
+        cv::minMaxIdx(popped, &min, &max);
+        EXPECT_DOUBLE_EQ(0.0, min);
+        EXPECT_DOUBLE_EQ(static_cast<double>(i), max);
+    }
+
     // The popped frame should be the added frame.
     cv::Mat popped;
     EXPECT_TRUE(queue_.try_pop(popped));
     EXPECT_EQ(0, cv::norm(pushed - popped));
+    EXPECT_EQ(1u, queue_.dropped());
+
+    cv::Mat extra;
+    EXPECT_FALSE(queue_.try_pop(extra));
+}
+
+TEST_F(MatQueueTests, RejectsOversizedFrame) {
+    cv::Mat oversized(20, 20, CV_8UC3, cv::Scalar(1, 0, 0));
+    EXPECT_FALSE(queue_.try_push(oversized));
+
+    cv::Mat popped;
+    EXPECT_FALSE(queue_.try_pop(popped));
+}
+
+TEST_F(MatQueueTests, WrapsManyTimes) {
+    // Interleaved push/pop keeps working across many laps of the ring.
+    for (int i = 0; i < 100; ++i) {
+        cv::Mat frame(10, 10, CV_8UC3, cv::Scalar(i, 0, 0));
+        EXPECT_TRUE(queue_.try_push(frame));
 
-    // The remainder frames should be preserved.
-    for (std::size_t i = 1; i < frames_.size(); ++i) {
         cv::Mat popped;
-        EXPECT_TRUE(queue_.try_pop(popped));
+        EXPECT_TRUE(queue_.try_pop_zero_copy(popped));
+        EXPECT_EQ(0, cv::norm(frame - popped));
+    }
+    EXPECT_EQ(0u, queue_.dropped());
+}
+
+TEST_F(MatQueueTests, LeasedSlotIsNotOverwritten) {
+    EXPECT_TRUE(queue_.try_push(frames_[0]));
+
+    FrameLease lease;
+    ASSERT_TRUE(queue_.try_acquire(lease));
+    ASSERT_TRUE(lease.valid());
+    EXPECT_EQ(0, cv::norm(frames_[0] - lease.mat()));
+
+    // Lap the ring several times; the producer must skip the pinned slot.
+    for (int i = 0; i < 12; ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[1 + i % 4]));
+    }
+    EXPECT_EQ(0, cv::norm(frames_[0] - lease.mat()));
+
+    // The consumer never sees the skipped slot as a stale frame.
+    cv::Mat popped;
+    while (queue_.try_pop(popped)) {
         double min, max;
         cv::minMaxIdx(popped, &min, &max);
-        EXPECT_DOUBLE_EQ(0.0, min);
+        EXPECT_GE(max, 1.0);
+    }
+
+    lease.release();
+    EXPECT_FALSE(lease.valid());
+}
+
+TEST_F(MatQueueTests, PushFailsWhenEverySlotIsLeased) {
+    std::vector<FrameLease> leases(frames_.size());
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i]));
+        EXPECT_TRUE(queue_.try_acquire(leases[i]));
+    }
+    EXPECT_FALSE(queue_.try_push(frames_[0]));
+
+    // Releasing one lease frees its slot for the producer again.
+    leases[2].release();
+    EXPECT_TRUE(queue_.try_push(frames_[0]));
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        if (i == 2) continue;
+        double min, max;
+        cv::minMaxIdx(leases[i].mat(), &min, &max);
         EXPECT_DOUBLE_EQ(static_cast<double>(i), max);
     }
 }
 
+TEST_F(MatQueueTests, PopLatestSkipsBacklog) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i]));
+    }
+
+    cv::Mat popped;
+    ASSERT_TRUE(queue_.try_pop_latest(popped));
+    double min, max;
+    cv::minMaxIdx(popped, &min, &max);
+    EXPECT_DOUBLE_EQ(3.0, max);
+    EXPECT_EQ(3u, queue_.dropped());
+
+    // Nothing newer yet, and the skipped frames are not replayed.
+    EXPECT_FALSE(queue_.try_pop_latest(popped));
+    EXPECT_FALSE(queue_.try_pop(popped));
+
+    // Still the newest after the producer laps the ring.
+    for (int i = 0; i < 12; ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i % 5]));
+    }
+    ASSERT_TRUE(queue_.try_pop_latest(popped));
+    cv::minMaxIdx(popped, &min, &max);
+    EXPECT_DOUBLE_EQ(1.0, max);
+}
+
+TEST_F(MatQueueTests, AcquireLatestLeasesNewestFrame) {
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i]));
+    }
+
+    FrameLease lease;
+    ASSERT_TRUE(queue_.try_acquire_latest(lease));
+    EXPECT_EQ(0, cv::norm(frames_[2] - lease.mat()));
+    EXPECT_FALSE(queue_.try_acquire_latest(lease));
+}
+
+TEST_F(MatQueueTests, FramesCarryCaptureInfo) {
+    const int64_t captured = monotonic_ns();
+    EXPECT_TRUE(
+        queue_.try_push(frames_[0], {.sequence = 7, .capture_ns = captured}));
+    // Frames 8 and 9 were lost before reaching the queue.
+    EXPECT_TRUE(queue_.try_push(
+        frames_[1], {.sequence = 10, .capture_ns = captured + 5}));
+
+    cv::Mat popped;
+    ASSERT_TRUE(queue_.try_pop(popped));
+    EXPECT_EQ(7u, queue_.last_info().sequence);
+    EXPECT_EQ(captured, queue_.last_info().capture_ns);
+    EXPECT_EQ(0u, queue_.last_info().dropped);
+    EXPECT_GE(queue_.last_info().age_ms(), 0.0);
+
+    FrameLease lease;
+    ASSERT_TRUE(queue_.try_acquire(lease));
+    EXPECT_EQ(10u, lease.info().sequence);
+    EXPECT_EQ(captured + 5, lease.info().capture_ns);
+    EXPECT_EQ(2u, lease.info().dropped);
+}
+
+TEST_F(MatQueueTests, UnstampedPushesAreNumbered) {
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i]));
+    }
+    cv::Mat popped;
+    for (uint64_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(queue_.try_pop(popped));
+        EXPECT_EQ(i, queue_.last_info().sequence);
+        EXPECT_EQ(0u, queue_.last_info().dropped);
+    }
+}
+
+TEST_F(MatQueueTests, CommittedSlotIsPoppedWithoutCopy) {
+    cv::Mat slot = queue_.reserve_slot(10, 10, CV_8UC3);
+    ASSERT_FALSE(slot.empty());
+    EXPECT_TRUE(slot.isContinuous());
+
+    // Nothing is visible until the commit
+    frames_[3].copyTo(slot);
+    cv::Mat popped;
+    EXPECT_FALSE(queue_.try_pop(popped));
+
+    EXPECT_TRUE(queue_.commit_slot({.sequence = 4, .capture_ns = 1}));
+    FrameLease lease;
+    ASSERT_TRUE(queue_.try_acquire(lease));
+    EXPECT_EQ(slot.data, lease.mat().data);
+    EXPECT_EQ(0, cv::norm(frames_[3] - lease.mat()));
+    EXPECT_EQ(4u, lease.info().sequence);
+    EXPECT_FALSE(queue_.commit_slot());
+}
+
+TEST_F(MatQueueTests, CancelledSlotIsNeverPopped) {
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        EXPECT_TRUE(queue_.try_push(frames_[i]));
+    }
+    // Reserving overwrites the oldest frame, so cancelling drops it
+    cv::Mat slot = queue_.reserve_slot(10, 10, CV_8UC3);
+    ASSERT_FALSE(slot.empty());
+    slot.setTo(cv::Scalar(9, 9, 9));
+    queue_.cancel_slot();
+
+    cv::Mat popped;
+    for (std::size_t i = 1; i < frames_.size(); ++i) {
+        ASSERT_TRUE(queue_.try_pop(popped));
+        EXPECT_EQ(0, cv::norm(frames_[i] - popped));
+    }
+    EXPECT_FALSE(queue_.try_pop(popped));
+    EXPECT_EQ(1u, queue_.dropped());
+
+    // The same slot is handed out again
+    EXPECT_TRUE(queue_.try_push(frames_[0]));
+    ASSERT_TRUE(queue_.try_pop(popped));
+    EXPECT_EQ(0, cv::norm(frames_[0] - popped));
+}
+
+TEST_F(MatQueueTests, ReserveRejectsOversizedFrame) {
+    EXPECT_TRUE(queue_.reserve_slot(20, 20, CV_8UC3).empty());
+    EXPECT_FALSE(queue_.commit_slot());
+}
+
+TEST_F(MatQueueTests, WaitPopTimesOutWhenEmpty) {
+    const auto start = std::chrono::steady_clock::now();
+    cv::Mat popped;
+    EXPECT_FALSE(queue_.wait_pop(popped, std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(20));
+}
+
+TEST_F(MatQueueTests, WaitPopWakesOnPush) {
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue_.try_push(frames_[3]);
+    });
+
+    cv::Mat popped;
+    EXPECT_TRUE(queue_.wait_pop(popped, std::chrono::seconds(5)));
+    EXPECT_EQ(0, cv::norm(frames_[3] - popped));
+    producer.join();
+}
+
+TEST_F(MatQueueTests, WaitAnyWakesOnEitherQueue) {
+    Queue::Close("test_other");
+    auto other = Queue::Create("test_other", 2, FrameGeometry{300});
+    std::vector<Queue*> queues{&queue_, &other};
+    std::vector<uint32_t> tokens{queue_.push_token(), other.push_token()};
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        other.try_push(frames_[1]);
+    });
+    EXPECT_TRUE(Queue::WaitAny(queues, tokens, std::chrono::seconds(5)));
+    producer.join();
+
+    cv::Mat popped;
+    EXPECT_FALSE(queue_.try_pop(popped));
+    EXPECT_TRUE(other.try_pop(popped));
+
+    // Tokens taken before a push make the wait return immediately.
+    tokens = {queue_.push_token(), other.push_token()};
+    queue_.try_push(frames_[2]);
+    EXPECT_TRUE(Queue::WaitAny(queues, tokens, std::chrono::seconds(5)));
+    Queue::Close("test_other");
+}
+
+TEST_F(MatQueueTests, OpenReadsGeometryFromHeader) {
+    auto consumer = Queue::Open("test");
+    ASSERT_TRUE(consumer.is_valid());
+    EXPECT_EQ(5u, consumer.capacity());
+    EXPECT_EQ(300u, consumer.max_frame_size());
+    EXPECT_EQ(ANY_PIXEL_TYPE, consumer.pixel_type());
+
+    EXPECT_TRUE(queue_.try_push(frames_[3]));
+    cv::Mat popped;
+    ASSERT_TRUE(consumer.try_pop(popped));
+    EXPECT_EQ(10, popped.rows);
+}
+
+TEST_F(MatQueueTests, OpenRejectsIncompatibleLayout) {
+    // Not a queue at all.
+    SharedMemoryRegion::Unlink("test_garbage");
+    auto garbage = SharedMemoryRegion::Create("test_garbage", 8192);
+    std::memset(garbage.memory, 0xab, garbage.size);
+    EXPECT_FALSE(Queue::Open("test_garbage").is_valid());
+    SharedMemoryRegion::Unlink("test_garbage");
+
+    // A queue written by a different layout version.
+    auto region = SharedMemoryRegion::Open("test");
+    ASSERT_TRUE(region.is_valid());
+    auto* version = static_cast<uint32_t*>(region.memory) + 1;
+    *version += 1;
+    EXPECT_FALSE(Queue::Open("test").is_valid());
+    *version -= 1;
+    EXPECT_TRUE(Queue::Open("test").is_valid());
+}
+
+TEST_F(MatQueueTests, ReopeningReleasesTheMapping) {
+    const auto descriptors = [] {
+        return std::distance(
+            std::filesystem::directory_iterator("/proc/self/fd"),
+            std::filesystem::directory_iterator{});
+    };
+    auto consumer = Queue::Open("test");
+    ASSERT_TRUE(consumer.is_valid());
+    const auto before = descriptors();
+
+    // Replacing or destroying a queue unmaps it and closes its descriptor
+    for (int i = 0; i < 16; ++i) {
+        consumer = Queue::Open("test");
+        ASSERT_TRUE(consumer.is_valid());
+        auto temporary = Queue::Open("test");
+        ASSERT_TRUE(temporary.is_valid());
+    }
+    EXPECT_EQ(before, descriptors());
+}
+
+TEST_F(MatQueueTests, RejectsMismatchedPixelType) {
+    Queue::Close("test_typed");
+    auto typed =
+        Queue::Create("test_typed", 2, FrameGeometry::Of(10, 10, CV_8UC3));
+    EXPECT_EQ(300u, typed.max_frame_size());
+    EXPECT_FALSE(typed.try_push(cv::Mat(10, 10, CV_8UC1, cv::Scalar(1))));
+    EXPECT_TRUE(typed.try_push(frames_[1]));
+    Queue::Close("test_typed");
+}
+
+TEST_F(MatQueueTests, QueuesOfDifferentSizesCoexist) {
+    Queue::Close("test_large");
+    auto large =
+        Queue::Create("test_large", 2, FrameGeometry::Of(40, 40, CV_8UC3));
+    auto consumer = Queue::Open("test_large");
+    ASSERT_TRUE(consumer.is_valid());
+    EXPECT_GT(consumer.max_frame_size(), queue_.max_frame_size());
+
+    cv::Mat big(40, 40, CV_8UC3, cv::Scalar(9, 9, 9));
+    EXPECT_FALSE(queue_.try_push(big));
+    EXPECT_TRUE(large.try_push(big));
+    cv::Mat popped;
+    ASSERT_TRUE(consumer.try_pop(popped));
+    EXPECT_EQ(40, popped.cols);
+    Queue::Close("test_large");
+}
+
+TEST(MatQueueConcurrencyTests, NeverReturnsTornFrame) {
+    using Queue = MatQueue;
+    Queue::Close("test_torn");
+    auto producer =
+        Queue::Create("test_torn", 2, FrameGeometry::Of(64, 64, CV_8UC3));
+    auto consumer = Queue::Open("test_torn");
+    ASSERT_TRUE(producer.is_valid());
+    ASSERT_TRUE(consumer.is_valid());
+
+    // A tiny ring and a fast producer make the writer lap the reader
+    // constantly; every frame handed out must still be uniform.
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (int i = 0; i < 5000; ++i) {
+            cv::Mat frame(64, 64, CV_8UC3, cv::Scalar::all(i % 256));
+            producer.try_push(frame);
+        }
+        done.store(true);
+    });
+
+    std::size_t popped_count = 0;
+    while (!done.load() || popped_count == 0) {
+        cv::Mat popped;
+        if (!consumer.try_pop(popped)) continue;
+        double min, max;
+        cv::minMaxIdx(popped, &min, &max);
+        EXPECT_DOUBLE_EQ(min, max);
+        ++popped_count;
+    }
+    writer.join();
+    EXPECT_GT(popped_count, 0u);
+
+    Queue::Close("test_torn");
+}
+
 }  // namespace pallas
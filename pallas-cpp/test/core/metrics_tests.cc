@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <core/metrics.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pallas {
+
+TEST(MetricsTests, CounterSumsShardsOfAllThreads) {
+    MetricsRegistry registry;
+    Counter& counter = registry.counter("test_total", "Test counter");
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 16; ++i) {
+        threads.emplace_back([&counter]() {
+            for (int j = 0; j < 1000; ++j) counter.add();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(16'000u, counter.value());
+}
+
+TEST(MetricsTests, SameNameAndLabelsIsSameMetric) {
+    MetricsRegistry registry;
+    Gauge& a = registry.gauge("test_gauge", "Test gauge", {{"camera", "a"}});
+    Gauge& b = registry.gauge("test_gauge", "Test gauge", {{"camera", "b"}});
+    EXPECT_NE(&a, &b);
+    EXPECT_EQ(&a,
+              &registry.gauge("test_gauge", "Test gauge", {{"camera", "a"}}));
+    EXPECT_THROW(registry.counter("test_gauge", "Not a gauge"),
+                 std::invalid_argument);
+}
+
+TEST(MetricsTests, WritesPrometheusText) {
+    MetricsRegistry registry;
+    registry.counter("test_frames_total", "Frames", {{"camera", "ps3-0"}})
+        .add(3);
+    registry.gauge("test_clients", "Clients").set(2);
+    DurationMetric& duration = registry.duration(
+        "test_encode_seconds", "Encode time", {{"camera", "a\"b"}});
+    duration.record(200'000);     // 0.2 ms
+    duration.record(3'000'000);   // 3 ms
+    duration.record(4'000'000'000);  // 4 s, past every bound
+
+    std::ostringstream out;
+    registry.write_prometheus(out);
+    const std::string text = out.str();
+    EXPECT_NE(std::string::npos,
+              text.find("# HELP test_frames_total Frames\n"
+                        "# TYPE test_frames_total counter\n"
+                        "test_frames_total{camera=\"ps3-0\"} 3\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("# TYPE test_clients gauge\ntest_clients 2\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_encode_seconds histogram\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_bucket{camera=\"a\\\"b\",le=\"0.0005\"} 1\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_bucket{camera=\"a\\\"b\",le=\"0.005\"} 2\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_bucket{camera=\"a\\\"b\",le=\"2.5\"} 2\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_bucket{camera=\"a\\\"b\",le=\"+Inf\"} 3\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_sum{camera=\"a\\\"b\"} 4.0032\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("test_encode_seconds_count{camera=\"a\\\"b\"} 3\n"));
+}
+
+}  // namespace pallas
@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "core/pipeline.h"
+
+namespace pallas {
+
+namespace {
+
+ServiceConfig stage_config(std::string name) {
+    return ServiceConfig{.name = std::move(name), .port = 0, .interval_ms = 0};
+}
+
+// Waits up to a second for count to reach expected
+bool wait_for(const std::atomic<int>& count, int expected) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (count.load() < expected) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST(PipelineEdgeTests, PopsInOrder) {
+    PipelineEdge<int> edge(4, DropPolicy::DropOldest);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(edge.push(i));
+
+    int item;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(edge.try_pop(item));
+        EXPECT_EQ(i, item);
+    }
+    EXPECT_FALSE(edge.try_pop(item));
+    EXPECT_EQ(0u, edge.dropped());
+}
+
+TEST(PipelineEdgeTests, DropOldestKeepsNewestItems) {
+    PipelineEdge<int> edge(3, DropPolicy::DropOldest);
+    EXPECT_EQ(4u, edge.capacity());
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(edge.push(i));
+    EXPECT_FALSE(edge.push(4));
+    EXPECT_FALSE(edge.push(5));
+    EXPECT_EQ(2u, edge.dropped());
+
+    int item;
+    for (int i = 2; i < 6; ++i) {
+        ASSERT_TRUE(edge.try_pop(item));
+        EXPECT_EQ(i, item);
+    }
+}
+
+TEST(PipelineEdgeTests, DropNewestKeepsBacklog) {
+    PipelineEdge<int> edge(2, DropPolicy::DropNewest);
+    EXPECT_TRUE(edge.push(0));
+    EXPECT_TRUE(edge.push(1));
+    EXPECT_FALSE(edge.push(2));
+    EXPECT_EQ(1u, edge.dropped());
+
+    int item;
+    ASSERT_TRUE(edge.try_pop(item));
+    EXPECT_EQ(0, item);
+    ASSERT_TRUE(edge.try_pop(item));
+    EXPECT_EQ(1, item);
+}
+
+TEST(PipelineEdgeTests, ReleasesPoppedAndDroppedItems) {
+    PipelineEdge<std::shared_ptr<int>> edge(1, DropPolicy::DropOldest);
+    EXPECT_EQ(2u, edge.capacity());
+    auto first = std::make_shared<int>(1);
+    edge.push(first);
+    edge.push(std::make_shared<int>(2));
+    edge.push(std::make_shared<int>(3));
+    EXPECT_EQ(1, first.use_count());
+
+    std::shared_ptr<int> item;
+    ASSERT_TRUE(edge.try_pop(item));
+    EXPECT_EQ(2, *item);
+    EXPECT_EQ(1, item.use_count());
+}
+
+TEST(PipelineEdgeTests, WaitPopWakesOnPushAndClose) {
+    PipelineEdge<int> edge(2, DropPolicy::DropOldest);
+    std::thread producer([&edge]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        edge.push(7);
+    });
+    int item = 0;
+    EXPECT_TRUE(edge.wait_pop(item, std::chrono::seconds(1)));
+    EXPECT_EQ(7, item);
+    producer.join();
+
+    std::thread closer([&edge]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        edge.close();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(edge.wait_pop(item, std::chrono::seconds(1)));
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(500));
+    closer.join();
+}
+
+TEST(PipelineEdgeTests, ManyProducersAndConsumers) {
+    constexpr int PER_PRODUCER = 10000;
+    PipelineEdge<int> edge(64, DropPolicy::DropNewest);
+    std::atomic<int> received{0};
+    std::atomic<long> sum{0};
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            int item;
+            while (!done.load() || edge.try_pop(item)) {
+                if (edge.wait_pop(item, std::chrono::milliseconds(1))) {
+                    received.fetch_add(1);
+                    sum.fetch_add(item);
+                }
+            }
+        });
+    }
+    std::vector<std::thread> producers;
+    std::atomic<int> pushed{0};
+    std::atomic<long> pushed_sum{0};
+    for (int p = 0; p < 2; ++p) {
+        producers.emplace_back([&]() {
+            for (int i = 1; i <= PER_PRODUCER; ++i) {
+                if (edge.push(i)) {
+                    pushed.fetch_add(1);
+                    pushed_sum.fetch_add(i);
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    ASSERT_TRUE(wait_for(received, pushed.load()));
+    done.store(true);
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(pushed.load(), received.load());
+    EXPECT_EQ(pushed_sum.load(), sum.load());
+    EXPECT_EQ(2u * PER_PRODUCER, pushed.load() + edge.dropped());
+}
+
+TEST(PipelineTests, RunsItemsThroughStages) {
+    Pipeline pipeline;
+    auto input = pipeline.source<int>(8);
+    auto doubled = pipeline.stage(
+        {.base = stage_config("double"), .output_capacity = 8}, input,
+        [](int&& value) -> std::optional<int> { return value * 2; });
+    // Drops odd inputs
+    auto labelled = pipeline.stage(
+        {.base = stage_config("label"), .output_capacity = 8}, doubled,
+        [](int&& value) -> std::optional<std::string> {
+            if (value % 4 != 0) return std::nullopt;
+            return std::to_string(value);
+        });
+
+    std::mutex mutex;
+    std::vector<std::string> results;
+    std::atomic<int> count{0};
+    pipeline.sink(stage_config("collect"), labelled,
+                  [&](std::string&& label) {
+                      std::lock_guard<std::mutex> lock(mutex);
+                      results.push_back(std::move(label));
+                      count.fetch_add(1);
+                  });
+
+    ASSERT_TRUE(pipeline.start());
+    for (int i = 0; i < 6; ++i) input->push(i);
+    ASSERT_TRUE(wait_for(count, 3));
+    pipeline.stop();
+
+    EXPECT_EQ((std::vector<std::string>{"0", "4", "8"}), results);
+    const auto stats = pipeline.stats();
+    ASSERT_EQ(3u, stats.size());
+    EXPECT_EQ("double", stats[0].name);
+    EXPECT_EQ(6u, stats[0].processed);
+    EXPECT_EQ(6u, stats[1].processed);
+    EXPECT_EQ(3u, stats[2].processed);
+    EXPECT_EQ(6u, stats[0].latency->count());
+}
+
+TEST(PipelineTests, StagesOverlapAcrossItems) {
+    constexpr int ITEMS = 10;
+    constexpr auto WORK = std::chrono::milliseconds(5);
+    const auto work = [WORK](int&& value) -> std::optional<int> {
+        std::this_thread::sleep_for(WORK);
+        return value;
+    };
+
+    Pipeline pipeline;
+    auto input = pipeline.source<int>(ITEMS, DropPolicy::DropNewest);
+    PipelineStageConfig config{.base = stage_config("a"),
+                               .output_capacity = ITEMS,
+                               .output_policy = DropPolicy::DropNewest};
+    auto a = pipeline.stage(config, input, work);
+    config.base = stage_config("b");
+    auto b = pipeline.stage(config, a, work);
+    config.base = stage_config("c");
+    auto c = pipeline.stage(config, b, work);
+    std::atomic<int> count{0};
+    pipeline.sink(stage_config("count"), c,
+                  [&](int&&) { count.fetch_add(1); });
+
+    ASSERT_TRUE(pipeline.start());
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITEMS; ++i) input->push(i);
+    ASSERT_TRUE(wait_for(count, ITEMS));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    pipeline.stop();
+
+    // Serially this takes 3 * 10 * 5 ms; pipelined about (10 + 2) * 5 ms
+    EXPECT_LT(elapsed, 3 * ITEMS * WORK * 3 / 4);
+}
+
+TEST(PipelineTests, StopsPromptlyAndRestarts) {
+    Pipeline pipeline;
+    auto input = pipeline.source<int>(2);
+    std::atomic<int> count{0};
+    pipeline.sink(stage_config("count"), input,
+                  [&](int&&) { count.fetch_add(1); });
+
+    ASSERT_TRUE(pipeline.start());
+    EXPECT_FALSE(pipeline.start());
+    const auto start = std::chrono::steady_clock::now();
+    pipeline.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(50));
+
+    ASSERT_TRUE(pipeline.start());
+    input->push(1);
+    EXPECT_TRUE(wait_for(count, 1));
+}
+
+TEST(PipelineTests, StopReleasesQueuedItems) {
+    Pipeline pipeline;
+    auto input = pipeline.source<std::shared_ptr<int>>(4);
+    pipeline.sink(stage_config("never"), input,
+                  [](std::shared_ptr<int>&&) {});
+
+    // Never started, so the item stays queued until stop()
+    auto item = std::make_shared<int>(1);
+    input->push(item);
+    EXPECT_EQ(2, item.use_count());
+    pipeline.stop();
+    EXPECT_EQ(1, item.use_count());
+}
+
+}  // namespace pallas
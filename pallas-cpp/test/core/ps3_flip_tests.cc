@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include "service/ps3.h"
+
+namespace pallas {
+
+TEST(PS3EyeFlipTests, SensorTakesBothAxes) {
+    const auto flip = softwareFlip({.horizontal = true, .vertical = true},
+                                   {.horizontal = true, .vertical = true});
+    EXPECT_FALSE(flip.horizontal);
+    EXPECT_FALSE(flip.vertical);
+}
+
+TEST(PS3EyeFlipTests, SoftwareFlipsOnlyTheAxisTheSensorRefused) {
+    // Sensor took HFLIP but refused VFLIP
+    auto flip = softwareFlip({.horizontal = true, .vertical = true},
+                             {.horizontal = true, .vertical = false});
+    EXPECT_FALSE(flip.horizontal);
+    EXPECT_TRUE(flip.vertical);
+
+    // And the other way round
+    flip = softwareFlip({.horizontal = true, .vertical = true},
+                        {.horizontal = false, .vertical = true});
+    EXPECT_TRUE(flip.horizontal);
+    EXPECT_FALSE(flip.vertical);
+}
+
+TEST(PS3EyeFlipTests, UnrequestedAxesAreNeverFlipped) {
+    const auto flip = softwareFlip({.horizontal = false, .vertical = true},
+                                   {.horizontal = false, .vertical = false});
+    EXPECT_FALSE(flip.horizontal);
+    EXPECT_TRUE(flip.vertical);
+}
+
+}  // namespace pallas
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "service/ps3_packets.h"
+
+namespace pallas {
+
+class PS3EyePacketTests : public testing::Test {
+   protected:
+    // Five payloads, split over three transfers
+    static constexpr int WIDTH = 64;
+    static constexpr int HEIGHT = 64;
+    static constexpr std::size_t FRAME_SIZE = WIDTH * HEIGHT * 2;
+    static constexpr std::size_t PAYLOAD_DATA_SIZE =
+        PS3_EYE_PAYLOAD_SIZE - PS3_EYE_PAYLOAD_HEADER_SIZE;
+
+    void SetUp() override {
+        path_ = std::filesystem::temp_directory_path() / "ps3_packets_test.bin";
+        assembler_.setSink([this](std::vector<uint8_t>& frame,
+                                  const PS3EyeRawFrame& info) {
+            frames_.push_back(frame);
+            infos_.push_back(info);
+        });
+    }
+
+    void TearDown() override { std::filesystem::remove(path_); }
+
+    // Splits a frame filled with `value` into bridge payloads, the way the
+    // OV534 sends it, and packs up to two payloads into each bulk transfer.
+    // A short payload ends its transfer, like a short USB packet does.
+    static std::vector<std::vector<uint8_t>> encode(uint8_t value, uint32_t pts,
+                                                    uint8_t fid,
+                                                    std::size_t size = FRAME_SIZE) {
+        std::vector<std::vector<uint8_t>> transfers;
+        std::vector<uint8_t> transfer;
+        for (std::size_t offset = 0; offset < size;
+             offset += PAYLOAD_DATA_SIZE) {
+            const std::size_t length =
+                std::min(PAYLOAD_DATA_SIZE, size - offset);
+            uint8_t flags = PS3_EYE_PAYLOAD_PTS | fid;
+            if (offset + length == size) flags |= PS3_EYE_PAYLOAD_EOF;
+
+            const std::size_t header = transfer.size();
+            transfer.resize(header + PS3_EYE_PAYLOAD_HEADER_SIZE, 0);
+            transfer[header] = PS3_EYE_PAYLOAD_HEADER_SIZE;
+            transfer[header + 1] = flags;
+            for (int byte = 0; byte < 4; ++byte) {
+                transfer[header + 2 + byte] =
+                    static_cast<uint8_t>(pts >> (8 * byte));
+            }
+            transfer.insert(transfer.end(), length, value);
+
+            if (length < PAYLOAD_DATA_SIZE ||
+                transfer.size() == 2 * PS3_EYE_PAYLOAD_SIZE) {
+                transfers.push_back(std::move(transfer));
+                transfer.clear();
+            }
+        }
+        if (!transfer.empty()) transfers.push_back(std::move(transfer));
+        return transfers;
+    }
+
+    void record(const std::vector<std::vector<uint8_t>>& transfers) {
+        PS3EyePacketRecorder recorder;
+        ASSERT_TRUE(recorder.open(path_.string()));
+        for (const auto& transfer : transfers) recorder.write(transfer);
+        recorder.close();
+    }
+
+    std::filesystem::path path_;
+    PS3EyeFrameAssembler assembler_{WIDTH, HEIGHT};
+    std::vector<std::vector<uint8_t>> frames_;
+    std::vector<PS3EyeRawFrame> infos_;
+};
+
+TEST_F(PS3EyePacketTests, ReplaysRecordedFrames) {
+    std::vector<std::vector<uint8_t>> transfers;
+    for (uint8_t i = 0; i < 3; ++i) {
+        auto frame = encode(i + 1, 100 + i, i % 2);
+        transfers.insert(transfers.end(), frame.begin(), frame.end());
+    }
+    record(transfers);
+
+    PS3EyePacketReplay replay;
+    ASSERT_TRUE(replay.open(path_.string()));
+    EXPECT_EQ(transfers.size(), replay.replay(assembler_));
+
+    ASSERT_EQ(3u, frames_.size());
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        ASSERT_EQ(FRAME_SIZE, frames_[i].size());
+        EXPECT_EQ(std::vector<uint8_t>(FRAME_SIZE, i + 1), frames_[i]);
+        EXPECT_EQ(i, infos_[i].sequence);
+        EXPECT_EQ(100 + i, infos_[i].pts);
+    }
+    EXPECT_EQ(0u, assembler_.dropped());
+}
+
+TEST_F(PS3EyePacketTests, DropsFrameWithLostTransfer) {
+    auto torn = encode(1, 1, 0);
+    torn.erase(torn.begin() + 1);
+    for (const auto& transfer : torn) assembler_.feed(transfer);
+    for (const auto& transfer : encode(2, 2, 1)) assembler_.feed(transfer);
+
+    ASSERT_EQ(1u, frames_.size());
+    EXPECT_EQ(std::vector<uint8_t>(FRAME_SIZE, 2), frames_[0]);
+    EXPECT_EQ(1u, assembler_.dropped());
+    // The dropped frame leaves a gap in the sequence
+    EXPECT_EQ(1u, infos_[0].sequence);
+}
+
+TEST_F(PS3EyePacketTests, DropsFrameInterruptedByNextOne) {
+    auto truncated = encode(1, 1, 0);
+    truncated.pop_back();
+    for (const auto& transfer : truncated) assembler_.feed(transfer);
+    for (const auto& transfer : encode(2, 2, 1)) assembler_.feed(transfer);
+
+    ASSERT_EQ(1u, frames_.size());
+    EXPECT_EQ(std::vector<uint8_t>(FRAME_SIZE, 2), frames_[0]);
+    EXPECT_EQ(1u, assembler_.dropped());
+    // The dropped frame leaves a gap in the sequence
+    EXPECT_EQ(1u, infos_[0].sequence);
+}
+
+TEST_F(PS3EyePacketTests, DropsOversizedFrame) {
+    for (const auto& transfer : encode(1, 1, 0, FRAME_SIZE + 1)) {
+        assembler_.feed(transfer);
+    }
+    EXPECT_TRUE(frames_.empty());
+    EXPECT_EQ(1u, assembler_.dropped());
+}
+
+TEST_F(PS3EyePacketTests, SinkCanSwapFrameOut) {
+    std::vector<uint8_t> taken(FRAME_SIZE);
+    assembler_.setSink(
+        [&](std::vector<uint8_t>& frame, const PS3EyeRawFrame&) {
+            std::swap(frame, taken);
+        });
+    for (const auto& transfer : encode(7, 1, 0)) assembler_.feed(transfer);
+    for (const auto& transfer : encode(8, 2, 1)) assembler_.feed(transfer);
+
+    EXPECT_EQ(std::vector<uint8_t>(FRAME_SIZE, 8), taken);
+    EXPECT_EQ(2u, assembler_.frames());
+}
+
+}  // namespace pallas
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <core/futex.h>
+#include <core/service.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace pallas {
+
+namespace {
+
+class CountingService : public Service {
+   public:
+    CountingService(ServiceConfig config, std::chrono::microseconds work =
+                                              std::chrono::microseconds(0))
+        : Service(std::move(config)), work_(work) {}
+    ~CountingService() override { stop(); }
+
+    int ticks() const { return ticks_.load(); }
+
+    // Makes the service event-driven, ticking when word changes
+    void watch(std::atomic<uint32_t>* word) { events().add_futex(word); }
+
+    // Makes tick number `tick` take `duration` instead of the usual work
+    void stall(int tick, std::chrono::microseconds duration) {
+        stall_tick_ = tick;
+        stall_ = duration;
+    }
+
+    // Start and end of every tick; read only once the service is stopped
+    struct Span {
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+    const std::vector<Span>& spans() const { return spans_; }
+
+   protected:
+    std::expected<void, std::string> tick() override {
+        const auto start = std::chrono::steady_clock::now();
+        const int tick = ticks_.fetch_add(1);
+        std::this_thread::sleep_for(tick == stall_tick_ ? stall_ : work_);
+        spans_.push_back({start, std::chrono::steady_clock::now()});
+        return {};
+    }
+
+   private:
+    std::chrono::microseconds work_;
+    std::atomic<int> ticks_{0};
+    int stall_tick_ = -1;
+    std::chrono::microseconds stall_{0};
+    std::vector<Span> spans_;
+};
+
+// Runs a 4 ms service whose tick 5 stalls for `stall`, and returns the
+// spans of its ticks
+std::vector<CountingService::Span> ticks_around_stall(
+    OverrunPolicy policy, std::chrono::microseconds stall) {
+    CountingService service({.name = "stall",
+                             .port = 0,
+                             .interval_ms = 4,
+                             .overrun_policy = policy});
+    service.stall(5, stall);
+    if (!service.start()) return {};
+    std::this_thread::sleep_for(stall + std::chrono::milliseconds(50));
+    service.stop();
+    return service.spans();
+}
+
+// Ticks that start within 1 ms of the stall ending. On schedule at most
+// one does, and being preempted only makes it fewer.
+int ticks_right_after_stall(const std::vector<CountingService::Span>& spans) {
+    if (spans.size() < 6) return -1;
+    const auto window_end = spans[5].end + std::chrono::milliseconds(1);
+    return static_cast<int>(
+        std::count_if(spans.begin() + 6, spans.end(), [&](const auto& span) {
+            return span.start < window_end;
+        }));
+}
+
+// Ticks after the first one past the stall that start within 1 ms of the
+// previous one, i.e. that catch up instead of waiting for their period
+int ticks_catching_up(const std::vector<CountingService::Span>& spans) {
+    int catching_up = 0;
+    for (std::size_t i = 7; i < spans.size(); ++i) {
+        if (spans[i].start - spans[i - 1].start >=
+            std::chrono::milliseconds(1)) {
+            break;
+        }
+        ++catching_up;
+    }
+    return catching_up;
+}
+
+}  // namespace
+
+TEST(ServiceTests, KeepsFractionalPeriod) {
+    // Truncated to whole milliseconds this would tick every 2 ms
+    CountingService service(
+        {.name = "periodic", .port = 0, .interval_ms = 2.5});
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(service.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    service.stop();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Never more ticks than 2.5 ms periods in the time it actually ran,
+    // which 2 ms periods would exceed by a fifth. A loaded test machine
+    // may miss periods, so the lower bound is loose.
+    const int periods = static_cast<int>(
+        elapsed / std::chrono::microseconds(2500));
+    EXPECT_LE(service.ticks(), periods + 1);
+    EXPECT_GE(service.ticks(), 40);
+    EXPECT_EQ(static_cast<uint64_t>(service.ticks()),
+              service.tick_latency().count());
+    EXPECT_GT(service.wakeup_latency().count(), 0u);
+}
+
+TEST(ServiceTests, SkipsMissedPeriods) {
+    // Every 3 ms tick misses its 2 ms deadline, so it runs every other period
+    CountingService service({.name = "overrun",
+                             .port = 0,
+                             .interval_ms = 2,
+                             .overrun_policy = OverrunPolicy::Skip},
+                            std::chrono::microseconds(3000));
+    ASSERT_TRUE(service.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    service.stop();
+
+    EXPECT_LE(service.ticks(), 52);
+    EXPECT_GE(service.overruns(), static_cast<uint64_t>(service.ticks() - 2));
+    EXPECT_GE(service.tick_latency().percentile_ns(50), 3'000'000);
+}
+
+TEST(ServiceTests, CatchesUpOnMissedPeriods) {
+    // A 14 ms stall misses at least 3 of the 4 ms periods, which run back
+    // to back after it
+    EXPECT_GE(ticks_catching_up(ticks_around_stall(
+                  OverrunPolicy::CatchUp, std::chrono::milliseconds(14))),
+              2);
+    // Skip resumes on the next period instead
+    EXPECT_LE(ticks_right_after_stall(ticks_around_stall(
+                  OverrunPolicy::Skip, std::chrono::milliseconds(14))),
+              1);
+    // A backlog of more than 8 periods is skipped even when catching up
+    EXPECT_LE(ticks_right_after_stall(ticks_around_stall(
+                  OverrunPolicy::CatchUp, std::chrono::milliseconds(38))),
+              1);
+}
+
+TEST(ServiceTests, UnpacedServiceTicksBackToBack) {
+    CountingService service({.name = "unpaced", .port = 0, .interval_ms = 0},
+                            std::chrono::microseconds(100));
+    ASSERT_TRUE(service.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    service.stop();
+
+    EXPECT_GT(service.ticks(), 50);
+    EXPECT_EQ(0u, service.wakeup_latency().count());
+    EXPECT_EQ(0u, service.overruns());
+}
+
+TEST(ServiceTests, EventDrivenServiceTicksOnlyOnEvents) {
+    std::atomic<uint32_t> word{0};
+    CountingService service({.name = "events", .port = 0, .interval_ms = 0});
+    service.watch(&word);
+    ASSERT_TRUE(service.start());
+
+    // One tick at startup, then nothing while idle
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(1, service.ticks());
+
+    for (int i = 0; i < 3; ++i) {
+        word.fetch_add(1);
+        futex_wake(&word);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_EQ(4, service.ticks());
+
+    // stop() interrupts the idle wait
+    const auto start = std::chrono::steady_clock::now();
+    service.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(100));
+    EXPECT_EQ(0u, service.wakeup_latency().count());
+}
+
+TEST(ServiceTests, EventDrivenServiceAddsIntervalTimer) {
+    std::atomic<uint32_t> word{0};
+    CountingService service({.name = "events", .port = 0, .interval_ms = 5});
+    service.watch(&word);
+    ASSERT_TRUE(service.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    service.stop();
+
+    EXPECT_GE(service.ticks(), 15);
+    EXPECT_LE(service.ticks(), 22);
+}
+
+}  // namespace pallas
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <opencv2/core.hpp>
+
+#include "service/mat_queue.h"
+#include "service/shared_memory.h"
+
+namespace pallas {
+
+TEST(SharedMemoryTests, OpenSeesCreatedBytes) {
+    SharedMemoryRegion::Unlink("shm_test");
+    auto created = SharedMemoryRegion::Create(
+        "shm_test", 10000,
+        {.populate = true, .numa_node = NUMA_NODE_LOCAL});
+    ASSERT_TRUE(created.is_valid());
+    EXPECT_GE(created.size, 10000u);
+    std::memset(created.memory, 7, 10000);
+
+    auto opened = SharedMemoryRegion::Open("shm_test");
+    ASSERT_TRUE(opened.is_valid());
+    EXPECT_EQ(created.size, opened.size);
+    EXPECT_EQ(7, static_cast<uint8_t*>(opened.memory)[9999]);
+
+    SharedMemoryRegion::Unlink("shm_test");
+    EXPECT_FALSE(SharedMemoryRegion::Open("shm_test").is_valid());
+}
+
+TEST(SharedMemoryTests, HugePagesRoundToHugePageSize) {
+    // Falls back to transparent huge pages when no hugetlbfs pool exists
+    SharedMemoryRegion::Unlink("shm_huge_test");
+    auto region = SharedMemoryRegion::Create("shm_huge_test", 10000,
+                                             {.huge_pages = true});
+    ASSERT_TRUE(region.is_valid());
+    EXPECT_EQ(0u, region.size % HUGE_PAGE_SIZE);
+    SharedMemoryRegion::Unlink("shm_huge_test");
+}
+
+TEST(SharedMemoryTests, MatQueueOnHugePages) {
+    using Queue = MatQueue;
+    Queue::Close("shm_queue_test");
+    auto producer = Queue::Create("shm_queue_test", 3, FrameGeometry{300},
+                                  {.huge_pages = true, .populate = true});
+    auto consumer = Queue::Open("shm_queue_test");
+    ASSERT_TRUE(producer.is_valid());
+    ASSERT_TRUE(consumer.is_valid());
+
+    cv::Mat frame(10, 10, CV_8UC3, cv::Scalar(5, 5, 5));
+    EXPECT_TRUE(producer.try_push(frame));
+    cv::Mat popped;
+    ASSERT_TRUE(consumer.try_pop(popped));
+    double min, max;
+    cv::minMaxIdx(popped, &min, &max);
+    EXPECT_DOUBLE_EQ(5.0, min);
+    EXPECT_DOUBLE_EQ(5.0, max);
+    Queue::Close("shm_queue_test");
+}
+
+}  // namespace pallas
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <core/stream_copy.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace pallas {
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    return bytes;
+}
+
+}  // namespace
+
+class StreamCopyTests : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(StreamCopyTests, CopiesEveryByteAtAnyAlignment) {
+    const size_t size = GetParam();
+    const auto source = pattern(size + 64);
+    std::vector<uint8_t> destination(size + 64);
+
+    // Misalign source and destination independently of each other
+    for (size_t src_offset : {0, 1, 17}) {
+        for (size_t dst_offset : {0, 3, 32}) {
+            std::fill(destination.begin(), destination.end(), 0);
+            stream_copy_to(destination.data() + dst_offset,
+                           source.data() + src_offset, size);
+            EXPECT_EQ(0, std::memcmp(destination.data() + dst_offset,
+                                     source.data() + src_offset, size));
+            // Nothing past the end is touched
+            EXPECT_EQ(0, destination[dst_offset + size]);
+
+            std::fill(destination.begin(), destination.end(), 0);
+            stream_copy_from(destination.data() + dst_offset,
+                             source.data() + src_offset, size);
+            EXPECT_EQ(0, std::memcmp(destination.data() + dst_offset,
+                                     source.data() + src_offset, size));
+            EXPECT_EQ(0, destination[dst_offset + size]);
+        }
+    }
+}
+
+// Sizes straddle the memcpy threshold and the vector loop widths
+INSTANTIATE_TEST_SUITE_P(Sizes, StreamCopyTests,
+                         ::testing::Values(0, 1, 63, 4096, 65535, 65536,
+                                           65536 + 129, 640 * 480 * 3));
+
+TEST(StreamCopyTests, ReportsSelectedIsa) {
+    EXPECT_NE(nullptr, stream_copy_isa());
+    EXPECT_GT(std::strlen(stream_copy_isa()), 0u);
+}
+
+}  // namespace pallas
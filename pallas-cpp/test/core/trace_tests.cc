@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/trace.h"
+
+namespace pallas {
+
+// Rings are per thread, so each test records on a fresh one
+template <typename Fn>
+void on_new_thread(Fn&& fn) {
+    std::thread thread(std::forward<Fn>(fn));
+    thread.join();
+}
+
+TEST(TraceTests, ScopeRecordsSpan) {
+    on_new_thread([]() {
+        {
+            TRACE_SCOPE("test.scope");
+        }
+        const auto events = Tracer::thread_events();
+        ASSERT_EQ(1u, events.size());
+        EXPECT_STREQ("test.scope", events[0].name);
+        EXPECT_GT(events[0].begin_ns, 0);
+        EXPECT_GE(events[0].end_ns, events[0].begin_ns);
+        EXPECT_FALSE(events[0].async);
+    });
+}
+
+TEST(TraceTests, DisabledScopeRecordsNothing) {
+    on_new_thread([]() {
+        Tracer::set_enabled(false);
+        {
+            TRACE_SCOPE("test.disabled");
+        }
+        Tracer::set_enabled(true);
+        EXPECT_TRUE(Tracer::thread_events().empty());
+    });
+}
+
+TEST(TraceTests, RingKeepsNewestEvents) {
+    on_new_thread([]() {
+        const std::size_t total = Tracer::EVENTS_PER_THREAD + 10;
+        for (std::size_t i = 0; i < total; ++i) {
+            Tracer::record("test.wrap", i, i + 1);
+        }
+        // The oldest slot is the next one written, so it is skipped
+        const auto events = Tracer::thread_events();
+        ASSERT_EQ(Tracer::EVENTS_PER_THREAD - 1, events.size());
+        EXPECT_EQ(11, events.front().begin_ns);
+        EXPECT_EQ(static_cast<int64_t>(total - 1), events.back().begin_ns);
+    });
+}
+
+TEST(TraceTests, WritesChromeTrace) {
+    on_new_thread([]() {
+        pthread_setname_np(pthread_self(), "trace-writer");
+        Tracer::record("test.sync", 1'000, 3'500);
+        Tracer::record("test.async", 2'000, 4'000, true);
+    });
+
+    std::ostringstream out;
+    Tracer::write_chrome_trace(out);
+    const std::string json = out.str();
+    EXPECT_NE(std::string::npos, json.find("\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"trace-writer\"}"));
+    EXPECT_NE(std::string::npos,
+              json.find("{\"name\":\"test.sync\",\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, json.find("\"ts\":1.000,\"dur\":2.500}"));
+    EXPECT_NE(std::string::npos,
+              json.find("{\"name\":\"test.async\",\"cat\":\"async\",\"ph\":\"b\""));
+    EXPECT_NE(std::string::npos,
+              json.find("{\"name\":\"test.async\",\"cat\":\"async\",\"ph\":\"e\""));
+    EXPECT_EQ("\n]}\n", json.substr(json.size() - 4));
+}
+
+TEST(TraceTests, KeepsOnlyTheLastExitedThreads) {
+    const std::size_t threads = 3 * Tracer::EXITED_THREADS_KEPT;
+    for (std::size_t i = 0; i < threads; ++i) {
+        on_new_thread([i]() {
+            const std::string name = "trace-exit-" + std::to_string(i);
+            pthread_setname_np(pthread_self(), name.c_str());
+            Tracer::record("test.exit", 1'000, 2'000);
+        });
+    }
+
+    std::ostringstream out;
+    Tracer::write_chrome_trace(out);
+    const std::string json = out.str();
+    std::size_t exported = 0;
+    for (std::size_t i = 0; i < threads; ++i) {
+        const std::string name =
+            "\"trace-exit-" + std::to_string(i) + "\"";
+        if (json.find(name) != std::string::npos) {
+            ++exported;
+            EXPECT_GE(i, threads - Tracer::EXITED_THREADS_KEPT) << name;
+        }
+    }
+    EXPECT_EQ(Tracer::EXITED_THREADS_KEPT, exported);
+}
+
+TEST(TraceTests, ExportsWhileThreadsRecord) {
+    std::atomic<bool> running{true};
+    std::atomic<int> recorded{0};
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 4; ++i) {
+        writers.emplace_back([&running, &recorded]() {
+            while (running.load()) {
+                {
+                    TRACE_SCOPE("test.concurrent");
+                    std::this_thread::sleep_for(std::chrono::microseconds(10));
+                }
+                recorded.fetch_add(1);
+            }
+        });
+    }
+    while (recorded.load() < 4) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        std::ostringstream out;
+        Tracer::write_chrome_trace(out);
+        EXPECT_NE(std::string::npos, out.str().find("test.concurrent"));
+    }
+    running.store(false);
+    for (auto& writer : writers) {
+        writer.join();
+    }
+}
+
+}  // namespace pallas
@@ -14,6 +14,32 @@ class YouOnlyLookOnceTests : public testing::Test {
     void SetUp() override {}
 
     void TearDown() override {}
+
+    // Batched runs may round differently, so they get a pixel of slack
+    static void expect_same_detections(const std::vector<Detection>& expected,
+                                       const std::vector<Detection>& actual,
+                                       double box_tolerance = 1,
+                                       float confidence_tolerance = 1e-3f) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].class_id, actual[i].class_id) << i;
+            EXPECT_NEAR(expected[i].box.center.x, actual[i].box.center.x,
+                        box_tolerance)
+                << i;
+            EXPECT_NEAR(expected[i].box.center.y, actual[i].box.center.y,
+                        box_tolerance)
+                << i;
+            EXPECT_NEAR(expected[i].box.width, actual[i].box.width,
+                        box_tolerance)
+                << i;
+            EXPECT_NEAR(expected[i].box.height, actual[i].box.height,
+                        box_tolerance)
+                << i;
+            EXPECT_NEAR(expected[i].confidence, actual[i].confidence,
+                        confidence_tolerance)
+                << i;
+        }
+    }
 };
 TEST_F(YouOnlyLookOnceTests, Beep) {
     // Precondition.
@@ -44,6 +70,58 @@ TEST_F(YouOnlyLookOnceTests, Beep) {
              class_names.at(detection.class_id));
     }
 }
+
+TEST_F(YouOnlyLookOnceTests, BatchMatchesSingleFrames) {
+    // Precondition.
+    const std::filesystem::path assets_path = "../assets/";
+    YouOnlyLookOnce yolo(assets_path / "yolo11.onnx",
+                         assets_path / "yolo11_labels.txt", false);
+    const auto image =
+        cv::imread(assets_path / "barty.jpg", cv::IMREAD_COLOR);
+    cv::Mat flipped;
+    cv::flip(image, flipped, 1);
+    // A frame of another size, which a dynamic input shape pads differently
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(), 0.5, 0.75);
+    const std::vector<cv::Mat> images = {image, cv::Mat(), small, flipped};
+
+    // Under test.
+    const auto results = yolo.detect_batch(images, 0.25f, 0.45f);
+
+    // Postcondition.
+    ASSERT_EQ(images.size(), results.size());
+    EXPECT_TRUE(results[1].empty());
+    for (const std::size_t i : {0u, 2u, 3u}) {
+        SCOPED_TRACE(i);
+        expect_same_detections(yolo.detect(images[i], 0.25f, 0.45f),
+                               results[i]);
+    }
+}
+
+TEST_F(YouOnlyLookOnceTests, ReusedWorkspaceGivesSameDetections) {
+    // Precondition.
+    const std::filesystem::path assets_path = "../assets/";
+    YouOnlyLookOnce yolo(assets_path / "yolo11.onnx",
+                         assets_path / "yolo11_labels.txt", false);
+    const auto image =
+        cv::imread(assets_path / "barty.jpg", cv::IMREAD_COLOR);
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(), 0.5, 0.5);
+
+    // Under test.
+    const auto first = yolo.detect(image, 0.25f, 0.45f);
+    // One vector reused across frames of different sizes
+    std::vector<Detection> detections;
+    yolo.detect(image, detections, 0.25f, 0.45f);
+    yolo.detect(small, detections, 0.25f, 0.45f);
+    const auto small_detections = detections;
+    yolo.detect(image, detections, 0.25f, 0.45f);
+
+    // Postcondition.
+    expect_same_detections(first, detections, 0, 0.0f);
+    expect_same_detections(yolo.detect(small, 0.25f, 0.45f),
+                           small_detections, 0, 0.0f);
+}
 }  // namespace pallas
 
 // #include <iostream>